@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <unistd.h>
+#include <pthread.h>
+#include "../utils/frame_pool.h"
 
 // ********************************************************************************************
 // USER CONFIGURATION
@@ -11,11 +13,14 @@
 // Path to image file
 #define FRAME_TX 		"/home/pi/my_code/tmp/big_hero_6_720p.mp4"
 #define FRAME_RX 		"/home/pi/my_code/tmp/output"
-#define APPBUFF_SIZE 	(298331)	// The total size of test file, max:
+#define APPBUFF_SIZE 	(298331)	// The total size of test file, RX only (TX maps the file)
 
 #define TRX_ENABLE 		(1)	// 0: This module is TX
 							// 1: This module is RX
 #define FRAME_SIZE		(57344)	// The size of each SESSION frame
+#define TX_FRAMES		(3)		// SESSION frames loaded ahead of TX
+#define TX_COMPRESS		(1)		// 1: compress the SESSION frames, unless the file is already compressed (e.g. JPEG)
+								// 0: send the file as it is
 
 // *******************************************************************************************
 #define NODE_00_ADDR	(0x1234)
@@ -23,8 +28,8 @@
 
 // -------- Node --------
 typedef struct node_t {
-	uint16_t	src_addr;		// source address
-	uint16_t	dest_addr;		// destination address
+	uint16_t	src_addr;			// source address
+	uint16_t	dest_addr;			// destination address
 	uint16_t 	sess_window_size;	// the size of window (number of packets/transaction) (adaptive)
 	uint16_t	sess_tx_delay;		// delay between 2 consecutive send (adaptive)
 } node_t;
@@ -72,6 +77,24 @@ void app_fixed_data_init(int argc, char **argv, node_t *NODE);
 void app_fixed_data_tx_data(node_t NODE);
 
 
+// *******************************************************************************************
+// Function: 
+//		void* app_fixed_data_load_data(void *arg)
+// 
+// Description:
+//		Loader thread: read (and compress) the next SESSION frames of the file while
+//		TX sends the current one
+// 
+// Parameters:
+//		BUFFER		- Mapped file
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void* app_fixed_data_load_data(void *arg);
+
+
 // *******************************************************************************************
 // Function: 
 //		void app_fixed_data_rx_data(node_t NODE)
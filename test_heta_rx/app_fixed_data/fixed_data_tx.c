@@ -2,7 +2,9 @@
 #include "../hal/hal_config_wiringpi.h"
 #include "../tal/tal_at86rf212.h"
 #include "../protocol/protocol.h"
+#include "../protocol/protocol_link.h"
 #include "../utils/utils.h"
+#include "../utils/lz.h"
 #include "../mydebug/mydebug.h"
 #include "fixed_data.h"
 
@@ -36,6 +38,11 @@ void app_fixed_data_init(int argc, char **argv, node_t *NODE)
 }
 
 
+// Loaded SESSION frames, loader -> TX
+frame_pool_t app_tx_pool;
+static uint8_t app_tx_compress;			// the SESSION frames are compressed
+
+
 // ===========================================================
 //
 // TX app
@@ -46,21 +53,25 @@ void app_fixed_data_tx_data(node_t NODE)
 	//
 	sess_t SESSION;
 	appbuff_t BUFFER;
+	pthread_t tid;
+	frame_t *FRAME;
 		
 	///////// Time calculation /////////
-	uint32_t i;
+	long frame_data_size;
 
 	at86rfx_frame_rx = false;
+	link_init(NODE.src_addr);
 
 	// ------ Initialize BUFFER information  ------
-	BUFFER.data = (uint8_t*) calloc (APPBUFF_SIZE, sizeof(uint8_t));
+	// The sessions are sent from the file pages, whatever the file size
+	printf("Info: --- Read image data from file ... \n");
+	BUFFER.data = mapBinaryFile(FRAME_TX, &frame_data_size, 0);
 	if (BUFFER.data == NULL)
 	{
-		printf("Info: --- Not enough memory to store data file ... \n");
-		exit (1);
+		printf("Info: --- Cannot read %s ... \n", FRAME_TX);
+		return;
 	}
-	printf("Info: --- Read image data from file ... \n");
-	BUFFER.length = writeBinaryFileToArray(FRAME_TX, &BUFFER.data[0]);
+	BUFFER.length = frame_data_size;
 
 #if DEBUG_INFO == 1		// ----------------------------------------
 	debug_init();
@@ -70,24 +81,31 @@ void app_fixed_data_tx_data(node_t NODE)
 	printf("Info: --- Sending image data ... \n");
 	printf("Info: --- ====================================== \n");
 
-	i = 0;
-
-	do
+	// ------ Initialize THREAD  ------
+	// TX_FRAMES sessions are loaded ahead. The frames point to the file, or to
+	// the buffers of the pool if they are compressed
+	app_tx_compress = (TX_COMPRESS == 1) && (lz_is_compressed(BUFFER.data, BUFFER.length) == 0);
+	printf("Info: --- Compression %s\n", (app_tx_compress == true) ? "on" : "off");
+	frame_pool_init(&app_tx_pool, TX_FRAMES, (app_tx_compress == true) ? FRAME_SIZE : 0);
+	printf("Debug: --- Create thread to load data\n");
+	pthread_create(&tid, NULL, app_fixed_data_load_data, &BUFFER);
+
+	SESSION.time_out = 0;
+	SESSION.status = SESS_STATUS_OK;
+	while ((FRAME = frame_pool_get(&app_tx_pool, FRAME_POOL_WAIT)) != NULL)
 	{
 		// ------ Initialize SESSION information  ------
-		SESSION.frame_length = FRAME_SIZE;
-		if ((BUFFER.length - i) < FRAME_SIZE)
-			SESSION.frame_length = (uint16_t)(BUFFER.length - i);
-
-		SESSION.packet_length = SCPL;
+		SESSION.frame_length = FRAME->length;
+		SESSION.codec = FRAME->codec;
+		SESSION.raw_length = FRAME->raw_length;
+		SESSION.deadline = 0;				// every packet of the file is needed
+		SESSION.must = NULL;
+		SESSION.link_mode	= LINK_MODE_DEFAULT;
+		SESSION.packet_length = LINK_SCPL(SESSION.link_mode);
 		SESSION.num_of_packet = SESSION.frame_length / SESSION.packet_length;
 		if ((SESSION.frame_length % SESSION.packet_length) != 0)
 			++SESSION.num_of_packet;
-
-
-
-
-		SESSION.frame_data = &BUFFER.data[i];
+		SESSION.frame_data = FRAME->data;
 
 		// Get from NODE
 		SESSION.src_addr 	= NODE.src_addr;
@@ -95,45 +113,113 @@ void app_fixed_data_tx_data(node_t NODE)
 		SESSION.window_size = NODE.sess_window_size; // the size of window (number of packets/transaction) (adaptive)
 		SESSION.tx_delay 	= NODE.sess_tx_delay; // delay between 2 consecutive send (adaptive)
 		SESSION.time_out 	= 0;
+		SESSION.time_out_setup = 0;		// SESS_TIME_OUT_SETUP
+		SESSION.time_out_data = 0;		// SESS_TIME_OUT_DATA
 		SESSION.guarantee_end = false;	// unused
+		SESSION.tx_class	= SESS_CLASS_BULK;
+		SESSION.due			= 0;
 
 		// ------ Run SESSION ------
 		printf("\n ------------------------------------------------------\n");
-		printf("Debug: --- Session - position: %d %d\n", MYDEBUG.loss_msg_index, i);
+		printf("Debug: --- Session - position: %d %d\n", MYDEBUG.loss_msg_index, FRAME->index);
 		pro_tx(&SESSION);
 
+		// The session is given up (TIME-OUT, UNREACHABLE), the file cannot be completed
+		if (SESSION.status != SESS_STATUS_OK)
+			break;
 
-		// Check with system time-out
-		if (SESSION.time_out < SESS_TIME_OUT)
-		{
-			i += FRAME_SIZE;
+		// The next session is already loaded
+		frame_pool_put(&app_tx_pool, FRAME);
 
 #if DEBUG_INFO == 1		// ----------------------------------------
-			MYDEBUG.loss_msg_total += MYDEBUG.loss_msg_session[MYDEBUG.loss_msg_index];
-			++MYDEBUG.loss_msg_index;
+		MYDEBUG.loss_msg_total += MYDEBUG.loss_msg_session[MYDEBUG.loss_msg_index];
+		++MYDEBUG.loss_msg_index;
 
-			MYDEBUG.crob_total += MYDEBUG.crob_session[MYDEBUG.crob_index];
-			++MYDEBUG.crob_index;
+		MYDEBUG.crob_total += MYDEBUG.crob_session[MYDEBUG.crob_index];
+		++MYDEBUG.crob_index;
 
-			MYDEBUG.crc_invalid_total += MYDEBUG.crc_invalid_session[MYDEBUG.crc_invalid_index];
-			++MYDEBUG.crc_invalid_index;
+		MYDEBUG.crc_invalid_total += MYDEBUG.crc_invalid_session[MYDEBUG.crc_invalid_index];
+		++MYDEBUG.crc_invalid_index;
 
-			MYDEBUG.flen_invalid_total += MYDEBUG.flen_invalid_session[MYDEBUG.flen_invalid_index];
-			++MYDEBUG.flen_invalid_index;
+		MYDEBUG.flen_invalid_total += MYDEBUG.flen_invalid_session[MYDEBUG.flen_invalid_index];
+		++MYDEBUG.flen_invalid_index;
 #endif
-		}
-
-	} while ((SESSION.time_out < SESS_TIME_OUT) && (i < BUFFER.length));
+	}
 
 
-	if (SESSION.time_out >= SESS_TIME_OUT)
+	if (SESSION.status != SESS_STATUS_OK)
 	{
-		printf("Info: --- Exit due to TIME-OUT %d seconds\n", SESS_TIME_OUT/1000000);
+		printf("Info: --- Exit due to %s\n", (SESSION.status == SESS_STATUS_UNREACHABLE) ? "UNREACHABLE" :
+			(SESSION.status == SESS_STATUS_TIME_OUT) ? "TIME-OUT" : "ABORT");
+
+		// The loader may wait for a free frame
+		pthread_cancel(tid);
 	}
+	pthread_join(tid, NULL);
+	frame_pool_free(&app_tx_pool);
 
 #if DEBUG_INFO == 1		// ----------------------------------------
 	debug_print();
 #endif
 
-	free (BUFFER.data);
+	unmapBinaryFile (BUFFER.data, BUFFER.length);
+}
+
+
+// ===========================================================
+//
+// Load the SESSION frames
+//
+// ===========================================================
+void* app_fixed_data_load_data(void *arg)
+{
+	uint32_t i, k, length;
+	long page_size;
+	volatile uint8_t page;
+	appbuff_t *BUFFER;
+	frame_t *FRAME;
+
+	// Initialization
+	BUFFER = (appbuff_t *)arg;
+	page_size = sysconf(_SC_PAGESIZE);
+
+	for (i = 0; i < BUFFER->length; i += FRAME_SIZE)
+	{
+		FRAME = frame_pool_take(&app_tx_pool, true);
+		length = FRAME_SIZE;
+		if ((BUFFER->length - i) < FRAME_SIZE)
+			length = BUFFER->length - i;
+		FRAME->index = i;
+		FRAME->codec = SESS_CODEC_NONE;
+		FRAME->raw_length = length;
+
+		if (app_tx_compress == true)
+		{
+			// Compressed only if it saves 1/16 of the air time
+			FRAME->length = lz_compress(&BUFFER->data[i], length, FRAME->data, length - (length >> 4));
+			if (FRAME->length > 0)
+				FRAME->codec = SESS_CODEC_LZ;
+			else
+			{
+				memcpy(FRAME->data, &BUFFER->data[i], length);
+				FRAME->length = length;
+			}
+			printf("Debug: --- Load %d bytes from position %d, %d bytes to send\n", length, i, FRAME->length);
+		}
+		else
+		{
+			FRAME->data = &BUFFER->data[i];
+			FRAME->length = length;
+
+			// Read the pages from the SD card here, so TX never waits for them
+			for (k = 0; k < FRAME->length; k += page_size)
+				page = FRAME->data[k];
+			(void)page;
+		}
+
+		frame_pool_give(&app_tx_pool, FRAME);
+	}
+
+	frame_pool_end(&app_tx_pool);
+	pthread_exit(NULL);
 }
@@ -0,0 +1,424 @@
+#include "../app_rpi_img/rpi_img.h"
+#include "../at86rf212_param.h"
+#include "../hal/hal_config_wiringpi.h"
+#include "../tal/tal_at86rf212.h"
+#include "../utils/utils.h"
+#include "../utils/rt.h"
+#include "../utils/reactor.h"
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+
+
+#define CAPTURE_READ_SIZE		(4096)		// bytes read from the pipe or inotify at once
+
+// JPEG parser: the frame ends at the EOI of the main image, so that the markers
+// inside the segments (e.g., a thumbnail) and the entropy-coded data are skipped
+enum capture_state {
+	JPEG_SOI_FF,		// waiting for 0xFF of SOI
+	JPEG_SOI,			// waiting for 0xD8 of SOI
+	JPEG_MARKER_FF,		// waiting for 0xFF of a marker
+	JPEG_MARKER,		// waiting for the code of a marker
+	JPEG_LENGTH_H,		// length of the segment
+	JPEG_LENGTH_L,
+	JPEG_SEGMENT,		// body of the segment
+	JPEG_ENTROPY,		// entropy-coded data after SOS
+	JPEG_ENTROPY_FF		// 0xFF in the entropy-coded data
+};
+
+
+// ===========================================================
+//
+// Cancellation of the capture thread (app_rpi_img_capture_stop()),
+// the camera tool and the inotify descriptor are closed
+//
+// ===========================================================
+static void capture_cleanup_pclose(void *arg)
+{
+	pclose((FILE *)arg);
+}
+
+
+#if CAPTURE_SOURCE == 0
+static void capture_cleanup_close(void *arg)
+{
+	close(*(int *)arg);
+}
+#endif
+
+
+// ===========================================================
+//
+// Start the capture
+//
+// ===========================================================
+void app_rpi_img_capture_start(capture_t *CAPTURE)
+{
+	// The files of the camera are mapped, they need no buffer
+#if CAPTURE_SOURCE == 1
+	frame_pool_init(&CAPTURE->POOL, CAPTURE_FRAMES, FRAME_SIZE);
+#else
+	frame_pool_init(&CAPTURE->POOL, CAPTURE_FRAMES, 0);
+#endif
+	CAPTURE->dropped = 0;
+	CAPTURE->state = JPEG_SOI_FF;
+
+	printf("Debug: --- Create thread to capture data\n");
+	pthread_create(&CAPTURE->tid, NULL, app_rpi_img_capture_data, CAPTURE);
+}
+
+
+// ===========================================================
+//
+// Wait for a captured frame
+//
+// ===========================================================
+frame_t* app_rpi_img_capture_get(capture_t *CAPTURE)
+{
+	frame_t *FRAME;
+
+	FRAME = frame_pool_get(&CAPTURE->POOL, CAPTURE_TIME_OUT);
+	if ((FRAME == NULL) && (__atomic_load_n(&CAPTURE->POOL.done, __ATOMIC_ACQUIRE) == false))
+		printf("Debug: --- No frame for %d s\n", CAPTURE_TIME_OUT);
+	return FRAME;
+}
+
+
+// ===========================================================
+//
+// Give a frame back
+//
+// ===========================================================
+void app_rpi_img_capture_put(capture_t *CAPTURE, frame_t *FRAME)
+{
+	frame_pool_put(&CAPTURE->POOL, FRAME);
+}
+
+
+// ===========================================================
+//
+// Stop the capture
+//
+// ===========================================================
+void app_rpi_img_capture_stop(capture_t *CAPTURE)
+{
+#if CAPTURE_SOURCE == 0
+	uint8_t i;
+#endif
+
+	// The camera may still be running after a time-out
+	if (__atomic_load_n(&CAPTURE->POOL.done, __ATOMIC_ACQUIRE) == false)
+		pthread_cancel(CAPTURE->tid);
+	pthread_join(CAPTURE->tid, NULL);
+
+	if (CAPTURE->dropped > 0)
+		printf("Info: --- %d frames are dropped, TX is slower than the camera\n", CAPTURE->dropped);
+
+#if CAPTURE_SOURCE == 0
+	for (i = 0; i < CAPTURE->POOL.num; ++i)
+		unmapBinaryFile(CAPTURE->POOL.frame[i].data, CAPTURE->POOL.frame[i].length);
+#endif
+	frame_pool_free(&CAPTURE->POOL);
+}
+
+
+#if CAPTURE_SOURCE == 1
+// ===========================================================
+//
+// Parse the JPEG stream, return true at the end of a frame
+//
+// ===========================================================
+static uint8_t capture_parse(capture_t *CAPTURE, uint8_t c)
+{
+	switch (CAPTURE->state)
+	{
+		case JPEG_SOI_FF:
+			if (c == 0xFF)
+				CAPTURE->state = JPEG_SOI;
+			break;
+
+		case JPEG_SOI:
+			if (c == 0xD8)
+				CAPTURE->state = JPEG_MARKER_FF;
+			else if (c != 0xFF)
+				CAPTURE->state = JPEG_SOI_FF;
+			break;
+
+		case JPEG_MARKER_FF:
+			if (c == 0xFF)
+				CAPTURE->state = JPEG_MARKER;
+			break;
+
+		case JPEG_MARKER:
+			CAPTURE->marker = c;
+			if (c == 0xD9)								// EOI
+			{
+				CAPTURE->state = JPEG_SOI_FF;
+				return true;
+			}
+			else if ((c == 0xFF) || (c == 0x01) || ((c >= 0xD0) && (c <= 0xD7)))
+				;										// fill byte, TEM, RSTn: no length
+			else
+				CAPTURE->state = JPEG_LENGTH_H;
+			break;
+
+		case JPEG_LENGTH_H:
+			CAPTURE->seg_left = c << 8;
+			CAPTURE->state = JPEG_LENGTH_L;
+			break;
+
+		case JPEG_LENGTH_L:
+			CAPTURE->seg_left += c;
+			CAPTURE->seg_left = (CAPTURE->seg_left > 2) ? (CAPTURE->seg_left - 2) : 0;
+			if (CAPTURE->seg_left > 0)
+				CAPTURE->state = JPEG_SEGMENT;
+			else
+				CAPTURE->state = (CAPTURE->marker == 0xDA) ? JPEG_ENTROPY : JPEG_MARKER_FF;
+			break;
+
+		case JPEG_SEGMENT:
+			if (--CAPTURE->seg_left == 0)
+				CAPTURE->state = (CAPTURE->marker == 0xDA) ? JPEG_ENTROPY : JPEG_MARKER_FF;
+			break;
+
+		case JPEG_ENTROPY:
+			if (c == 0xFF)
+				CAPTURE->state = JPEG_ENTROPY_FF;
+			break;
+
+		case JPEG_ENTROPY_FF:
+			if ((c == 0x00) || ((c >= 0xD0) && (c <= 0xD7)))	// stuffed byte, RSTn
+				CAPTURE->state = JPEG_ENTROPY;
+			else if (c == 0xFF)
+				;
+			else if (c == 0xD9)							// EOI
+			{
+				CAPTURE->state = JPEG_SOI_FF;
+				return true;
+			}
+			else										// next scan of a progressive JPEG
+			{
+				CAPTURE->marker = c;
+				CAPTURE->state = JPEG_LENGTH_H;
+			}
+			break;
+	}
+	return false;
+}
+
+
+// ===========================================================
+//
+// Capture thread: JPEG stream piped from the camera tool
+//
+// ===========================================================
+void* app_rpi_img_capture_data(void *arg)
+{
+	int i, n;
+	uint8_t buf[CAPTURE_READ_SIZE];
+	uint32_t index;
+	FILE *fp;
+	capture_t *CAPTURE;
+	frame_t *FRAME, *NEXT;
+
+	CAPTURE = (capture_t *)arg;
+#if RT_USED == 1
+	rt_thread_other();
+#endif
+
+	printf("Debug: --- Start capturing image ...\n");
+	fp = popen(CAPTURE_CMD, "r");
+	if (fp == NULL)
+	{
+		printf("Debug: --- popen() failed \n");
+		frame_pool_end(&CAPTURE->POOL);
+		pthread_exit(NULL);
+	}
+
+	pthread_cleanup_push(capture_cleanup_pclose, fp);
+
+	index = 0;
+	FRAME = frame_pool_take(&CAPTURE->POOL, true);
+	FRAME->length = 0;
+	while ((n = read(fileno(fp), buf, CAPTURE_READ_SIZE)) > 0)
+	{
+		for (i = 0; i < n; ++i)
+		{
+			// The bytes before SOI are not part of the frame
+			if ((CAPTURE->state == JPEG_SOI_FF) && (buf[i] != 0xFF))
+				continue;
+			if (CAPTURE->state == JPEG_SOI_FF)
+				FRAME->length = 0;
+
+			// length stops at FRAME_SIZE + 1 for a frame which does not fit
+			if (FRAME->length < FRAME_SIZE)
+				FRAME->data[FRAME->length] = buf[i];
+			if (FRAME->length <= FRAME_SIZE)
+				++FRAME->length;
+
+			if (capture_parse(CAPTURE, buf[i]) == false)
+				continue;
+
+			// A frame which does not fit in the buffer is lost
+			if (FRAME->length > FRAME_SIZE)
+			{
+				printf("Info: --- Frame %d is larger than %d bytes, dropped\n", index++, FRAME_SIZE);
+				FRAME->length = 0;
+				continue;
+			}
+
+			// The camera cannot wait: if TX keeps all other buffers, the frame is lost
+			NEXT = frame_pool_take(&CAPTURE->POOL, false);
+			if (NEXT == NULL)
+			{
+				printf("Debug: --- Frame %d dropped, TX is busy\n", index++);
+				++CAPTURE->dropped;
+				FRAME->length = 0;
+				continue;
+			}
+
+			FRAME->index = index++;
+			FRAME->time = reactor_now();
+			frame_pool_give(&CAPTURE->POOL, FRAME);
+			FRAME = NEXT;
+			FRAME->length = 0;
+		}
+	}
+
+	pthread_cleanup_pop(1);
+	printf("Debug: --- End capturing image ...\n");
+	frame_pool_end(&CAPTURE->POOL);
+	pthread_exit(NULL);
+}
+
+#else
+// ===========================================================
+//
+// Map a new file of the camera to FRAME, return true if FRAME is queued
+//
+// ===========================================================
+static uint8_t capture_file(capture_t *CAPTURE, frame_t *FRAME, struct inotify_event *event)
+{
+	char name[256];
+	long frame_length;
+
+	// The file of a sent frame is not used any more
+	unmapBinaryFile(FRAME->data, FRAME->length);
+	FRAME->data = NULL;
+	FRAME->length = 0;
+
+	// img<N>.jpg, the temporary files of the camera tool are skipped
+	if ((event->len == 0) || (strncmp(event->name, IMG_PREFIX, strlen(IMG_PREFIX)) != 0) ||
+		(strlen(event->name) < 4) || (strcmp(&event->name[strlen(event->name) - 4], ".jpg") != 0))
+		return false;
+
+	// Make the full path
+	strcpy(name, IMG_DIR);
+	strcat(name, "/");
+	strncat(name, event->name, sizeof(name) - strlen(name) - 1);
+
+	// TX sends from the pages of the file, a file larger than FRAME_SIZE in several sessions
+	FRAME->data = mapBinaryFile(&name[0], &frame_length, 1);
+	printf("Debug: --- Capture %s, frame_length = %ld\n", name, frame_length);
+	if (FRAME->data == NULL)
+		return false;
+
+	// The number of the file, the numbers may have gaps
+	FRAME->length = frame_length;
+	FRAME->index = atoi(&event->name[strlen(IMG_PREFIX)]);
+	FRAME->time = reactor_now();
+	frame_pool_give(&CAPTURE->POOL, FRAME);
+	return true;
+}
+
+
+// ===========================================================
+//
+// Capture thread: img<N>.jpg files written by the camera tool
+//
+// ===========================================================
+void* app_rpi_img_capture_data(void *arg)
+{
+	int fd, wd, n, k;
+	uint8_t buf[CAPTURE_READ_SIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
+	struct inotify_event *event;
+	struct pollfd fds[2];
+	FILE *fp;
+	capture_t *CAPTURE;
+	frame_t *FRAME;
+
+	CAPTURE = (capture_t *)arg;
+#if RT_USED == 1
+	rt_thread_other();
+#endif
+	FRAME = NULL;
+
+	// The directory is watched before the camera is started, so no file is missed.
+	// A file is complete when it is closed, or renamed into the directory
+	fd = inotify_init();
+	wd = (fd < 0) ? -1 : inotify_add_watch(fd, IMG_DIR, IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (wd < 0)
+	{
+		printf("Debug: --- inotify on %s failed \n", IMG_DIR);
+		if (fd >= 0)
+			close(fd);
+		frame_pool_end(&CAPTURE->POOL);
+		pthread_exit(NULL);
+	}
+	pthread_cleanup_push(capture_cleanup_close, &fd);
+
+	printf("Debug: --- Start capturing image ...\n");
+	fp = popen(CAPTURE_FILE_CMD, "r");
+	if (fp == NULL)
+	{
+		printf("Debug: --- popen() failed \n");
+		frame_pool_end(&CAPTURE->POOL);
+		pthread_exit(NULL);				// fd is closed by the cleanup handler
+	}
+	pthread_cleanup_push(capture_cleanup_pclose, fp);
+
+	fds[0].fd = fd;
+	fds[0].events = POLLIN;
+	fds[1].fd = fileno(fp);
+	fds[1].events = POLLIN;
+
+	// Sleep until a file is written; the camera closes the pipe when it ends
+	while (1)
+	{
+		n = poll(fds, 2, 1000 * CAPTURE_TIME_OUT);
+		if ((n < 0) && (errno == EINTR))
+			continue;
+		if (n <= 0)
+		{
+			printf("Debug: --- No image for %d s\n", CAPTURE_TIME_OUT);
+			break;
+		}
+
+		// The events come in the order the files are completed
+		if (fds[0].revents & POLLIN)
+		{
+			n = read(fd, buf, CAPTURE_READ_SIZE);
+			for (k = 0; k < n; k += sizeof(struct inotify_event) + event->len)
+			{
+				event = (struct inotify_event *)&buf[k];
+
+				// The files stay on the disk, wait until TX gives a buffer back
+				if (FRAME == NULL)
+					FRAME = frame_pool_take(&CAPTURE->POOL, true);
+				if (capture_file(CAPTURE, FRAME, event) == true)
+					FRAME = NULL;
+			}
+		}
+
+		// End of the camera, after its last file
+		else if ((fds[1].revents != 0) && (read(fds[1].fd, buf, CAPTURE_READ_SIZE) <= 0))
+			break;
+	}
+
+	pthread_cleanup_pop(1);
+	printf("Debug: --- End capturing image ...\n");
+	pthread_cleanup_pop(1);
+	frame_pool_end(&CAPTURE->POOL);
+	pthread_exit(NULL);
+}
+#endif
@@ -0,0 +1,131 @@
+#include "../app_rpi_img/rpi_img.h"
+#include "../at86rf212_param.h"
+
+
+// ===========================================================
+//
+// Set the bits of the packets of [start, end) in must
+//
+// ===========================================================
+static void app_rpi_img_jpeg_must(uint8_t *must, uint16_t packet_length, uint32_t start, uint32_t end)
+{
+	uint32_t pktid;
+
+	if (end <= start)
+		return;
+	for (pktid = start / packet_length; pktid <= ((end - 1) / packet_length); ++pktid)
+		must[pktid >> 3] |= (0x1 << (pktid % 8));
+}
+
+
+// ===========================================================
+//
+// Frame a JPEG for the packets of a session
+//
+// ===========================================================
+uint32_t app_rpi_img_jpeg_frame(uint8_t *src, uint32_t length, uint8_t *dst, uint16_t packet_length, uint8_t *must)
+{
+	uint32_t i, o, seg_length, scan_start, group_start;
+	uint8_t marker, ns, se, progressive, restart, scan_must;
+
+	if ((length < 4) || (src[0] != 0xFF) || (src[1] != 0xD8))
+		return 0;
+
+	memset(must, 0, ((FRAME_SIZE / packet_length) >> 3) + 1);
+	progressive = false;
+	restart = false;
+	i = 0;
+	o = 0;
+
+	while (i < length)
+	{
+		// Marker, its fill bytes are dropped
+		if (src[i] != 0xFF)
+			return 0;
+		while ((i < length) && (src[i] == 0xFF))
+			++i;
+		if ((i >= length) || ((o + 2) > FRAME_SIZE))
+			return 0;
+		marker = src[i++];
+		dst[o++] = 0xFF;
+		dst[o++] = marker;
+		app_rpi_img_jpeg_must(must, packet_length, o - 2, o);
+
+		if (marker == 0xD8)											// SOI
+			continue;
+		if (marker == 0xD9)											// EOI
+			return ((progressive == true) || (restart == true)) ? o : 0;
+
+		// Segment, all of them are needed to decode the image
+		if ((i + 2) > length)
+			return 0;
+		seg_length = (src[i] << 8) + src[i + 1];
+		if ((seg_length < 2) || ((i + seg_length) > length) || ((o + seg_length) > FRAME_SIZE))
+			return 0;
+		memcpy(&dst[o], &src[i], seg_length);
+		app_rpi_img_jpeg_must(must, packet_length, o, o + seg_length);
+
+		if ((marker == 0xC2) || (marker == 0xC6) || (marker == 0xCA) || (marker == 0xCE))	// SOFn, progressive
+			progressive = true;
+		if ((marker == 0xDD) && (seg_length >= 4) && (((src[i + 2] << 8) + src[i + 3]) > 0))	// DRI
+			restart = true;
+
+		scan_must = false;
+		if (marker == 0xDA)											// SOS
+		{
+			// DC and low-frequency scans of a progressive JPEG are needed for a coarse image
+			ns = src[i + 2];
+			if ((uint32_t)(5 + (ns << 1)) > seg_length)
+				return 0;
+			se = src[i + 3 + (ns << 1) + 1];
+			scan_must = (progressive == true) && (se <= JPEG_MUST_SE);
+		}
+		i += seg_length;
+		o += seg_length;
+		if (marker != 0xDA)
+			continue;
+
+		// Entropy-coded data, up to the marker after the scan
+		scan_start = o;
+		group_start = o;
+		while (i < length)
+		{
+			if ((o + 2) > FRAME_SIZE)
+				return 0;
+
+			if (src[i] != 0xFF)
+				dst[o++] = src[i++];
+			else if ((i + 1) >= length)
+				return 0;
+			else if (src[i + 1] == 0x00)							// stuffed byte
+			{
+				dst[o++] = src[i++];
+				dst[o++] = src[i++];
+			}
+			else if (src[i + 1] == 0xFF)							// fill byte
+				++i;
+			else if ((src[i + 1] >= 0xD0) && (src[i + 1] <= 0xD7))	// RSTn
+			{
+				// The marker starts a packet, once JPEG_GROUP packets are sent since the last one,
+				// so that a lost packet only damages the restart intervals of its group
+				if (((o / packet_length) >= ((group_start / packet_length) + JPEG_GROUP)) &&
+					((o + packet_length + 2) <= FRAME_SIZE))
+				{
+					while ((o % packet_length) != 0)
+						dst[o++] = 0xFF;
+					group_start = o;
+				}
+				dst[o++] = src[i++];
+				dst[o++] = src[i++];
+			}
+			else
+				break;
+		}
+
+		if (scan_must == true)
+			app_rpi_img_jpeg_must(must, packet_length, scan_start, o);
+	}
+
+	// No EOI
+	return 0;
+}
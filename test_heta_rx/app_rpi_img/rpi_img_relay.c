@@ -0,0 +1,87 @@
+#include "../app_rpi_img/rpi_img.h"
+#include "../at86rf212_param.h"
+#include "../hal/hal_config_wiringpi.h"
+#include "../tal/tal_at86rf212.h"
+#include "../protocol/protocol.h"
+#include "../protocol/protocol_link.h"
+#include "../protocol/protocol_relay.h"
+#include "../protocol/protocol_route.h"
+#include "../protocol/protocol_sess.h"
+#include "../utils/utils.h"
+#include "../utils/rt.h"
+#include "../mydebug/mydebug.h"
+
+
+// ===========================================================
+//
+// Relay app
+//
+// ===========================================================
+void app_rpi_img_relay_data(node_t NODE, uint16_t up_addr)
+{
+	uint16_t n, failed;
+	uint8_t result;
+	relay_t *RELAY;
+
+
+	printf("Info: --- ============================================ \n");
+	printf("Info: --- Relaying image data ... \n");
+	printf("Info: --- ============================================ \n");
+
+	// ------ Initialize DEBUG  ------
+#if DEBUG_INFO == 1
+	debug_init();
+#endif
+
+	at86rfx_frame_rx = false;
+	link_init(NODE.src_addr);
+#if SAR_USED_ROUTE == 1
+	// Any previous hop, the next hop is given by the routes
+	route_init(NODE.src_addr, SINK_ADDR);
+	up_addr = SESS_ADDR_ANY;
+#endif
+
+	// ------ Initialize RELAY information  ------
+	RELAY = (relay_t*) calloc (1, sizeof(relay_t));
+	if (RELAY == NULL)
+	{
+		printf("Info: --- Not enough memory to relay data ... \n");
+		exit (1);
+	}
+	RELAY->SESS_UP.frame_data = (uint8_t*) calloc (FRAME_SIZE, sizeof(uint8_t));
+	if (RELAY->SESS_UP.frame_data == NULL)
+	{
+		printf("Info: --- Not enough memory to store data file ... \n");
+		exit (1);
+	}
+#if RT_USED == 1
+	rt_init();
+	rt_thread_radio();
+#endif
+	pro_relay_init(RELAY, NODE.src_addr, up_addr, NODE.dest_addr, RELAY->SESS_UP.frame_data);
+
+	// ------ Relay each frame until time-out, a frame given up by the next hop is skipped ------
+	n = 0;
+	failed = 0;
+	while ((result = pro_relay(RELAY)) != PRO_RELAY_TIME_OUT)
+	{
+		if (result == PRO_RELAY_OK)
+		{
+			++n;
+			printf("Info: --- --- Frame %d is relayed, %d bytes\n", n, RELAY->SESS_UP.frame_length);
+		}
+		else
+		{
+			++failed;
+			printf("Info: --- --- Frame is given up by the next hop, next frame\n");
+		}
+	}
+	printf("Info: --- Time-out, %d frames are relayed, %d frames are given up\n", n, failed);
+
+#if DEBUG_INFO == 1		// ----------------------------------------
+	debug_print();
+#endif
+
+	free(RELAY->SESS_UP.frame_data);
+	free(RELAY);
+}
@@ -3,10 +3,38 @@
 #include "../hal/hal_config_wiringpi.h"
 #include "../tal/tal_at86rf212.h"
 #include "../protocol/protocol.h"
+#include "../protocol/protocol_link.h"
+#include "../protocol/protocol_route.h"
+#include "../protocol/protocol_sess.h"
 #include "../utils/utils.h"
+#include "../utils/rt.h"
+#include "../utils/lz.h"
 #include "../mydebug/mydebug.h"
 
 
+// Framed JPEG and its needed packets (JPEG_FRAMER)
+static uint8_t *app_jpeg_data;
+static uint8_t app_jpeg_must[JPEG_MUST_SIZE];
+
+// Last frame received in full by RX and the delta frame (DELTA_USED)
+static uint8_t *app_ref_data;
+static uint32_t app_ref_length;
+static uint16_t app_ref_id;
+static uint8_t *app_delta_data;
+
+// Producers of the event loop: the video thread waits for the end of each frame,
+// the telemetry thread sends one message at a time
+static node_t app_tx_node;
+static capture_t app_capture;
+static sess_t app_video_sess;
+static sem_t app_video_done;			// the loop has closed the video session
+static uint32_t app_video_sent;			// frames received by RX
+static uint32_t app_video_failed;		// frames not sent (time-out, dropped, ...)
+static sess_t app_telemetry_sess;
+static uint8_t app_telemetry_data[TELEMETRY_SIZE];
+static uint8_t app_telemetry_busy;		// the telemetry session is not closed yet
+static uint8_t app_tx_stop;				// the capture is at its end
+
 // ===========================================================
 //
 // App init
@@ -25,101 +53,333 @@ void app_rpi_img_init()
 
 // ===========================================================
 //
-// Read image from file and send to RX
+// Give a session to the event loop
 //
 // ===========================================================
-void app_rpi_img_send_data(node_t NODE)
+static uint8_t app_rpi_img_send_sess(sess_t *SESSION)
 {
-	uint16_t i, n;
-	uint16_t time_out;
-	char cmd[256];
-	char cmd_sub[32];
-	sess_t SESSION;
+	SESSION->num_of_packet = SESSION->frame_length / SESSION->packet_length;
+	if ((SESSION->frame_length % SESSION->packet_length) != 0)
+		++SESSION->num_of_packet;
+	SESSION->window_size = PACKETS_PER_TRANS; // the size of window (number of packets/transaction) (adaptive)
+	SESSION->time_out = 0;
+	SESSION->time_out_setup = 0;		// SESS_TIME_OUT_SETUP
+	SESSION->time_out_data = 0;			// SESS_TIME_OUT_DATA
+	return pro_sess_tx_submit(SESSION);
+}
 
 
-	// Initialization
-	SESSION.frame_data = (uint8_t*) calloc (FRAME_SIZE, sizeof(uint8_t));
-	if (SESSION.frame_data == NULL)
+// ===========================================================
+//
+// Send the frame of a session, wait for its end
+//
+// ===========================================================
+static void app_rpi_img_send_frame(sess_t *SESSION)
+{
+	if (app_rpi_img_send_sess(SESSION) == true)
+		sem_wait(&app_video_done);
+	else
+		SESSION->status = SESS_STATUS_DROPPED;
+
+	if (SESSION->status != SESS_STATUS_OK)
+		printf("Info: --- Frame of session %d is not sent (status %d), next frame\n", SESSION->sess_id, SESSION->status);
+}
+
+
+// ===========================================================
+//
+// End of a TX session (event loop)
+//
+// ===========================================================
+static void app_rpi_img_send_end(sess_t *SESSION)
+{
+	if (SESSION == &app_telemetry_sess)
 	{
-		printf("Info: --- Not enough memory to store data file ... \n");
-		exit (1);
+		if (SESSION->status != SESS_STATUS_OK)
+			printf("Info: --- Telemetry of session %d is not sent (status %d)\n", SESSION->sess_id, SESSION->status);
+		__atomic_store_n(&app_telemetry_busy, false, __ATOMIC_RELEASE);
+		return;
 	}
 
 #if DEBUG_INFO == 1		// ----------------------------------------
-	debug_init();
+	MYDEBUG.loss_msg_total += MYDEBUG.loss_msg_session[MYDEBUG.loss_msg_index];
+	++MYDEBUG.loss_msg_index;
+
+	MYDEBUG.crob_total += MYDEBUG.crob_session[MYDEBUG.crob_index];
+	++MYDEBUG.crob_index;
+
+	MYDEBUG.crc_invalid_total += MYDEBUG.crc_invalid_session[MYDEBUG.crc_invalid_index];
+	++MYDEBUG.crc_invalid_index;
+
+	MYDEBUG.flen_invalid_total += MYDEBUG.flen_invalid_session[MYDEBUG.flen_invalid_index];
+	++MYDEBUG.flen_invalid_index;
 #endif
+	sem_post(&app_video_done);
+}
+
 
+#if TELEMETRY_PERIOD > 0
+// ===========================================================
+//
+// Telemetry producer: a CONTROL session every TELEMETRY_PERIOD
+//
+// ===========================================================
+static void* app_rpi_img_send_telemetry(void *arg)
+{
+	sess_t *SESSION;
+	int length;
 
-	n = 0;
-	time_out = 0;
-	// If time_out, exit this function; 50 * 200ms = 10s
-	while (time_out < 50)
+	(void)arg;
+	SESSION = &app_telemetry_sess;
+	while (__atomic_load_n(&app_tx_stop, __ATOMIC_ACQUIRE) == false)
 	{
-		i = n;
-		while ((i == n) || (i == n + 1))
+		usleep(TELEMETRY_PERIOD);
+
+		// The last message is not sent yet: this one is skipped
+		if (__atomic_load_n(&app_telemetry_busy, __ATOMIC_ACQUIRE) == true)
+			continue;
+
+		length = snprintf((char*)app_telemetry_data, TELEMETRY_SIZE, TELEMETRY_TAG "node 0x%04x, %d frames sent, %d frames not sent",
+						  app_tx_node.src_addr, __atomic_load_n(&app_video_sent, __ATOMIC_RELAXED), __atomic_load_n(&app_video_failed, __ATOMIC_RELAXED));
+		if (length >= TELEMETRY_SIZE)
+			length = TELEMETRY_SIZE - 1;
+
+		SESSION->link_mode	= LINK_MODE_DEFAULT;
+		SESSION->packet_length = LINK_SCPL(SESSION->link_mode);
+		SESSION->src_addr	= app_tx_node.src_addr;
+		SESSION->dest_addr	= app_tx_node.dest_addr;
+#if SAR_USED_ROUTE == 1
+		if (route_next_hop() != ROUTE_ADDR_NONE)
+			SESSION->dest_addr = route_next_hop();
+#endif
+		SESSION->tx_delay	= 80;
+		SESSION->tx_class	= SESS_CLASS_CONTROL;
+		SESSION->due		= 0;
+		SESSION->codec		= SESS_CODEC_NONE;
+		SESSION->ref_id		= SESS_REF_NONE;
+		SESSION->frame_data	= app_telemetry_data;
+		SESSION->frame_length = length;
+		SESSION->raw_length	= length;
+		SESSION->deadline	= 0;
+		SESSION->must		= NULL;
+
+		__atomic_store_n(&app_telemetry_busy, true, __ATOMIC_RELEASE);
+		if (app_rpi_img_send_sess(SESSION) == false)
+			__atomic_store_n(&app_telemetry_busy, false, __ATOMIC_RELEASE);
+	}
+	return NULL;
+}
+#endif
+
+
+// ===========================================================
+//
+// Video producer: the captured frames, one session at a time
+//
+// ===========================================================
+static void* app_rpi_img_send_video(void *arg)
+{
+	sess_t *SESSION;
+	frame_t *FRAME;
+	uint8_t *data, *must;
+	uint32_t length, deadline, offset;
+
+	(void)arg;
+	SESSION = &app_video_sess;
+	while ((FRAME = app_rpi_img_capture_get(&app_capture)) != NULL)
+	{
+		printf("Debug: --- Process frame %d, frame_length = %d\n", FRAME->index, FRAME->length);
+		data = FRAME->data;
+		length = FRAME->length;
+		deadline = 0;
+		must = NULL;
+
+		// ------ Initialize SESSION information  ------
+		SESSION->link_mode	= LINK_MODE_DEFAULT;
+		SESSION->packet_length = LINK_SCPL(SESSION->link_mode);
+#if JPEG_FRAMER == 1
+		// A late packet which only damages some restart intervals or the fine scans is given up
+		length = 0;
+		if (FRAME->length <= FRAME_SIZE)
+			length = app_rpi_img_jpeg_frame(FRAME->data, FRAME->length, app_jpeg_data, SESSION->packet_length, app_jpeg_must);
+		if (length > 0)
 		{
-			// Make the full path
-			strcpy(cmd, "/home/pi/my_code/tmp/data/img");
-			int2str(i, cmd_sub, 10);
-			strcat(cmd, cmd_sub);
-			strcat(cmd, ".jpg");
-
-			// Read the file
-			SESSION.frame_length = writeBinaryFileToArray (&cmd[0], &SESSION.frame_data[0]);
-
-			// If file is not available yet or mmap skip this file index
-			if (SESSION.frame_length == 0)
-			{
-				++i;
-				if (i == n + 2)
+			printf("Debug: --- Framed JPEG, frame_length = %d\n", length);
+			data = app_jpeg_data;
+			deadline = JPEG_DEADLINE;
+			must = app_jpeg_must;
+		}
+		else
+			length = FRAME->length;
+#endif
+
+		SESSION->src_addr = app_tx_node.src_addr;
+		SESSION->dest_addr = app_tx_node.dest_addr;
+#if SAR_USED_ROUTE == 1
+		// Next hop to the sink, the fixed address until a route is known
+		if (route_next_hop() != ROUTE_ADDR_NONE)
+			SESSION->dest_addr = route_next_hop();
+#endif
+		SESSION->tx_delay 	= 80; // delay between 2 consecutive send (adaptive)
+		SESSION->tx_class	= SESS_CLASS_VIDEO;
+		SESSION->due		= (FRAME->time > 0) ? (FRAME->time + CAPTURE_STALE) : 0;
+
+#if DELTA_USED == 1
+		// Difference to the last frame received in full by RX, if it saves 1/16 of the air time.
+		// A delta frame cannot be decoded from partial data, it has no deadline
+		SESSION->codec = SESS_CODEC_DELTA;
+		SESSION->ref_id = app_ref_id;
+		SESSION->frame_length = 0;
+		if ((app_ref_id != SESS_REF_NONE) && (length <= FRAME_SIZE))
+			SESSION->frame_length = lz_compress_dict(app_ref_data, app_ref_length, data, length, app_delta_data, length - (length >> 4));
+		if (SESSION->frame_length > 0)
+		{
+			printf("Debug: --- Delta to frame of session %d, frame_length = %d\n", app_ref_id, SESSION->frame_length);
+			SESSION->frame_data = app_delta_data;
+			SESSION->raw_length = length;
+			SESSION->deadline = 0;
+			SESSION->must = NULL;
+			app_rpi_img_send_frame(SESSION);
+		}
+
+		// No delta, or RX refuses it: the frame is sent in full
+		if ((SESSION->frame_length == 0) || (SESSION->codec == SESS_CODEC_NONE))
+#endif
+		{
+			// A frame larger than FRAME_SIZE (a mapped file) is cut into parts,
+			// one session each, which RX appends to the same file
+			SESSION->deadline = deadline;
+			SESSION->must = must;
+			offset = 0;
+			do {
+				SESSION->codec = SESS_CODEC_NONE;		// JPEG
+				SESSION->frame_data = &data[offset];
+				SESSION->frame_length = (length - offset > FRAME_SIZE) ? FRAME_SIZE : (length - offset);
+				if (length > FRAME_SIZE)
 				{
-					hal_delay_ms(100);
-					++time_out;
+					SESSION->codec = SESS_CODEC_PART;
+					SESSION->raw_length = (length - offset - 1) / FRAME_SIZE;
+					printf("Debug: --- Part at %d of frame %d, %d parts follow\n", offset, FRAME->index, SESSION->raw_length);
 				}
-			}
+				app_rpi_img_send_frame(SESSION);
+				offset += SESSION->frame_length;
+			} while ((offset < length) && (SESSION->status == SESS_STATUS_OK));
+		}
 
-			// Otherwise, send the file
-			else
-			{
-				printf("Debug: --- Process %s, frame_length = %d\n", cmd, SESSION.frame_length);
-				time_out = 0;
-				n = i + 1;
+#if DELTA_USED == 1
+		// The frame is the next reference if RX has received all of it.
+		// A dropped frame is never started, RX keeps the last reference
+		if (SESSION->status != SESS_STATUS_DROPPED)
+			app_ref_id = SESS_REF_NONE;
+		if ((SESSION->status == SESS_STATUS_OK) && (SESSION->lost == 0) && (length <= FRAME_SIZE))
+		{
+			memcpy(app_ref_data, data, length);
+			app_ref_length = length;
+			app_ref_id = SESSION->sess_id;
+		}
+#endif
+		if (SESSION->status == SESS_STATUS_OK)
+			__atomic_add_fetch(&app_video_sent, 1, __ATOMIC_RELAXED);
+		else
+			__atomic_add_fetch(&app_video_failed, 1, __ATOMIC_RELAXED);
 
-				// ------ Initialize SESSION information  ------
-				SESSION.packet_length = SCPL;
-				SESSION.num_of_packet = SESSION.frame_length / SESSION.packet_length;
-				if ((SESSION.frame_length % SESSION.packet_length) != 0)
-					++SESSION.num_of_packet;
+		app_rpi_img_capture_put(&app_capture, FRAME);
+	}
 
-				SESSION.src_addr = NODE.src_addr;
-				SESSION.dest_addr = NODE.dest_addr;
-				SESSION.window_size = PACKETS_PER_TRANS; // the size of window (number of packets/transaction) (adaptive)
-				SESSION.tx_delay 	= 80; // delay between 2 consecutive send (adaptive)
-				SESSION.time_out 	= 0;
+	// The telemetry stops, the loop returns after the last session
+	__atomic_store_n(&app_tx_stop, true, __ATOMIC_RELEASE);
+	pro_sess_stop();
+	return NULL;
+}
 
-				// pro_tx(SESSION);
 
-#if DEBUG_INFO == 1		// ----------------------------------------
-		MYDEBUG.loss_msg_total += MYDEBUG.loss_msg_session[MYDEBUG.loss_msg_index];
-		++MYDEBUG.loss_msg_index;
+// ===========================================================
+//
+// Capture images from the camera and send to RX
+//
+// ===========================================================
+void app_rpi_img_send_data(node_t NODE)
+{
+	pthread_t video, telemetry;
 
-		MYDEBUG.crob_total += MYDEBUG.crob_session[MYDEBUG.crob_index];
-		++MYDEBUG.crob_index;
 
-		MYDEBUG.crc_invalid_total += MYDEBUG.crc_invalid_session[MYDEBUG.crc_invalid_index];
-		++MYDEBUG.crc_invalid_index;
+	// Initialization
+	link_init(NODE.src_addr);
+#if SAR_USED_ROUTE == 1
+	route_init(NODE.src_addr, SINK_ADDR);
+#endif
 
-		MYDEBUG.flen_invalid_total += MYDEBUG.flen_invalid_session[MYDEBUG.flen_invalid_index];
-		++MYDEBUG.flen_invalid_index;
+#if DEBUG_INFO == 1		// ----------------------------------------
+	debug_init();
 #endif
-			}
-		}
+
+#if JPEG_FRAMER == 1
+	app_jpeg_data = (uint8_t*) calloc (FRAME_SIZE, sizeof(uint8_t));
+	if (app_jpeg_data == NULL)
+	{
+		printf("Info: --- Not enough memory to store data file ... \n");
+		exit (1);
+	}
+#endif
+
+#if DELTA_USED == 1
+	app_ref_data = (uint8_t*) calloc (FRAME_SIZE, sizeof(uint8_t));
+	app_delta_data = (uint8_t*) calloc (FRAME_SIZE, sizeof(uint8_t));
+	if ((app_ref_data == NULL) || (app_delta_data == NULL))
+	{
+		printf("Info: --- Not enough memory to store data file ... \n");
+		exit (1);
+	}
+	app_ref_length = 0;
+	app_ref_id = SESS_REF_NONE;
+#endif
+
+	app_tx_node = NODE;
+	app_tx_stop = false;
+	app_telemetry_busy = false;
+	app_video_sent = 0;
+	app_video_failed = 0;
+	sem_init(&app_video_done, 0, 0);
+
+	// The next frame is captured while this one is sent, the frames and the telemetry are
+	// prepared by their own threads and sent by the event loop of this thread
+	app_rpi_img_capture_start(&app_capture);
+	if (pthread_create(&video, NULL, app_rpi_img_send_video, NULL) != 0)
+	{
+		printf("Info: --- Cannot create the video thread ... \n");
+		exit (1);
 	}
+#if TELEMETRY_PERIOD > 0
+	if (pthread_create(&telemetry, NULL, app_rpi_img_send_telemetry, NULL) != 0)
+	{
+		printf("Info: --- Cannot create the telemetry thread ... \n");
+		exit (1);
+	}
+#endif
+#if RT_USED == 1
+	// After the other threads are created, so they do not inherit SCHED_FIFO
+	rt_init();
+	rt_thread_radio();
+#endif
+	pro_sess_serve(app_rpi_img_send_end, NULL);
+
+	pthread_join(video, NULL);
+#if TELEMETRY_PERIOD > 0
+	pthread_join(telemetry, NULL);
+#else
+	(void)telemetry;
+#endif
+	sem_destroy(&app_video_done);
+	app_rpi_img_capture_stop(&app_capture);
+#if JPEG_FRAMER == 1
+	free(app_jpeg_data);
+#endif
+#if DELTA_USED == 1
+	free(app_ref_data);
+	free(app_delta_data);
+#endif
 
 #if DEBUG_INFO == 1		// ----------------------------------------
 	debug_print();
 #endif
-	free (SESSION.frame_data);
 }
-
-
@@ -55,7 +55,7 @@
 // *******************************************************************************************
 // Write access command of the transceiver
 #define WRITE_ACCESS_COMMAND            (0xC0)
-// Read access command to the tranceiver
+// Read access command to the transceiver
 #define READ_ACCESS_COMMAND             (0x80)
 // Frame write command of transceiver
 #define TRX_CMD_FW                      (0x60)
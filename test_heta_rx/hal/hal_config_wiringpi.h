@@ -1,10 +1,16 @@
+#include "../utils/pace.h"
+
 // ***********************************************************
 // Redefine the wiringPi library
 // ***********************************************************
 #define LibSetup()						wiringPiSetup()
-// SPI
+// SPI 0
 #define hal_SPI0Setup(a1)				wiringPiSPISetup(LOW, a1)				// a1: clock speed in Hz	
 #define hal_SPI0DataRW(a1, a2)			wiringPiSPIDataRW(LOW, a1, a2)			// a1: pointer to data, a2: length
+// SPI 1
+#define hal_SPI1Setup(a1)				wiringPiSPISetup(HIGH, a1)				// a1: clock speed in Hz	
+#define hal_SPI1DataRW(a1, a2)			wiringPiSPIDataRW(HIGH, a1, a2)			// a1: pointer to data, a2: length
+
 // GPIO
 #define hal_GPIOSetPin(a1)				digitalWrite(a1, HIGH)					// a1: pin number
 #define hal_GPIOClearPin(a1)			digitalWrite(a1, LOW)					// a1: pin number
@@ -17,11 +23,6 @@
 #define hal_GPIOISRAnyEdge(a1, a2)		wiringPiISR(a1, INT_EDGE_BOTH, a2)		// a1: pin number, a2: pointer to function
 //
 #define hal_delay_ms(a1)				usleep(1000*a1)
-#define hal_delay_us(a1)				usleep(a1)
-#define hal_delay_ns(a1) \
-    { \
-        unsigned char a1_div_16 = a1/16; \
-		while (a1_div_16 > 0) \
-			a1_div_16 = a1_div_16 - 1; \
-    }
+#define hal_delay_us(a1)				pace_delay_us(a1)						// calibrated by pace_init() (utils/pace.h)
+#define hal_delay_ns(a1)				pace_delay_ns(a1)
 	
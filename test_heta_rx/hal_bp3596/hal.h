@@ -0,0 +1,46 @@
+/*
+ * hal.h
+ *
+ * HAL functions of the Lazurite board which are called by the ML7396 driver (ml7396.c)
+ */
+
+#ifndef HAL_BP3596_HAL_H_
+#define HAL_BP3596_HAL_H_
+
+#include <stdint.h>
+
+#include "../hal/hal_config_wiringpi.h"
+
+
+// *******************************************************************************************
+#define HAL_delayMicroseconds(a1)		hal_delay_us(a1)
+// The driver masks the external interrupt while it waits for the ACK,
+// SINTN is already kept out by ml7396_hwif_sint_di()
+#define HAL_EX_disableInterrupt()
+#define HAL_EX_enableInterrupt()
+
+
+// ===============================================================================================================================
+// *******************************************************************************************
+// Function:
+//		int HAL_I2C_read(uint8_t slave_addr, uint8_t reg_addr, uint8_t *data, uint8_t size)
+//
+// Description:
+//		The Lazurite board reads its MAC address from the EEPROM to seed the random
+//		back-off of the CSMA. There is no EEPROM on the Raspberry Pi, the bytes come
+//		from the clock
+//
+// Parameters:
+//		slave_addr	- I2C address (unused)
+//		reg_addr	- EEPROM address (unused)
+//		data		- Read bytes
+//		size		- Number of bytes
+//
+// Return:
+//		0
+//
+// *******************************************************************************************
+int HAL_I2C_read(uint8_t slave_addr, uint8_t reg_addr, uint8_t *data, uint8_t size);
+
+
+#endif /* HAL_BP3596_HAL_H_ */
@@ -14,6 +14,15 @@
 #include "hal_bp3596_config_pin.h"
 
 
+// *******************************************************************************************
+// Definition for commands: Write/Read + Register/Frame/SRAM
+// *******************************************************************************************
+// Write access command of the transceiver
+#define BP3596_WAC     (0x01)
+// Read access command to the transceiver
+#define BP3596_RAC     (0x00)
+
+
 // ===============================================================================================================================
 // *******************************************************************************************
 // Function:
@@ -33,5 +42,9 @@
 void hal_bp3596_power_en(uint8_t enable);
 
 
+void hal_bp3596_init();
+
+
+
 
 #endif /* HAL_BP3596_HAL_BP3596_H_ */
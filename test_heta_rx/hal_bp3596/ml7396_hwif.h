@@ -0,0 +1,151 @@
+/*
+ * ml7396_hwif.h
+ *
+ * Hardware interface of the ML7396 driver (ml7396.c) on the Raspberry Pi:
+ * SPI channel 1, the reset pin, SINTN on a GPIO interrupt and a one-shot
+ * millisecond timer. The SINTN handler and the timer handler run in their own
+ * threads, the di/ei functions keep them out of em_main() like the interrupt
+ * masks of the original micro-controller.
+ */
+
+#ifndef HAL_BP3596_ML7396_HWIF_H_
+#define HAL_BP3596_ML7396_HWIF_H_
+
+#include <stdint.h>
+
+
+// *******************************************************************************************
+#define ML7396_HWIF_RST_US		(1000)		// us, reset pulse
+#define ML7396_HWIF_BOOT_US		(2000)		// us, the ML7396 starts its clock after the reset
+
+// Register setting of ml7396_hwif_regset(), a table ends with bank ML7396_HWIF_REG_END
+#define ML7396_HWIF_REG_END		(0xFF)
+
+typedef struct
+{
+	uint8_t bank;
+	uint8_t addr;
+	uint8_t data;
+} ml7396_hwif_reg_t;
+
+
+// ===============================================================================================================================
+// *******************************************************************************************
+// Function:
+//		int ml7396_hwif_init(void)
+//
+// Description:
+//		Reset the ML7396, set up the SINTN interrupt and start the timer thread.
+//		hal_bp3596_init() must be already called (wiringPi, SPI1 and pins)
+//
+// Parameters:
+//		None
+//
+// Return:
+//		0 if succeeded, -1 otherwise
+//
+// *******************************************************************************************
+int ml7396_hwif_init(void);
+
+
+// *******************************************************************************************
+// Function:
+//		int ml7396_hwif_spi_transfer(const uint8_t *wdata, uint8_t *rdata, uint16_t size)
+//
+// Description:
+//		Full-duplex SPI transfer on channel 1
+//
+// Parameters:
+//		wdata	- Bytes to send
+//		rdata	- Received bytes, size bytes
+//		size	- Number of bytes
+//
+// Return:
+//		0 if succeeded, -1 otherwise
+//
+// *******************************************************************************************
+int ml7396_hwif_spi_transfer(const uint8_t *wdata, uint8_t *rdata, uint16_t size);
+
+
+// *******************************************************************************************
+// Function:
+//		int ml7396_hwif_regset(void *data)
+//
+// Description:
+//		Write the RF registers after each PHY reset (ml7396_setup())
+//
+// Parameters:
+//		data	- Table of ml7396_hwif_reg_t ending with bank ML7396_HWIF_REG_END,
+//				  NULL keeps the reset values of the ML7396
+//
+// Return:
+//		0 if succeeded, -1 otherwise
+//
+// *******************************************************************************************
+int ml7396_hwif_regset(void *data);
+
+
+// *******************************************************************************************
+// Function:
+//		int ml7396_hwif_timer_start(uint16_t msec)
+//		int ml7396_hwif_timer_stop(void)
+//
+// Description:
+//		Arm the one-shot timer (CCA back-off and ACK wait of the driver), a new start
+//		replaces the running one. The timer handler is called in the timer thread
+//
+// Parameters:
+//		msec	- Time from now (ms)
+//
+// Return:
+//		0 if succeeded, -1 otherwise
+//
+// *******************************************************************************************
+int ml7396_hwif_timer_start(uint16_t msec);
+int ml7396_hwif_timer_stop(void);
+
+
+// *******************************************************************************************
+// Function:
+//		void ml7396_hwif_sint_di(void)
+//		void ml7396_hwif_sint_ei(void)
+//		void ml7396_hwif_timer_di(void)
+//		void ml7396_hwif_timer_ei(void)
+//
+// Description:
+//		Keep the SINTN handler and the timer handler out of em_main(). Both handlers
+//		take one recursive lock, so the calls nest and must be balanced
+//
+// Parameters:
+//		None
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void ml7396_hwif_sint_di(void);
+void ml7396_hwif_sint_ei(void);
+void ml7396_hwif_timer_di(void);
+void ml7396_hwif_timer_ei(void);
+
+
+// *******************************************************************************************
+// Function:
+//		void ml7396_hwif_sint_handler(void (*func)(void))
+//		void ml7396_hwif_timer_handler(void (*func)(void))
+//
+// Description:
+//		Register the handlers of em_main()
+//
+// Parameters:
+//		func	- Handler, NULL removes it
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void ml7396_hwif_sint_handler(void (*func)(void));
+void ml7396_hwif_timer_handler(void (*func)(void));
+
+
+#endif /* HAL_BP3596_ML7396_HWIF_H_ */
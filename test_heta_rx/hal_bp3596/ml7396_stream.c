@@ -0,0 +1,283 @@
+/*
+ * ml7396_stream.c
+ *
+ * Buffer-pool streaming on top of ml7396_txstart()/ml7396_rxstart()
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ml7396_hwif.h"
+#include "ml7396_stream.h"
+
+
+// em_main() runs in the ML7396 interrupt handlers, the pools are shared with it
+#define STREAM_LOCK()		{ ml7396_hwif_sint_di(); ml7396_hwif_timer_di(); }
+#define STREAM_UNLOCK()		{ ml7396_hwif_sint_ei(); ml7396_hwif_timer_ei(); }
+
+
+// TX pool
+static ML7396_Buffer tx_pool[ML7396_STREAM_TX_NUM];
+static uint8_t tx_data[ML7396_STREAM_TX_NUM][ML7396_STREAM_BUFFER_SIZE];
+static ML7396_Buffer *tx_free[ML7396_STREAM_TX_NUM];
+static volatile uint8_t tx_free_num;
+static volatile uint8_t tx_pending;
+static ML7396_Buffer *tx_tail;				// last buffer of the chain in flight, NULL if idle
+static ml7396_stream_cb tx_done_cb;
+static ml7396_stream_cb rx_done_cb;
+
+// RX ring
+static ML7396_Buffer rx_pool[ML7396_STREAM_RX_NUM];
+static uint8_t rx_data[ML7396_STREAM_RX_NUM][ML7396_STREAM_BUFFER_SIZE];
+static ML7396_Buffer *rx_free[ML7396_STREAM_RX_NUM];
+static volatile uint8_t rx_free_num;
+static ML7396_Buffer *rx_done[ML7396_STREAM_RX_NUM];
+static volatile uint8_t rx_done_head, rx_done_num;
+static volatile uint8_t rx_stopped;			// no free buffer was left, the ML7396 is not receiving
+
+
+// ***********************************************************
+//
+// TX completion, called by em_main() for each buffer of the chain
+//
+// ***********************************************************
+static void stream_tx_done(ML7396_Buffer *buffer)
+{
+	ML7396_Buffer *next;
+
+	if (tx_done_cb != NULL)
+		tx_done_cb(buffer);
+	tx_free[tx_free_num++] = buffer;
+	--tx_pending;
+
+	// On error the driver stops, give back the rest of the chain
+	if (buffer->status < 0)
+	{
+		next = buffer->opt.tx.next;
+		buffer->opt.tx.next = NULL;
+		while (next != NULL)
+		{
+			buffer = next;
+			next = buffer->opt.tx.next;
+			buffer->opt.tx.next = NULL;
+			buffer->status = ML7396_BUFFER_ESTOP;
+			if (tx_done_cb != NULL)
+				tx_done_cb(buffer);
+			tx_free[tx_free_num++] = buffer;
+			--tx_pending;
+		}
+		tx_tail = NULL;
+	}
+	else if (buffer == tx_tail)
+		tx_tail = NULL;
+}
+
+
+// ***********************************************************
+//
+// RX completion, choose the buffer of the next packet
+//
+// ***********************************************************
+static void stream_rx_done(ML7396_Buffer *buffer)
+{
+	// Error: receive the next packet in the same buffer
+	if (buffer->status < 0)
+	{
+		buffer->opt.rx.next = buffer;
+		return;
+	}
+
+	rx_done[(rx_done_head + rx_done_num) % ML7396_STREAM_RX_NUM] = buffer;
+	++rx_done_num;
+	if (rx_done_cb != NULL)
+		rx_done_cb(buffer);
+
+	if (rx_free_num > 0)
+		buffer->opt.rx.next = rx_free[--rx_free_num];
+	else
+	{
+		// The driver turns RX off, ml7396_stream_rx_release() restarts it
+		buffer->opt.rx.next = NULL;
+		rx_stopped = 1;
+	}
+}
+
+
+// ***********************************************************
+//
+// Build the pools and start the reception
+//
+// ***********************************************************
+int ml7396_stream_init(ml7396_stream_cb tx_done, ml7396_stream_cb rx_done, ml7396_stream_cb rx_progress)
+{
+	uint8_t i;
+
+	tx_done_cb = tx_done;
+	rx_done_cb = rx_done;
+	tx_tail = NULL;
+	tx_pending = 0;
+	tx_free_num = 0;
+	for (i = 0; i < ML7396_STREAM_TX_NUM; ++i)
+	{
+		memset(&tx_pool[i], 0, sizeof(ML7396_Buffer));
+		tx_pool[i].data = &tx_data[i][0];
+		tx_pool[i].capacity = ML7396_STREAM_BUFFER_SIZE;
+		tx_free[tx_free_num++] = &tx_pool[i];
+	}
+
+	// rx_pool[0] receives first, the others wait in the free list
+	rx_done_head = 0;
+	rx_done_num = 0;
+	rx_stopped = 0;
+	rx_free_num = 0;
+	for (i = 0; i < ML7396_STREAM_RX_NUM; ++i)
+	{
+		memset(&rx_pool[i], 0, sizeof(ML7396_Buffer));
+		rx_pool[i].data = &rx_data[i][0];
+		rx_pool[i].capacity = ML7396_STREAM_BUFFER_SIZE;
+		rx_pool[i].opt.rx.done = stream_rx_done;
+		rx_pool[i].opt.rx.filter = NULL;
+		rx_pool[i].opt.rx.progress = rx_progress;
+		if (i > 0)
+			rx_free[rx_free_num++] = &rx_pool[i];
+	}
+
+	return ml7396_rxstart(&rx_pool[0]);
+}
+
+
+// ***********************************************************
+//
+// Get a free TX buffer
+//
+// ***********************************************************
+ML7396_Buffer *ml7396_stream_tx_alloc(void)
+{
+	ML7396_Buffer *buffer;
+
+	buffer = NULL;
+	STREAM_LOCK();
+	if (tx_free_num > 0)
+		buffer = tx_free[--tx_free_num];
+	STREAM_UNLOCK();
+
+	if (buffer != NULL)
+	{
+		buffer->size = 0;
+		buffer->opt.tx.done = stream_tx_done;
+		buffer->opt.tx.next = NULL;
+		buffer->opt.tx.ack.wait = 0;
+		buffer->opt.tx.ack.retry = 0;
+		buffer->opt.tx.cca.wait = ML7396_STREAM_CCA_WAIT;
+		buffer->opt.tx.cca.retry = ML7396_STREAM_CCA_RETRY;
+	}
+	return buffer;
+}
+
+
+// ***********************************************************
+//
+// Append a chain to the packets in flight
+//
+// ***********************************************************
+int ml7396_stream_tx_enqueue(ML7396_Buffer *chain)
+{
+	ML7396_Buffer *last;
+	uint8_t n, idle;
+	int status;
+
+	// Find the end of the new chain
+	n = 1;
+	last = chain;
+	while (last->opt.tx.next != NULL)
+	{
+		last = last->opt.tx.next;
+		++n;
+	}
+
+	STREAM_LOCK();
+	tx_pending += n;
+	idle = (tx_tail == NULL);
+	// The driver moves to opt.tx.next after the current tail is sent
+	if (idle == 0)
+		tx_tail->opt.tx.next = chain;
+	tx_tail = last;
+	STREAM_UNLOCK();
+
+	status = ML7396_STATUS_OK;
+	if (idle == 1)
+	{
+		status = ml7396_txstart(chain);
+		if (status != ML7396_STATUS_OK)
+		{
+			STREAM_LOCK();
+			while (chain != NULL)
+			{
+				last = chain->opt.tx.next;
+				chain->opt.tx.next = NULL;
+				tx_free[tx_free_num++] = chain;
+				--tx_pending;
+				chain = last;
+			}
+			tx_tail = NULL;
+			STREAM_UNLOCK();
+		}
+	}
+	return status;
+}
+
+
+// ***********************************************************
+//
+// Number of TX buffers in flight
+//
+// ***********************************************************
+uint8_t ml7396_stream_tx_pending(void)
+{
+	return tx_pending;
+}
+
+
+// ***********************************************************
+//
+// Get the oldest received packet
+//
+// ***********************************************************
+ML7396_Buffer *ml7396_stream_rx_get(void)
+{
+	ML7396_Buffer *buffer;
+
+	buffer = NULL;
+	STREAM_LOCK();
+	if (rx_done_num > 0)
+	{
+		buffer = rx_done[rx_done_head];
+		rx_done_head = (rx_done_head + 1) % ML7396_STREAM_RX_NUM;
+		--rx_done_num;
+	}
+	STREAM_UNLOCK();
+
+	return buffer;
+}
+
+
+// ***********************************************************
+//
+// Give a buffer back to the RX ring
+//
+// ***********************************************************
+void ml7396_stream_rx_release(ML7396_Buffer *buffer)
+{
+	uint8_t restart;
+
+	STREAM_LOCK();
+	restart = rx_stopped;
+	if (restart == 0)
+		rx_free[rx_free_num++] = buffer;
+	rx_stopped = 0;
+	STREAM_UNLOCK();
+
+	if (restart == 1)
+		ml7396_rxstart(buffer);
+}
@@ -10,6 +10,13 @@
 
 // Command header Bit 7
 #define ISACK_PREFIX	(0x80)	// Be ACK command or not
+// Command header Bit 6
+#define CHECK_REQ_PREFIX	(0x40)	// SEND only: the last packet of a window or a re-send, RX answers with CHECK ACK
+									// (a full packet has no room for the CHECK parameters, RX knows them)
+#define ABORT_PREFIX	(0x40)	// END only: ABORT, TX gives up the session, RX waits for the next one (no ACK)
+								// ABORT as an ACK: RX gives up the session (a relay whose next hop has failed)
+#define OWN_ACK_PREFIX	(0x40)	// CHECK (ACK) only: CHECK ACK sent by RX on its own (SAR_USED_RX_ACK), its table
+								// covers the packets up to the last one received, TX takes the later ones as lost
 // Command header Bit 5 ..3
 typedef enum pro_fsm {
 	PING 	= 0x00,		// (0x00 << 3)	PING_PREFIX
@@ -19,28 +26,73 @@ typedef enum pro_fsm {
 	SEND 	= 0x20,		// (0x04 << 3)	SEND_PREFIX
 	CHECK 	= 0x28,		// (0x05 << 3)	CHECK_PREFIX
 	RESEND,
-	HALT
+	HALT,
+	BEACON	= 0x30,		// (0x06 << 3)	BEACON_PREFIX, neighbor discovery (protocol_route.h)
+	SETUP	= 0x38,		// (0x07 << 3)	SETUP_PREFIX, PING + CONFIG + START in one command (SAR_USED_SETUP)
+	ABORT	= 0x58		// END | ABORT_PREFIX, not a state
 } pro_fsm;
 // Command header Bit 2 .. 0
 #define CONFIG_CPL		(0x3)	// 3 parameters, 6 bytes
+#define CONFIG_CODEC_CPL	(0x5)	// 5 parameters, 10 bytes: CONFIG_CPL, codec and raw frame length
+#define CONFIG_DELTA_CPL	(0x6)	// 6 parameters, 12 bytes: CONFIG_CODEC_CPL and session ID of the reference frame
+								// SETUP has the parameters of CONFIG
 #define SEND_CPL	 	(0x1)	// 1 parameters, 2 bytes
+								// SEND with the parameters of CONFIG is the header of an object (SAR_USED_OBJECT)
 #define CHECK_CPL 		(0x2)	// 2 parameters, 4 bytes
+#define CHECK_SKIP_CPL	(0x3)	// 3 parameters, 6 bytes: CHECK_CPL and the number of lost packets
+								// which TX gives up after the deadline of the session
+#define BEACON_CPL		(0x3)	// 3 parameters, 6 bytes
+
+#define CSIDP			(0x05)	// Session ID position
+#define CPARSP			(0x06)	// Command parameter starting position
+								// 1-byte cmd, 4-byte src/dest address, 1-byte session ID
+
+// Object header: SEND without data which carries the parameters of CONFIG
+#define OBJECT_HEADER_MSG(msg)	((((msg)[0] & (ISACK_PREFIX | CMD_PREFIX_MASK)) == SEND) && (((msg)[0] & 0x07) != SEND_CPL))
+#define OBJECT_HEADER_NONE	(0)		// TX: SETUP (or CONFIG) has the parameters of the session
+#define OBJECT_HEADER_SEND	(1)		// TX: the association is set up, the first SEND of the object is its header
+#define OBJECT_HEADER_SENT	(2)		// TX: the header is sent, it goes again before CHECK until the first CHECK ACK
+#define OBJECT_HEADER_AGAIN	(3)		// TX: the header is sent again, the command follows after the gap
+
+// Codec of the frame in a session, sent in CONFIG when it is not SESS_CODEC_NONE
+#define SESS_CODEC_NONE		(0)		// frame is sent as it is
+#define SESS_CODEC_LZ		(1)		// frame is compressed by lz_compress() (utils/lz.h)
+#define SESS_CODEC_DELTA	(2)		// frame is compressed by lz_compress_dict() with the reference frame as dictionary
+#define SESS_CODEC_PART		(3)		// frame is one part of a larger frame, sent as it is; raw_length is the number
+									// of parts which follow in the next sessions of TX (0: last part)
+#define SESS_REF_NONE		(0)		// no reference frame, RX refuses SESS_CODEC_DELTA
+
+// Traffic class of a TX session, the ready session of the lowest class is stepped first (protocol_sess.h)
+#define SESS_CLASS_CONTROL	(0)		// control and telemetry, e.g. an alarm
+#define SESS_CLASS_VIDEO	(1)		// latest frame of the camera, dropped if it is not started before its due time
+#define SESS_CLASS_BULK		(2)		// backlog, e.g. a file
+
+// Status of a session: TX after pro_tx(), RX after its end or ABORT
+#define SESS_STATUS_OK			(0)		// ended by the last ACK (TX), END or the last CHECK (RX)
+#define SESS_STATUS_TIME_OUT	(1)		// TX: no ACK for time_out_data, ABORT is sent
+#define SESS_STATUS_UNREACHABLE	(2)		// TX: no ACK for time_out_setup, or the peer is held down (protocol_rtt.h)
+#define SESS_STATUS_ABORTED		(3)		// TX: pro_sess_tx_abort() or ABORT ACK of RX, RX: ABORT is received
+#define SESS_STATUS_DROPPED		(4)		// TX: SESS_CLASS_VIDEO session which is not started before its due time
 
-#define CPARSP			(0x05)	// Command parameter starting position
-								// 1-byte cmd, 4-byte src/dest address
 // Session parameters
 #define PACKETS_PER_TRANS	(128)	// 128 packets/transaction
 #define RECV_PACKET_TAB_MAX (256)	// received-data-table, support up to 2,048 packets/transaction
 #define SCPL		 		(115)	// 115 bytes/packet
-#define MAX_NUM_LOSS_PKTS	(116)	// Maximum number of loss packets ID in one transaction
+#define SCPL_ML7396			(1792)	// 1,792 bytes/packet in ML7396 large-frame mode (FRAME_SIZE = 32 packets)
+#define MAX_NUM_LOSS_PKTS	(115)	// Maximum number of loss packets ID in one transaction
+#define MAX_NUM_LOSS_PKTS_ML7396	(RECV_PACKET_TAB_MAX)	// the whole table fits in one ML7396 CHECK ACK
 
-#define SESS_WAIT_RECV		(100)	// us
-#define SESS_WAIT_SEND		(10)	// us
-#define SESS_TIME_OUT		(60000000)	// max 60 seconds
+#define SESS_WAIT_SEND		(10)	// us, ML7396 TX buffer wait
+#define SESS_TIME_OUT		(60000000)	// us without command before an RX session is closed, measured by the monotonic clock
+#define SESS_TIME_OUT_SETUP	(2000000)	// TX: us without ACK of PING or SETUP, then the peer is unreachable
+#define SESS_TIME_OUT_DATA	(10000000)	// TX: us without ACK after the first one, then the session is aborted
+#define RX_ACK_PACKETS		(PACKETS_PER_TRANS)	// RX: CHECK ACK on its own after this number of new packets without CHECK
+#define RX_ACK_GAPS			(4)		// RX: CHECK ACK on its own after this number of packet airtimes without packet
 
 // DQIS framework
-#define TIME_OUT_1			(SESS_WAIT_RECV*10)
-#define PTX_SEND_WAIT(a)	hal_delay_us(a)
+// The command is sent again after the RTO of its peer (protocol_rtt.h)
+#define PTX_SEND_WAIT(a)	hal_delay_us(a)		// gap after a packet, tx_delay (us), the sessions wait it at pro_tx_when()
+#define PRO_TX_NEVER		(0xFFFFFFFFFFFFFFFFULL)	// pro_tx_when(): waits for an event (relay: the packets of the previous hop)
 
 #define SAR_DELAY_MIN		(0)
 #define SAR_DELAY_MAX		(3200)
@@ -49,6 +101,36 @@ typedef enum pro_fsm {
 #define SAR_COEFF_DELAY_DEC	(2)		// 1/4
 #define SAR_THRESHOLD		(5)
 
+// Multi-link transport
+#define SAR_USED_ML7396		(0)		// 2: also drive the BP3596 (ML7396) on SPI1, sessions run over ML7396 with SCPL_ML7396 packets
+									// 1: also drive the BP3596 (ML7396) on SPI1, SEND packets can be striped over both radios
+									// 0: AT86RF212 only
+#define SAR_USED_ROUTE		(0)		// 1: nodes send BEACON, sessions take the next hop to the sink from protocol_route
+									// 0: fixed addresses
+
+// Session setup
+#define SAR_USED_SETUP		(1)		// 1: a session starts with one SETUP round trip, the first window is sent right after SETUP
+									// 0: PING, CONFIG and START round trips (RX takes both)
+#define SAR_USED_SEND_CHECK	(1)		// 1: CHECK comes with the last packet of each window and each re-send, without its own
+									// round trip (needs DEBUG_USED_CHECK), TX only sends CHECK again after the RTO
+									// 0: CHECK is sent after the packets
+#define SAR_USED_RX_ACK		(1)		// 1: RX sends CHECK ACK on its own after RX_ACK_PACKETS new packets, or RX_ACK_GAPS
+									// packet airtimes after the last one (the packet with CHECK is lost, a relay window),
+									// TX takes it when its window is sent (needs DEBUG_USED_CHECK)
+									// 0: CHECK ACK only answers CHECK
+#define SAR_USED_OBJECT		(1)		// 1: the frames are numbered objects of one association between two nodes:
+									// SETUP (or PING) only opens the association, each object starts with its header
+									// in its first SEND without ACK and ends with the ACK of its last CHECK, there is
+									// no END (needs DEBUG_USED_CHECK)
+									// 0: each frame starts with SETUP (or PING) and ends with END
+
+// Size of SAR message buffers: 1-byte PHY length, command, parameters, data and packet ID
+#if SAR_USED_ML7396 == 2
+#define SAR_MSG_SIZE		(1 + CPARSP + (SEND_CPL << 1) + SCPL_ML7396 + 2)
+#else
+#define SAR_MSG_SIZE		LARGE_BUFFER_SIZE
+#endif
+
 // ------------------
 #define GET16TO8(a8, b8, c16) {(b8) = (uint8_t)((c16) & 0xFF); (a8) = (uint8_t)((c16) >> 8);}
 
@@ -59,9 +141,10 @@ typedef struct msg_t {
 	uint8_t 	cmd_header;
 	uint16_t 	src_addr;
 	uint16_t	dest_addr;
+	uint8_t		sess_id;
 	uint8_t		cmd_param[14];
 	uint8_t		cmd_param_length;
-	uint8_t 	cmd_data_length;	// length in byte of cmd_data_length
+	uint16_t 	cmd_data_length;	// length in byte of cmd_data_length
 									// command data are obtained directly from SESSION frame data
 } msg_t;
 
@@ -69,13 +152,29 @@ typedef struct msg_t {
 typedef struct sess_t {
 	uint16_t	src_addr;			// source address
 	uint16_t	dest_addr;			// destination address
+	uint8_t		sess_id;			// session ID, set by pro_tx_init() and echoed by RX in each ACK
 	uint16_t 	frame_length;		// frame length in this session
+	uint8_t		codec;				// SESS_CODEC_NONE, SESS_CODEC_LZ, SESS_CODEC_DELTA or SESS_CODEC_PART
+									// TX: SESS_CODEC_NONE after pro_tx() if RX refuses the codec
+	uint16_t	raw_length;			// frame length before compression, set to frame_length by pro_tx_init() if there is no codec
+									// SESS_CODEC_PART: parts which follow
+	uint16_t	ref_id;				// SESS_CODEC_DELTA: session ID of the reference frame, RX refuses another one
 	uint16_t 	packet_length;		// packet length in this session
 	uint16_t 	num_of_packet;		// number of packets in this session
 	uint16_t 	window_size;		// the size of window (number of packets/transaction) (adaptive)
 	uint16_t	tx_delay;			// delay between 2 consecutive send (adaptive)
-	uint32_t	time_out;			// control the session time-out, if occur, halt the system
-	uint8_t 	guarantee_end;		// guarantee that END ACK is received properly
+	uint32_t	time_out;			// us without ACK (TX) or command (RX), RX: the session is closed at SESS_TIME_OUT
+	uint32_t	time_out_setup;		// TX: limit of time_out before the first ACK, 0: SESS_TIME_OUT_SETUP
+	uint32_t	time_out_data;		// TX: limit of time_out after the first ACK, 0: SESS_TIME_OUT_DATA
+	uint8_t		status;				// SESS_STATUS_OK, SESS_STATUS_TIME_OUT, ...
+	uint8_t 	guarantee_end;		// guarantee that END ACK (or the last CHECK ACK) is received properly
+	uint8_t		link_mode;			// LINK_MODE_SINGLE, LINK_MODE_STRIPE or LINK_MODE_ML7396 (protocol_link.h)
+	uint8_t		link;				// link of PING, CONFIG, START, CHECK, END and their ACK
+	uint32_t	deadline;			// us from START, then only the lost packets in must are re-sent, 0: no deadline
+	uint8_t		*must;				// bit = 1 for each packet which is re-sent after the deadline, NULL: none
+	uint16_t	lost;				// packets given up after the deadline, RX zeroes their data
+	uint8_t		tx_class;			// TX: SESS_CLASS_CONTROL, SESS_CLASS_VIDEO or SESS_CLASS_BULK
+	uint64_t	due;				// TX: monotonic time (us), earliest first in a class, 0: no due time
 	uint8_t		*frame_data;		// frame data in this session
 } sess_t;
 
@@ -88,14 +187,56 @@ typedef struct scrp_t {
 	uint16_t	pktid_update;
 	uint16_t	length;				// length of recv_data_table in one transaction
 	uint8_t		reset_req;			// 1: reset the table when length = 0, in SEND state
+	uint16_t	pktid_end;			// RX: check packet ID end of the last CHECK
 	uint8_t 	table[RECV_PACKET_TAB_MAX];	// store the receive data in one transaction
 } scrp_t;
 
+// -------- Protocol context of one TX session --------
+// pro_tx_step() never waits (ACK, gap between packets, airtime) and sends one frame at most,
+// pro_tx_when() gives the time of the next step, so that several sessions can be interleaved (protocol_sess.h)
+typedef struct pro_tx_t {
+	sess_t		*SESSION;
+	msg_t		SAR_MSG;
+	scrp_t		RECV_TAB;			// Send Check Re-send (SCR)
+	pro_fsm		PRO_STATE;
+	uint8_t		wait_ack;			// the command of PRO_STATE is sent, its ACK is not received yet
+	uint64_t	sent_us;			// monotonic time of the command, 0: send it again at once
+	uint32_t	rto;				// the command is sent again when it waits longer than rto (us)
+	uint8_t		retry;				// the command is sent again, its ACK is not an RTT sample
+	uint64_t	tick_us;			// monotonic time of the last pro_tx_tick()
+	uint16_t	send_pktid;			// send packet ID
+	uint16_t	chk_pktid_start;	// check packet ID (start, end)
+	uint16_t	chk_pktid_end;
+	uint16_t	tmp_length;			// maximum length of the received-data-table in CHECK ACK
+	uint16_t	fwd_pktid;			// next packet ID of the window to be sent
+	uint16_t	resend_pktid;		// RESEND: next packet ID to look for in the received-data-table
+	uint64_t	pace_us;			// monotonic time before which the next frame is not sent (tx_delay, airtime)
+	uint8_t		*ready;				// relay: bit = 1 for each packet received from the previous hop
+									// NULL: the whole frame is ready
+	uint64_t	deadline_us;		// monotonic time of the deadline, 0: no deadline
+	uint16_t	give_up;			// lost packets of the window given up in CHECK
+	uint8_t		header;				// OBJECT_HEADER_*
+} pro_tx_t;
+
+// -------- Protocol context of one RX session --------
+typedef struct pro_rx_t {
+	sess_t		*SESSION;
+	msg_t		SAR_MSG;
+	scrp_t		RECV_TAB;			// Send Check Re-send (SCR)
+	pro_fsm		PRO_STATE;
+	uint8_t		*ready;				// relay: the bit of each stored packet is set, can be NULL
+	uint16_t	ack_count;			// new packets since the last CHECK ACK
+	uint16_t	ack_pktid_end;		// packet ID after the last packet since the last CHECK ACK
+	uint8_t		ack_link;			// link of the last packet
+	uint64_t	ack_us;				// time of the CHECK ACK sent on its own, 0: none
+	uint8_t		refused;			// the object header of sess_id is refused, it is answered again
+} pro_rx_t;
+
 
 // =========================================================================================================================================
 // *******************************************************************************************
 // Function: 
-//		void generate_command(msg_t SAR_MSG, uint8_t *cmd_data, uint8_t *msg)
+//		uint16_t generate_command(msg_t SAR_MSG, uint8_t *cmd_data, uint8_t *msg)
 // 
 // Description:
 //		Generate the command
@@ -106,31 +247,170 @@ typedef struct scrp_t {
 //		msg			- Full message
 //
 // Return:
-//		None
+//		Length of the message without msg[0] (msg[0] is only valid up to PHY_MAX_LENGTH)
 //
 // *******************************************************************************************
-void generate_command(msg_t SAR_MSG, uint8_t *cmd_data, uint8_t *msg);
+uint16_t generate_command(msg_t SAR_MSG, uint8_t *cmd_data, uint8_t *msg);
 
 
 // =========================================================================================================================================
 // *******************************************************************************************
-// Function: 
-//		void pro_tx_send_cmd_recv_ack(pro_fsm PRO_STATE, msg_t SAR_MSG, sess_t *SESSION, uint8_t *msg_recv)
-// 
+// Function:
+//		void pro_tx_init(pro_tx_t *PTX, sess_t *SESSION)
+//
 // Description:
-//		Send the command and try to receive the ACK command
-// 
+//		Start a new TX session in SETUP state (PING state if SAR_USED_SETUP is 0)
+//		with a new session ID. With SAR_USED_OBJECT, once the association with the
+//		peer is set up (rtt_assoc()), the session is a new object which starts in SEND
+//		state with its header
+//
 // Parameters:
-//		PRO_STATE	- State of command which has ACK
-//		SAR_MSG		- SAR message
+//		PTX			- Protocol context
 //		SESSION		- Session information
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void pro_tx_init(pro_tx_t *PTX, sess_t *SESSION);
+
+
+// *******************************************************************************************
+// Function:
+//		void pro_tx_step(pro_tx_t *PTX)
+//
+// Description:
+//		Run the next step of the session, one frame at most: the command of the current
+//		state, or the next SEND packet of the window or of the lost packets. Nothing is sent
+//		before the gap of the last packet (tx_delay) and the airtime budget of the link
+//		(link_wait()) have passed, a command or CHECK also waits for the packets striped
+//		before it (link_idle()). When the session waits for an ACK, the command is only sent
+//		again after the RTO of the peer. The first window follows SETUP without waiting for
+//		its ACK, RX stores it once SETUP is received. Without ACK for time_out_setup (PING,
+//		SETUP) or time_out_data, the session is aborted (SESSION->status). A session to a peer
+//		which is held down is not started
+//
+// Parameters:
+//		PTX			- Protocol context
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void pro_tx_step(pro_tx_t *PTX);
+
+
+// *******************************************************************************************
+// Function:
+//		uint64_t pro_tx_when(pro_tx_t *PTX)
+//
+// Description:
+//		Time of the next step of the session: the end of the gap or of the airtime wait,
+//		or the RTO of the command which waits for its ACK
+//
+// Parameters:
+//		PTX			- Protocol context
+//
+// Return:
+//		Monotonic time (us), at once if it is not later than reactor_now(). PRO_TX_NEVER
+//		if the session is halted, or if a relay waits for the packets of the previous hop
+//
+// *******************************************************************************************
+uint64_t pro_tx_when(pro_tx_t *PTX);
+
+
+// *******************************************************************************************
+// Function:
+//		uint8_t pro_tx_burst(pro_tx_t *PTX)
+//
+// Description:
+//		Check whether the session is in the middle of a window (SEND or RESEND packets),
+//		the scheduler lets no other session send before the window is over
+//
+// Parameters:
+//		PTX			- Protocol context
+//
+// Return:
+//		true in the middle of a window
+//
+// *******************************************************************************************
+uint8_t pro_tx_burst(pro_tx_t *PTX);
+
+
+// *******************************************************************************************
+// Function:
+//		uint8_t pro_tx_recv_ack(pro_tx_t *PTX, uint8_t *msg_recv)
+//
+// Description:
+//		Check the received message against the ACK expected by the session and move to
+//		the next state. An ACK with wrong parameters makes the command be sent again at once.
+//		The ACK of a command which was sent only once is an RTT sample of the peer.
+//		After the deadline, the lost packets which are not in SESSION->must are not re-sent,
+//		CHECK tells RX to give them up once no other packet of the window is lost.
+//		ABORT as an ACK halts the session with SESS_STATUS_ABORTED
+//
+// Parameters:
+//		PTX			- Protocol context
 //		msg_recv	- Full receive message
 //
 // Return:
+//		true if the message is the ACK of this session
+//
+// *******************************************************************************************
+uint8_t pro_tx_recv_ack(pro_tx_t *PTX, uint8_t *msg_recv);
+
+
+// *******************************************************************************************
+// Function:
+//		void pro_tx_tick(pro_tx_t *PTX)
+//
+// Description:
+//		Add the time since the last call to the session time-out while the session waits for an ACK
+//
+// Parameters:
+//		PTX			- Protocol context
+//
+// Return:
 //		None
 //
 // *******************************************************************************************
-void pro_tx_send_cmd_recv_ack(pro_fsm PRO_STATE, msg_t SAR_MSG, sess_t *SESSION, uint8_t *msg_recv);
+void pro_tx_tick(pro_tx_t *PTX);
+
+
+// *******************************************************************************************
+// Function:
+//		uint8_t pro_tx_started(pro_tx_t *PTX)
+//
+// Description:
+//		Check whether the first command of the session (PING or SETUP) is sent
+//
+// Parameters:
+//		PTX			- Protocol context
+//
+// Return:
+//		false if nothing of the session is sent yet
+//
+// *******************************************************************************************
+uint8_t pro_tx_started(pro_tx_t *PTX);
+
+
+// *******************************************************************************************
+// Function:
+//		void pro_tx_abort(pro_tx_t *PTX, uint8_t status)
+//
+// Description:
+//		Give up the session: ABORT is sent once if the session is started, so that RX
+//		waits for the next session at once, then the session is halted
+//
+// Parameters:
+//		PTX			- Protocol context
+//		status		- SESS_STATUS_TIME_OUT, SESS_STATUS_UNREACHABLE or SESS_STATUS_ABORTED
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void pro_tx_abort(pro_tx_t *PTX, uint8_t status);
 
 
 // *******************************************************************************************
@@ -138,13 +418,13 @@ void pro_tx_send_cmd_recv_ack(pro_fsm PRO_STATE, msg_t SAR_MSG, sess_t *SESSION,
 //		void pro_tx_send_data(msg_t SAR_MSG, sess_t SESSION, uint16_t send_pktid)
 // 
 // Description:
-//		Send image data
+//		Send window_size SEND packets from send_pktid, without gap: the sessions send
+//		one packet per step (window_size = 1) and wait tx_delay at pro_tx_when()
 // 
 // Parameters:
 //		SAR_MSG		- SAR message
 //		SESSION		- Session information
-//		send_pktid	-
-//		msg_send	-
+//		send_pktid	- First packet ID
 //
 // Return:
 //		None
@@ -155,22 +435,21 @@ void pro_tx_send_data(msg_t SAR_MSG, sess_t SESSION, uint16_t send_pktid);
 
 // *******************************************************************************************
 // Function: 
-//		void pro_tx_resend_data(msg_t SAR_MSG, sess_t SESSION, scrp_t RECV_TAB)
+//		void pro_tx_resend_data(pro_tx_t *PTX)
 //
 // Description:
-//		Check received-data-table and re-send image data
+//		Re-send the next lost packet of the received-data-table (one per step, from
+//		resend_pktid), then move to CHECK. The last packet carries CHECK if
+//		SAR_USED_SEND_CHECK is 1
 //
 // Parameters:
-//		SAR_MSG		-
-//		SESSION		- Session information
-//		RECV_TAB	- Received data table
-//		msg_send	-
+//		PTX			- Protocol context, with the received-data-table of CHECK ACK
 //
 // Return:
 //		None
 //
 // *******************************************************************************************
-void pro_tx_resend_data(msg_t SAR_MSG, sess_t SESSION, scrp_t RECV_TAB);
+void pro_tx_resend_data(pro_tx_t *PTX);
 
 
 // *******************************************************************************************
@@ -178,7 +457,7 @@ void pro_tx_resend_data(msg_t SAR_MSG, sess_t SESSION, scrp_t RECV_TAB);
 //		void pro_tx(sess_t *SESSION)
 // 
 // Description:
-//		Send image data
+//		Send image data, the session runs on the session table with the other open sessions
 // 
 // Parameters:
 //		SESSION		- Session information
@@ -251,12 +530,115 @@ void pro_rx_recv_cmd_send_ack(pro_fsm *PRO_STATE, sess_t *SESSION, msg_t SAR_MSG
 uint8_t pro_rx_recv_data(pro_fsm *PRO_STATE, scrp_t *SCR_PRO, sess_t *SESSION, uint8_t *msg_recv);
 
 
+// *******************************************************************************************
+// Function:
+//		void pro_rx_init(pro_rx_t *PRX, sess_t *SESSION)
+//
+// Description:
+//		Wait for a new RX session in PING state, SESSION->sess_id is kept so that
+//		a re-sent END of the last session is still acknowledged
+//
+// Parameters:
+//		PRX			- Protocol context
+//		SESSION		- Session information
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void pro_rx_init(pro_rx_t *PRX, sess_t *SESSION);
+
+
+// *******************************************************************************************
+// Function:
+//		uint8_t pro_rx_input(pro_rx_t *PRX, uint8_t *msg_recv, uint8_t link_recv)
+//
+// Description:
+//		Process a received message if it belongs to the session: store SEND data,
+//		acknowledge the other commands. PRO_STATE is HALT after END, or after the last CHECK
+//		which finds no lost packet if SAR_USED_OBJECT is 1. The packets given up
+//		by TX are zeroed and counted in SESSION->lost. SEND data are only stored after
+//		START or SETUP, so that the first window of a refused SETUP is dropped.
+//		An object header (SAR_USED_OBJECT) starts a new object in PING state as SETUP
+//		does, without ACK unless its delta is refused.
+//		A packet with CHECK is answered by CHECK ACK at once; without it, CHECK ACK is sent
+//		after RX_ACK_PACKETS new packets, or later by pro_rx_tick() (SAR_USED_RX_ACK).
+//		ABORT puts the session back in PING state with SESS_STATUS_ABORTED, without ACK
+//
+// Parameters:
+//		PRX			- Protocol context
+//		msg_recv	- Full receive message
+//		link_recv	- Link on which the message is received
+//
+// Return:
+//		true if the message belongs to this session
+//
+// *******************************************************************************************
+uint8_t pro_rx_input(pro_rx_t *PRX, uint8_t *msg_recv, uint8_t link_recv);
+
+
+// *******************************************************************************************
+// Function:
+//		uint64_t pro_rx_when(pro_rx_t *PRX)
+//
+// Description:
+//		Time at which RX sends CHECK ACK on its own (SAR_USED_RX_ACK), the owner of the
+//		session arms a timer and calls pro_rx_tick() then
+//
+// Parameters:
+//		PRX			- Protocol context
+//
+// Return:
+//		Monotonic time (us), PRO_TX_NEVER if there is no packet to acknowledge
+//
+// *******************************************************************************************
+uint64_t pro_rx_when(pro_rx_t *PRX);
+
+
+// *******************************************************************************************
+// Function:
+//		void pro_rx_tick(pro_rx_t *PRX)
+//
+// Description:
+//		Send CHECK ACK on its own if its time is reached: the packets since the last CHECK
+//		ACK are acknowledged as if TX had sent CHECK up to the last one. PRO_STATE can be
+//		HALT after it, as after CHECK
+//
+// Parameters:
+//		PRX			- Protocol context
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void pro_rx_tick(pro_rx_t *PRX);
+
+
+// *******************************************************************************************
+// Function:
+//		void pro_rx_abort(msg_t SAR_MSG, uint8_t link)
+//
+// Description:
+//		Give up a session of TX, e.g. a relay whose next hop has given up the frame:
+//		ABORT is sent as the ACK of its command, TX ends the session with SESS_STATUS_ABORTED
+//
+// Parameters:
+//		SAR_MSG		- Addresses and session ID of the RX session (pro_rx_t SAR_MSG)
+//		link		- Link of the session
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void pro_rx_abort(msg_t SAR_MSG, uint8_t link);
+
+
 // *******************************************************************************************
 // Function: 
 //		void pro_rx(sess_t *SESSION)
 // 
 // Description:
-//		Receive image data
+//		Receive image data, the session runs on the session table with the other open sessions
 // 
 // Parameters:
 //		SESSION		- Session information
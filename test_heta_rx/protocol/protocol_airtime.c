@@ -0,0 +1,156 @@
+#include "../at86rf212_param.h"
+#include "../utils/reactor.h"
+#include "protocol.h"
+#include "protocol_airtime.h"
+
+
+airtime_t SAR_AIRTIME_LINK[LINK_NUM];
+airtime_t SAR_AIRTIME_SESS[AIRTIME_SESS_MAX];
+
+static uint8_t airtime_next;		// entry taken by the next new session when the table is full
+
+
+// ===========================================================
+//
+// Full bucket
+//
+// ===========================================================
+static void airtime_fill(airtime_t *BUCKET, uint16_t duty)
+{
+	BUCKET->duty = duty;
+	BUCKET->tokens = (int64_t)AIRTIME_DEPTH_US * AIRTIME_DUTY_ONE;
+	BUCKET->last = reactor_now();
+}
+
+
+// ===========================================================
+//
+// Initialize the buckets
+//
+// ===========================================================
+void airtime_init(void)
+{
+	uint8_t i;
+
+	memset(&SAR_AIRTIME_LINK[0], 0, sizeof(SAR_AIRTIME_LINK));
+	memset(&SAR_AIRTIME_SESS[0], 0, sizeof(SAR_AIRTIME_SESS));
+	airtime_next = 0;
+
+	for (i = 0; i < LINK_NUM; ++i)
+	{
+		SAR_AIRTIME_LINK[i].used = true;
+		airtime_fill(&SAR_AIRTIME_LINK[i], AIRTIME_DUTY_LINK);
+	}
+}
+
+
+// ===========================================================
+//
+// Bucket of a session
+//
+// ===========================================================
+airtime_t* airtime_sess(uint16_t addr, uint8_t sess_id)
+{
+	uint8_t i;
+	airtime_t *BUCKET;
+
+	for (i = 0; i < AIRTIME_SESS_MAX; ++i)
+		if ((SAR_AIRTIME_SESS[i].used == true) && (SAR_AIRTIME_SESS[i].addr == addr) && (SAR_AIRTIME_SESS[i].sess_id == sess_id))
+			return &SAR_AIRTIME_SESS[i];
+
+	// A free entry, or the oldest one
+	for (i = 0; i < AIRTIME_SESS_MAX; ++i)
+		if (SAR_AIRTIME_SESS[i].used == false)
+			break;
+	if (i == AIRTIME_SESS_MAX)
+	{
+		i = airtime_next;
+		airtime_next = (airtime_next + 1) % AIRTIME_SESS_MAX;
+	}
+
+	BUCKET = &SAR_AIRTIME_SESS[i];
+	BUCKET->used = true;
+	BUCKET->addr = addr;
+	BUCKET->sess_id = sess_id;
+	airtime_fill(BUCKET, AIRTIME_DUTY_SESS);
+	return BUCKET;
+}
+
+
+// ===========================================================
+//
+// Add the airtime earned since the last refill,
+// return the wait (us) until the bucket holds the airtime
+//
+// ===========================================================
+static uint32_t airtime_refill(airtime_t *BUCKET, uint32_t airtime, uint64_t now)
+{
+	int64_t need;
+
+	if (BUCKET->duty >= AIRTIME_DUTY_ONE)
+		return 0;
+
+	BUCKET->tokens += (int64_t)(now - BUCKET->last) * BUCKET->duty;
+	if (BUCKET->tokens > (int64_t)AIRTIME_DEPTH_US * AIRTIME_DUTY_ONE)
+		BUCKET->tokens = (int64_t)AIRTIME_DEPTH_US * AIRTIME_DUTY_ONE;
+	BUCKET->last = now;
+
+	need = ((int64_t)airtime * AIRTIME_DUTY_ONE) - BUCKET->tokens;
+	if (need <= 0)
+		return 0;
+	return (uint32_t)((need + BUCKET->duty - 1) / BUCKET->duty);
+}
+
+
+// ===========================================================
+//
+// Time until both buckets hold the airtime of a frame
+//
+// ===========================================================
+uint32_t airtime_wait(uint8_t link, airtime_t *SESS, uint32_t airtime)
+{
+	uint32_t wait, wait_sess;
+	uint64_t now;
+	airtime_t *LINK;
+
+	LINK = &SAR_AIRTIME_LINK[link];
+	if ((LINK->duty >= AIRTIME_DUTY_ONE) && ((SESS == NULL) || (SESS->duty >= AIRTIME_DUTY_ONE)))
+		return 0;
+
+	// The emptier bucket, the other one is filled meanwhile
+	now = reactor_now();
+	wait = airtime_refill(LINK, airtime, now);
+	if (SESS != NULL)
+	{
+		wait_sess = airtime_refill(SESS, airtime, now);
+		if (wait_sess > wait)
+			wait = wait_sess;
+	}
+	return wait;
+}
+
+
+// ===========================================================
+//
+// Take the airtime of a frame
+//
+// ===========================================================
+void airtime_take(uint8_t link, airtime_t *SESS, uint32_t airtime)
+{
+	uint64_t now;
+	airtime_t *LINK;
+
+	LINK = &SAR_AIRTIME_LINK[link];
+	if ((LINK->duty >= AIRTIME_DUTY_ONE) && ((SESS == NULL) || (SESS->duty >= AIRTIME_DUTY_ONE)))
+		return;
+
+	now = reactor_now();
+	airtime_refill(LINK, airtime, now);
+	if (SESS != NULL)
+		airtime_refill(SESS, airtime, now);
+
+	if (LINK->duty < AIRTIME_DUTY_ONE)
+		LINK->tokens -= (int64_t)airtime * AIRTIME_DUTY_ONE;
+	if ((SESS != NULL) && (SESS->duty < AIRTIME_DUTY_ONE))
+		SESS->tokens -= (int64_t)airtime * AIRTIME_DUTY_ONE;
+}
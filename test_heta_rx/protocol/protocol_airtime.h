@@ -0,0 +1,118 @@
+/*
+ * protocol_airtime.h
+ *
+ * Airtime budget of the links (duty cycle of the sub-GHz bands): a token bucket for
+ * each link and for each session, filled with duty/1000 us of airtime per us.
+ * A SEND packet is sent once both buckets hold its airtime (link_airtime()): the
+ * sender waits airtime_wait() on a timer of the event loop, so the packets are
+ * sent as close together as the budget allows. The commands, ACKs and BEACONs
+ * do not wait, they take their airtime in advance (the bucket goes below zero).
+ */
+
+#ifndef PROTOCOL_PROTOCOL_AIRTIME_H_
+#define PROTOCOL_PROTOCOL_AIRTIME_H_
+
+#include <stdint.h>
+#include "protocol_link.h"
+
+
+// *******************************************************************************************
+#define AIRTIME_DUTY_ONE		(1000)		// per-mille, 100 %: no budget
+#define AIRTIME_DUTY_LINK		(1000)		// per-mille of the time each link is on air, e.g. 100 for a 10 % duty cycle
+#define AIRTIME_DUTY_SESS		(1000)		// per-mille of each session, lower than AIRTIME_DUTY_LINK to share a link
+#define AIRTIME_DEPTH_US		(20000)		// us of airtime sent in a burst after an idle time
+#define AIRTIME_SESS_MAX		(8)			// sessions in the table, the oldest entry is taken for a new session
+
+
+// *******************************************************************************************
+// -------- Token bucket --------
+typedef struct airtime_t {
+	uint8_t		used;
+	uint16_t	addr;				// session: destination address
+	uint8_t		sess_id;			// session: session ID
+	uint16_t	duty;				// per-mille
+	int64_t		tokens;				// airtime available (us x 1000), negative after a frame longer than the bucket
+	uint64_t	last;				// monotonic time of the last refill (us)
+} airtime_t;
+
+extern airtime_t SAR_AIRTIME_LINK[LINK_NUM];
+extern airtime_t SAR_AIRTIME_SESS[AIRTIME_SESS_MAX];
+
+
+// =========================================================================================================================================
+// *******************************************************************************************
+// Function:
+//		void airtime_init(void)
+//
+// Description:
+//		Fill the bucket of each link with AIRTIME_DEPTH_US and clear the sessions
+//
+// Parameters:
+//		None
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void airtime_init(void);
+
+
+// *******************************************************************************************
+// Function:
+//		airtime_t* airtime_sess(uint16_t addr, uint8_t sess_id)
+//
+// Description:
+//		Bucket of a session, a full one if the session is not in the table
+//
+// Parameters:
+//		addr		- Destination address of the session
+//		sess_id		- Session ID
+//
+// Return:
+//		Bucket of the session
+//
+// *******************************************************************************************
+airtime_t* airtime_sess(uint16_t addr, uint8_t sess_id);
+
+
+// *******************************************************************************************
+// Function:
+//		uint32_t airtime_wait(uint8_t link, airtime_t *SESS, uint32_t airtime)
+//
+// Description:
+//		Time until the bucket of the link and the bucket of the session hold the airtime
+//		of a frame
+//
+// Parameters:
+//		link		- LINK_AT86RF212 or LINK_ML7396
+//		SESS		- Bucket of the session, NULL: only the link
+//		airtime		- Airtime of the frame (us)
+//
+// Return:
+//		Wait (us), 0: the frame can be sent now
+//
+// *******************************************************************************************
+uint32_t airtime_wait(uint8_t link, airtime_t *SESS, uint32_t airtime);
+
+
+// *******************************************************************************************
+// Function:
+//		void airtime_take(uint8_t link, airtime_t *SESS, uint32_t airtime)
+//
+// Description:
+//		Take the airtime of a frame from the bucket of the link and the bucket of the
+//		session, without waiting (see airtime_wait())
+//
+// Parameters:
+//		link		- LINK_AT86RF212 or LINK_ML7396
+//		SESS		- Bucket of the session, NULL: only the link (e.g. BEACON)
+//		airtime		- Airtime of the frame (us)
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void airtime_take(uint8_t link, airtime_t *SESS, uint32_t airtime);
+
+
+#endif /* PROTOCOL_PROTOCOL_AIRTIME_H_ */
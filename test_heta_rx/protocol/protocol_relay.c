@@ -0,0 +1,377 @@
+#include "../at86rf212_param.h"
+#include "../tal/tal_at86rf212.h"
+#include "../tal/tal_at86rf212_trx.h"
+#include "../hal/hal_at86rf212_trx_access.h"
+#include "../mydebug/mydebug.h"
+#include "../utils/reactor.h"
+#include "protocol.h"
+#include "protocol_link.h"
+#include "protocol_relay.h"
+#include "protocol_route.h"
+#include "protocol_rtt.h"
+#include "protocol_sess.h"
+
+
+static void pro_relay_timer(void *arg);
+static void pro_relay_idle(void *arg);
+static void pro_relay_up_ack(void *arg);
+
+
+// ===========================================================
+//
+// Initialize the relay
+//
+// ===========================================================
+void pro_relay_init(relay_t *RELAY, uint16_t src_addr, uint16_t up_addr, uint16_t down_addr, uint8_t *frame_data)
+{
+	// ------ Previous hop ------
+	RELAY->SESS_UP.src_addr = src_addr;
+	RELAY->SESS_UP.dest_addr = up_addr;
+	RELAY->SESS_UP.sess_id = 0;			// taken from the PING or SETUP of each session
+	RELAY->SESS_UP.frame_length = 0;
+	RELAY->SESS_UP.packet_length = 0;
+	RELAY->SESS_UP.num_of_packet = 0;
+	RELAY->SESS_UP.codec = SESS_CODEC_NONE;
+	RELAY->SESS_UP.raw_length = 0;
+	RELAY->SESS_UP.window_size = PACKETS_PER_TRANS;
+	RELAY->SESS_UP.tx_delay = 0;
+	RELAY->SESS_UP.time_out = 0;
+	RELAY->SESS_UP.time_out_setup = 0;
+	RELAY->SESS_UP.time_out_data = 0;
+	RELAY->SESS_UP.status = SESS_STATUS_OK;
+	RELAY->SESS_UP.guarantee_end = false;
+	RELAY->SESS_UP.link_mode = LINK_MODE_DEFAULT;
+	RELAY->SESS_UP.frame_data = frame_data;
+
+	// ------ Next hop ------
+	RELAY->SESS_DOWN = RELAY->SESS_UP;
+	RELAY->SESS_DOWN.dest_addr = down_addr;
+
+	RELAY->up_addr = up_addr;
+	RELAY->window_size = PACKETS_PER_TRANS;
+	RELAY->down_open = false;
+	RELAY->input = -1;
+	RELAY->result = PRO_RELAY_NONE;
+	RELAY->up_abort = false;
+	reactor_timer_init(&RELAY->TIMER, pro_relay_timer, RELAY);
+	reactor_timer_init(&RELAY->IDLE, pro_relay_idle, RELAY);
+	reactor_timer_init(&RELAY->UP_ACK, pro_relay_up_ack, RELAY);
+}
+
+
+// ===========================================================
+//
+// Wait for a new frame of the previous hop
+//
+// ===========================================================
+static void pro_relay_up_init(relay_t *RELAY)
+{
+	memset(&RELAY->ready[0], 0, RELAY_READY_SIZE);
+	RELAY->SESS_UP.dest_addr = RELAY->up_addr;
+	RELAY->SESS_UP.ref_id = SESS_REF_NONE;		// a delta frame is refused, the next hop may have another reference
+	pro_rx_init(&RELAY->UP, &RELAY->SESS_UP);
+	RELAY->UP.ready = &RELAY->ready[0];
+	reactor_timer_start(&RELAY->IDLE, reactor_now() + SESS_TIME_OUT);
+}
+
+
+// ===========================================================
+//
+// Start the session with the next hop
+//
+// ===========================================================
+static void pro_relay_down_open(relay_t *RELAY)
+{
+	// Same frame and packets as the previous hop
+	RELAY->SESS_DOWN.frame_length = RELAY->SESS_UP.frame_length;
+	RELAY->SESS_DOWN.packet_length = RELAY->SESS_UP.packet_length;
+	RELAY->SESS_DOWN.num_of_packet = RELAY->SESS_UP.num_of_packet;
+	RELAY->SESS_DOWN.codec = RELAY->SESS_UP.codec;
+	RELAY->SESS_DOWN.raw_length = RELAY->SESS_UP.raw_length;
+	RELAY->SESS_DOWN.ref_id = SESS_REF_NONE;
+	RELAY->SESS_DOWN.window_size = RELAY->window_size;
+	RELAY->SESS_DOWN.time_out = 0;
+	RELAY->SESS_DOWN.deadline = 0;			// the packets given up by the previous hop are zeroed and forwarded
+	RELAY->SESS_DOWN.must = NULL;
+
+#if SAR_USED_ROUTE == 1
+	// Next hop to the sink at the time of the frame
+	if (route_next_hop() != ROUTE_ADDR_NONE)
+		RELAY->SESS_DOWN.dest_addr = route_next_hop();
+#endif
+
+	pro_tx_init(&RELAY->DOWN, &RELAY->SESS_DOWN);
+	RELAY->DOWN.ready = &RELAY->ready[0];
+	RELAY->down_open = true;
+	RELAY->up_abort = false;
+
+	printf("Info: --- --- Relay 0x%04x -> 0x%04x ... \n", RELAY->SESS_UP.dest_addr, RELAY->SESS_DOWN.dest_addr);
+}
+
+
+// ===========================================================
+//
+// Stop the relay
+//
+// ===========================================================
+static void pro_relay_stop(relay_t *RELAY)
+{
+	link_input_remove(RELAY->input);
+	RELAY->input = -1;
+	reactor_timer_stop(&RELAY->TIMER);
+	reactor_timer_stop(&RELAY->IDLE);
+	reactor_timer_stop(&RELAY->UP_ACK);
+}
+
+
+// ===========================================================
+//
+// End of a frame, wait for the next one
+//
+// ===========================================================
+static void pro_relay_end(relay_t *RELAY, uint8_t result)
+{
+	// The previous hop still sends the frame, its session is given up
+	if ((result == PRO_RELAY_FAILED) && (RELAY->UP.PRO_STATE != PING) && (RELAY->UP.PRO_STATE != HALT))
+	{
+		RELAY->UP_ABORT = RELAY->UP.SAR_MSG;
+		RELAY->up_abort_link = RELAY->SESS_UP.link;
+		RELAY->up_abort = true;
+		pro_rx_abort(RELAY->UP_ABORT, RELAY->up_abort_link);
+	}
+
+	RELAY->result = result;
+	RELAY->down_open = false;
+	reactor_timer_stop(&RELAY->TIMER);
+	pro_relay_up_init(RELAY);
+}
+
+
+// ===========================================================
+//
+// Check the end of the frame and schedule the next step of the next hop
+//
+// ===========================================================
+static void pro_relay_schedule(relay_t *RELAY)
+{
+	uint64_t when;
+
+	if (RELAY->down_open == true)
+	{
+		// Ending condition, the next hop has given up the session (ABORT is sent)
+		if ((RELAY->DOWN.PRO_STATE == HALT) && (RELAY->SESS_DOWN.status != SESS_STATUS_OK))
+		{
+			pro_relay_end(RELAY, PRO_RELAY_FAILED);
+			return;
+		}
+		if ((RELAY->DOWN.PRO_STATE == HALT) && (RELAY->UP.PRO_STATE == HALT))
+		{
+			pro_relay_end(RELAY, PRO_RELAY_OK);
+			return;
+		}
+	}
+
+	// A re-sent END of the last frame, no frame is received
+	else if (RELAY->UP.PRO_STATE == HALT)
+		pro_relay_up_init(RELAY);
+
+	// After END, the previous hop only waits for the next hop
+	if (RELAY->UP.PRO_STATE == HALT)
+		reactor_timer_stop(&RELAY->IDLE);
+
+	// Gap, airtime or RTO of the next hop, nothing while it waits for the packets of the previous hop
+	// and not before the end of a packet of the previous hop still on air on the same radio
+	when = (RELAY->down_open == true) ? pro_tx_when(&RELAY->DOWN) : PRO_TX_NEVER;
+	if (when != PRO_TX_NEVER)
+		when = link_rx_wait(RELAY->SESS_DOWN.link_mode, when);
+	if (when == PRO_TX_NEVER)
+		reactor_timer_stop(&RELAY->TIMER);
+	else
+		reactor_timer_start(&RELAY->TIMER, when);
+
+	// CHECK ACK to the previous hop when the packet with CHECK is lost
+	when = pro_rx_when(&RELAY->UP);
+	if (when == PRO_TX_NEVER)
+		reactor_timer_stop(&RELAY->UP_ACK);
+	else
+		reactor_timer_start(&RELAY->UP_ACK, when);
+}
+
+
+// ===========================================================
+//
+// Next step of the next hop
+//
+// ===========================================================
+static void pro_relay_timer(void *arg)
+{
+	relay_t *RELAY;
+	uint64_t now;
+
+	RELAY = (relay_t*)arg;
+	if (RELAY->down_open == false)
+		return;
+
+	// A packet of the previous hop has started since, it is received first
+	now = reactor_now();
+	if (link_rx_wait(RELAY->SESS_DOWN.link_mode, now) > now)
+	{
+		pro_relay_schedule(RELAY);
+		return;
+	}
+
+	pro_tx_tick(&RELAY->DOWN);
+	pro_tx_step(&RELAY->DOWN);
+	pro_relay_schedule(RELAY);
+}
+
+
+// ===========================================================
+//
+// CHECK ACK sent to the previous hop on its own
+//
+// ===========================================================
+static void pro_relay_up_ack(void *arg)
+{
+	relay_t *RELAY;
+
+	RELAY = (relay_t*)arg;
+	if (RELAY->input < 0)
+		return;
+	pro_rx_tick(&RELAY->UP);
+	pro_relay_schedule(RELAY);
+}
+
+
+// ===========================================================
+//
+// No command of the previous hop, the relay is stopped
+//
+// ===========================================================
+static void pro_relay_idle(void *arg)
+{
+	relay_t *RELAY;
+
+	RELAY = (relay_t*)arg;
+	printf("Info: --- --- No command of the previous hop for %d s\n", SESS_TIME_OUT / 1000000);
+	if ((RELAY->down_open == true) && (RELAY->DOWN.PRO_STATE != HALT))
+		pro_tx_abort(&RELAY->DOWN, SESS_STATUS_ABORTED);
+	RELAY->down_open = false;
+	pro_relay_stop(RELAY);
+	RELAY->result = PRO_RELAY_TIME_OUT;
+}
+
+
+// ===========================================================
+//
+// Message of either hop (link input handler)
+//
+// ===========================================================
+static uint8_t pro_relay_input(void *arg, uint8_t *msg_recv, uint8_t link_recv)
+{
+	relay_t *RELAY;
+	uint8_t cmd_prefix, taken;
+
+	RELAY = (relay_t*)arg;
+
+	// ------ ACK of the next hop, its next step is at once ------
+	if ((msg_recv[0] & ISACK_PREFIX) == ISACK_PREFIX)
+	{
+		if ((RELAY->down_open == false) || (pro_tx_recv_ack(&RELAY->DOWN, &msg_recv[0]) == false))
+			return false;
+		pro_relay_schedule(RELAY);
+		return true;
+	}
+
+	// ------ Command of the previous hop ------
+	// A given up session gets ABORT again for each command which waits for an ACK
+	if ((RELAY->up_abort == true) &&
+		(((msg_recv[1] << 8) + msg_recv[2]) == RELAY->UP_ABORT.dest_addr) &&
+		(((msg_recv[3] << 8) + msg_recv[4]) == RELAY->UP_ABORT.src_addr) &&
+		(msg_recv[CSIDP] == RELAY->UP_ABORT.sess_id))
+	{
+		if (((msg_recv[0] & CMD_PREFIX_MASK) != SEND) || ((msg_recv[0] & CHECK_REQ_PREFIX) == CHECK_REQ_PREFIX))
+			pro_rx_abort(RELAY->UP_ABORT, link_recv);
+		return true;
+	}
+
+	// After END, only END is acknowledged again until the next hop has the whole frame
+	if (RELAY->UP.PRO_STATE == HALT)
+	{
+		cmd_prefix = msg_recv[0] & CMD_PREFIX_MASK;
+#if SAR_USED_OBJECT == 1
+		// The object ends with its last CHECK, which is acknowledged again
+		if (cmd_prefix == CHECK)
+			return pro_rx_input(&RELAY->UP, &msg_recv[0], link_recv);
+#endif
+		// ABORT after END: the whole frame is here, it is still forwarded
+		if ((cmd_prefix != END) || ((msg_recv[0] & ABORT_PREFIX) == ABORT_PREFIX))
+			return false;
+
+		RELAY->UP.PRO_STATE = END;
+		taken = pro_rx_input(&RELAY->UP, &msg_recv[0], link_recv);
+		RELAY->UP.PRO_STATE = HALT;
+		return taken;
+	}
+
+	// Any previous hop: the frame is taken from the node which sends PING, SETUP or an object header
+	// (or a re-sent END of its last frame)
+	cmd_prefix = msg_recv[0] & (ISACK_PREFIX | CMD_PREFIX_MASK);
+	if ((RELAY->SESS_UP.dest_addr == SESS_ADDR_ANY) && (RELAY->UP.PRO_STATE == PING) &&
+		((cmd_prefix == PING) || (cmd_prefix == SETUP) || (cmd_prefix == END) || (OBJECT_HEADER_MSG(msg_recv) == true)) &&
+		(((msg_recv[3] << 8) + msg_recv[4]) == RELAY->SESS_UP.src_addr))
+	{
+		RELAY->SESS_UP.dest_addr = (msg_recv[1] << 8) + msg_recv[2];
+		RELAY->UP.SAR_MSG.dest_addr = RELAY->SESS_UP.dest_addr;
+	}
+	if (pro_rx_input(&RELAY->UP, &msg_recv[0], link_recv) == false)
+		return false;
+	reactor_timer_start(&RELAY->IDLE, reactor_now() + SESS_TIME_OUT);
+
+	// ABORT of the previous hop is forwarded, the relay waits for the next frame
+	if (RELAY->SESS_UP.status == SESS_STATUS_ABORTED)
+	{
+		if ((RELAY->down_open == true) && (RELAY->DOWN.PRO_STATE != HALT))
+			pro_tx_abort(&RELAY->DOWN, SESS_STATUS_ABORTED);
+		RELAY->down_open = false;
+		pro_relay_up_init(RELAY);
+	}
+
+	// CONFIG of the previous hop is confirmed by START (or SETUP, or the object header)
+	else if ((RELAY->down_open == false) &&
+			 ((RELAY->UP.PRO_STATE == START) || (RELAY->UP.PRO_STATE == SEND) || (RELAY->UP.PRO_STATE == CHECK)))
+		pro_relay_down_open(RELAY);
+
+	// A new packet may be forwarded at once
+	pro_relay_schedule(RELAY);
+	return true;
+}
+
+
+// ===========================================================
+//
+// Relay one frame
+//
+// ===========================================================
+uint8_t pro_relay(relay_t *RELAY)
+{
+	// The relay stays on the event loop between the frames
+	if (RELAY->input < 0)
+	{
+		reactor_init();
+		RELAY->down_open = false;
+		pro_relay_up_init(RELAY);
+		RELAY->input = link_input_add(pro_relay_input, RELAY);
+		if (RELAY->input < 0)
+		{
+			printf("Info: --- --- Too many event sources\n");
+			reactor_timer_stop(&RELAY->IDLE);
+			return PRO_RELAY_TIME_OUT;
+		}
+	}
+
+	RELAY->result = PRO_RELAY_NONE;
+	while (RELAY->result == PRO_RELAY_NONE)
+		reactor_run_once();
+	return RELAY->result;
+}
@@ -0,0 +1,293 @@
+#include "../at86rf212_param.h"
+#include "../tal/tal_at86rf212.h"
+#include "../tal/tal_at86rf212_trx.h"
+#include "../hal/hal_at86rf212_trx_access.h"
+#include "../utils/reactor.h"
+#include "protocol.h"
+#include "protocol_link.h"
+#include "protocol_route.h"
+#include "protocol_rtt.h"
+
+
+route_t SAR_ROUTE;
+
+static uint8_t route_enable;			// route_init() is called
+static uint64_t route_beacon_time;		// time of the next BEACON (us)
+static reactor_timer_t route_timer;		// wakes the event loop up for the next BEACON
+
+
+// ===========================================================
+//
+// BEACON timer
+//
+// ===========================================================
+static void route_timer_cb(void *arg)
+{
+	(void)arg;
+	route_poll();
+}
+
+
+// ===========================================================
+//
+// Initialize the routing
+//
+// ===========================================================
+void route_init(uint16_t src_addr, uint16_t sink_addr)
+{
+	memset(&SAR_ROUTE, 0, sizeof(route_t));
+	SAR_ROUTE.src_addr = src_addr;
+	SAR_ROUTE.sink_addr = sink_addr;
+	SAR_ROUTE.parent = ROUTE_ADDR_NONE;
+	SAR_ROUTE.cost = (src_addr == sink_addr) ? 0 : ROUTE_COST_INF;
+
+	// The first BEACON is sent at the first route_poll()
+	route_beacon_time = 0;
+	route_enable = true;
+	reactor_timer_init(&route_timer, route_timer_cb, NULL);
+}
+
+
+// ===========================================================
+//
+// Cost to the sink through a neighbor
+//
+// ===========================================================
+static uint16_t route_path_cost(route_nbr_t *NBR)
+{
+	uint32_t cost;
+
+	// Not usable: no route, route through this node, bad link, or held down after a failed session
+	if ((NBR->cost == ROUTE_COST_INF) || (NBR->parent == SAR_ROUTE.src_addr) || (NBR->dr < ROUTE_DR_MIN) ||
+		(rtt_down(NBR->addr) == true))
+		return ROUTE_COST_INF;
+
+	cost = NBR->cost + NBR->link_cost;
+	if (cost >= ROUTE_COST_INF)
+		return ROUTE_COST_INF;
+	return cost;
+}
+
+
+// ===========================================================
+//
+// Recompute the route over all neighbors
+//
+// ===========================================================
+static void route_update_all(void)
+{
+	uint8_t i;
+	uint16_t cost, best_cost, best_parent;
+
+	if (SAR_ROUTE.src_addr == SAR_ROUTE.sink_addr)
+		return;
+
+	best_cost = ROUTE_COST_INF;
+	best_parent = ROUTE_ADDR_NONE;
+	for (i = 0; i < SAR_ROUTE.nbr_num; ++i)
+	{
+		cost = route_path_cost(&SAR_ROUTE.nbr[i]);
+		if (cost < best_cost)
+		{
+			best_cost = cost;
+			best_parent = SAR_ROUTE.nbr[i].addr;
+		}
+	}
+
+	if (best_parent != SAR_ROUTE.parent)
+		printf("Info: --- --- Route to 0x%04x: next hop 0x%04x, cost = %d us\n", SAR_ROUTE.sink_addr, best_parent, best_cost);
+	SAR_ROUTE.parent = best_parent;
+	SAR_ROUTE.cost = best_cost;
+}
+
+
+// ===========================================================
+//
+// Recompute the route after one neighbor is updated
+//
+// ===========================================================
+static void route_update(route_nbr_t *NBR)
+{
+	uint16_t cost;
+
+	if (SAR_ROUTE.src_addr == SAR_ROUTE.sink_addr)
+		return;
+
+	// The cost of the next hop may have increased, check all neighbors
+	if (NBR->addr == SAR_ROUTE.parent)
+	{
+		route_update_all();
+		return;
+	}
+
+	// Otherwise only this neighbor can be better
+	cost = route_path_cost(NBR);
+	if ((cost != ROUTE_COST_INF) &&
+		((SAR_ROUTE.parent == ROUTE_ADDR_NONE) || ((cost + (cost >> ROUTE_HYSTERESIS)) < SAR_ROUTE.cost)))
+	{
+		printf("Info: --- --- Route to 0x%04x: next hop 0x%04x, cost = %d us\n", SAR_ROUTE.sink_addr, NBR->addr, cost);
+		SAR_ROUTE.parent = NBR->addr;
+		SAR_ROUTE.cost = cost;
+	}
+}
+
+
+// ===========================================================
+//
+// Send BEACON
+//
+// ===========================================================
+static void route_beacon(void)
+{
+	msg_t SAR_MSG;
+	uint16_t msg_length;
+	uint8_t msg_send[SAR_MSG_SIZE];
+
+	SAR_MSG.cmd_header = BEACON | BEACON_CPL;
+	SAR_MSG.src_addr = SAR_ROUTE.src_addr;
+	SAR_MSG.dest_addr = ROUTE_ADDR_NONE;		// all neighbors
+	SAR_MSG.sess_id = SAR_ROUTE.seq++;
+	SAR_MSG.cmd_param_length = (BEACON_CPL << 1);
+	SAR_MSG.cmd_data_length = 0;
+	GET16TO8(SAR_MSG.cmd_param[0], SAR_MSG.cmd_param[1], SAR_ROUTE.cost);
+	GET16TO8(SAR_MSG.cmd_param[2], SAR_MSG.cmd_param[3], SAR_ROUTE.sink_addr);
+	GET16TO8(SAR_MSG.cmd_param[4], SAR_MSG.cmd_param[5], SAR_ROUTE.parent);
+
+	msg_length = generate_command(SAR_MSG, NULL, &msg_send[0]);
+	link_tx_frame(LINK_AT86RF212, &msg_send[0], msg_length);
+}
+
+
+// ===========================================================
+//
+// Send BEACON and age the neighbors
+//
+// ===========================================================
+void route_poll(void)
+{
+	uint8_t i, removed;
+	uint64_t now;
+
+	if (route_enable == false)
+		return;
+
+	now = reactor_now();
+	if (now < route_beacon_time)
+		return;
+	route_beacon_time = now + ROUTE_BEACON_PERIOD + (rand() % ROUTE_BEACON_JITTER);
+	reactor_timer_start(&route_timer, route_beacon_time);
+
+	route_beacon();
+
+	// Remove the neighbors which are not heard any more
+	removed = false;
+	i = 0;
+	while (i < SAR_ROUTE.nbr_num)
+	{
+		if (++SAR_ROUTE.nbr[i].missed >= ROUTE_NBR_TIMEOUT)
+		{
+			printf("Info: --- --- Neighbor 0x%04x is lost\n", SAR_ROUTE.nbr[i].addr);
+			--SAR_ROUTE.nbr_num;
+			SAR_ROUTE.nbr[i] = SAR_ROUTE.nbr[SAR_ROUTE.nbr_num];
+			removed = true;
+		}
+		else
+			++i;
+	}
+
+	if (removed == true)
+		route_update_all();
+}
+
+
+// ===========================================================
+//
+// Receive BEACON
+//
+// ===========================================================
+void route_input(uint8_t *msg_recv, uint8_t link)
+{
+	uint8_t i, gap;
+	uint16_t src_addr_recv, sink_addr_recv;
+	int16_t sample;
+	uint32_t link_cost;
+	route_nbr_t *NBR;
+
+	if (route_enable == false)
+		return;
+
+	src_addr_recv  = (msg_recv[1] << 8) + msg_recv[2];
+	sink_addr_recv = (msg_recv[CPARSP + 2] << 8) + msg_recv[CPARSP + 3];
+	if ((sink_addr_recv != SAR_ROUTE.sink_addr) || (src_addr_recv == SAR_ROUTE.src_addr))
+		return;
+
+	// Find the neighbor, or add it
+	NBR = NULL;
+	for (i = 0; i < SAR_ROUTE.nbr_num; ++i)
+		if (SAR_ROUTE.nbr[i].addr == src_addr_recv)
+			NBR = &SAR_ROUTE.nbr[i];
+
+	if (NBR == NULL)
+	{
+		if (SAR_ROUTE.nbr_num == ROUTE_NBR_MAX)
+			return;
+
+		NBR = &SAR_ROUTE.nbr[SAR_ROUTE.nbr_num++];
+		NBR->addr = src_addr_recv;
+		NBR->seq = msg_recv[CSIDP] - 1;
+		NBR->dr = ROUTE_DR_ONE >> 1;
+		printf("Info: --- --- New neighbor 0x%04x\n", src_addr_recv);
+	}
+
+	// Delivery ratio: one BEACON is received out of the sequence number gap
+	gap = msg_recv[CSIDP] - NBR->seq;
+	if (gap == 0)
+		return;
+	sample = ROUTE_DR_ONE / gap;
+	sample = NBR->dr + ((sample - (int16_t)NBR->dr) >> ROUTE_DR_SHIFT);
+	if (sample < 1)
+		sample = 1;
+	NBR->dr = sample;
+
+	NBR->seq = msg_recv[CSIDP];
+	NBR->missed = 0;
+	NBR->link = link;
+	NBR->cost   = (msg_recv[CPARSP] << 8)     + msg_recv[CPARSP + 1];
+	NBR->parent = (msg_recv[CPARSP + 4] << 8) + msg_recv[CPARSP + 5];
+
+	// Expected airtime of one full packet, inflated by the loss
+	link_cost = link_airtime(link, PHY_MAX_LENGTH - FCS_LEN);
+	link_cost = (link_cost * ROUTE_DR_ONE) / NBR->dr;
+	NBR->link_cost = (link_cost < ROUTE_COST_INF) ? link_cost : (ROUTE_COST_INF - 1);
+
+	printf("Debug: --- --- --- Neighbor 0x%04x: delivery = %d/256, %d us/packet (%d B/s), cost to sink = %d us\n",
+			NBR->addr, NBR->dr, NBR->link_cost, (SCPL * 1000000) / NBR->link_cost, NBR->cost);
+
+	route_update(NBR);
+}
+
+
+// ===========================================================
+//
+// Next hop to the sink
+//
+// ===========================================================
+uint16_t route_next_hop(void)
+{
+	return SAR_ROUTE.parent;
+}
+
+
+// ===========================================================
+//
+// A neighbor is held down
+//
+// ===========================================================
+void route_invalidate(uint16_t addr)
+{
+	if ((route_enable == false) || (addr != SAR_ROUTE.parent))
+		return;
+
+	printf("Info: --- --- Next hop 0x%04x is held down\n", addr);
+	route_update_all();
+}
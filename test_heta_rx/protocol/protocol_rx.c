@@ -3,7 +3,10 @@
 #include "../tal/tal_at86rf212_trx.h"
 #include "../hal/hal_at86rf212_trx_access.h"
 #include "../mydebug/mydebug.h"
+#include "../utils/reactor.h"
 #include "protocol.h"
+#include "protocol_link.h"
+#include "protocol_sess.h"
 
 
 // ===========================================================
@@ -16,7 +19,7 @@ uint8_t pro_rx_check_loss(sess_t SESSION, scrp_t *RECV_TAB, uint8_t *msg_recv)
 	register uint16_t i, j, n;
 	uint16_t chk_pktid_start, chk_pktid_end;
 	uint16_t min_id, max_id;
-	uint16_t result;
+	uint16_t result, length_max;
 
 	min_id = 0xFFFF;
 	max_id = 0;
@@ -31,6 +34,7 @@ uint8_t pro_rx_check_loss(sess_t SESSION, scrp_t *RECV_TAB, uint8_t *msg_recv)
 	if ((chk_pktid_end <= SESSION.num_of_packet) && (chk_pktid_end > chk_pktid_start))
 	{
 		printf("Debug: --- --- --- --- Packet ID start = %d, packet ID end = %d\n", chk_pktid_start, chk_pktid_end);
+		RECV_TAB->pktid_end = chk_pktid_end;
 		// Calculate the new length of table
 		j = chk_pktid_end - chk_pktid_start;
 		n = j >> 3;
@@ -70,8 +74,9 @@ uint8_t pro_rx_check_loss(sess_t SESSION, scrp_t *RECV_TAB, uint8_t *msg_recv)
 			RECV_TAB->pktid_update = chk_pktid_start + (min_id << 3);
 			RECV_TAB->length = max_id - min_id + 1;
 			// If the table size is larger than the capacity of PHY packets
-			if (RECV_TAB->length > MAX_NUM_LOSS_PKTS)
-				RECV_TAB->length = MAX_NUM_LOSS_PKTS;
+			length_max = (SESSION.link == LINK_ML7396) ? MAX_NUM_LOSS_PKTS_ML7396 : MAX_NUM_LOSS_PKTS;
+			if (RECV_TAB->length > length_max)
+				RECV_TAB->length = length_max;
 		}
 
 		printf("Debug: --- --- --- --- Packet ID base = %d, packet ID update = %d, table length = %d\n", RECV_TAB->pktid_base, RECV_TAB->pktid_update, RECV_TAB->length);
@@ -87,6 +92,61 @@ uint8_t pro_rx_check_loss(sess_t SESSION, scrp_t *RECV_TAB, uint8_t *msg_recv)
 }
 
 
+// ===========================================================
+//
+// Configuration parameters of CONFIG, SETUP and the object header, false if the delta is refused
+//
+// ===========================================================
+static uint8_t pro_rx_config(sess_t *SESSION, uint8_t *msg_recv)
+{
+	uint16_t ref_id_recv;
+
+	SESSION->frame_length =  (msg_recv[CPARSP] << 8) 	 + msg_recv[CPARSP + 1];
+	SESSION->packet_length = (msg_recv[CPARSP + 2] << 8) + msg_recv[CPARSP + 3];
+	SESSION->num_of_packet = (msg_recv[CPARSP + 4] << 8) + msg_recv[CPARSP + 5];
+	SESSION->codec = SESS_CODEC_NONE;
+	SESSION->raw_length = SESSION->frame_length;
+	if ((msg_recv[0] & 0x07) >= CONFIG_CODEC_CPL)
+	{
+		SESSION->codec      = (msg_recv[CPARSP + 6] << 8) + msg_recv[CPARSP + 7];
+		SESSION->raw_length = (msg_recv[CPARSP + 8] << 8) + msg_recv[CPARSP + 9];
+	}
+
+	if (SESSION->codec != SESS_CODEC_DELTA)
+		return true;
+
+	ref_id_recv = SESS_REF_NONE;
+	if ((msg_recv[0] & 0x07) >= CONFIG_DELTA_CPL)
+		ref_id_recv = (msg_recv[CPARSP + 10] << 8) + msg_recv[CPARSP + 11];
+	if ((ref_id_recv != SESS_REF_NONE) && (ref_id_recv == SESSION->ref_id))
+		return true;
+
+	printf("Info: --- --- --- Reference frame %d is not received, refuse delta\n", ref_id_recv);
+	SESSION->codec = SESS_CODEC_NONE;
+	SESSION->raw_length = SESSION->frame_length;
+	return false;
+}
+
+
+// ===========================================================
+//
+// Parameters of CONFIG ACK and SETUP ACK, with the codec if TX sends it
+//
+// ===========================================================
+static void pro_rx_config_ack(msg_t *SAR_MSG, sess_t *SESSION)
+{
+	SAR_MSG->cmd_header |= (SESSION->codec == SESS_CODEC_NONE) ? CONFIG_CPL :
+						   (SESSION->codec == SESS_CODEC_DELTA) ? CONFIG_DELTA_CPL : CONFIG_CODEC_CPL;
+	SAR_MSG->cmd_param_length = (SAR_MSG->cmd_header & 0x07) << 1;
+	GET16TO8(SAR_MSG->cmd_param[0], SAR_MSG->cmd_param[1], SESSION->frame_length);
+	GET16TO8(SAR_MSG->cmd_param[2], SAR_MSG->cmd_param[3], SESSION->packet_length);
+	GET16TO8(SAR_MSG->cmd_param[4], SAR_MSG->cmd_param[5], SESSION->num_of_packet);
+	GET16TO8(SAR_MSG->cmd_param[6], SAR_MSG->cmd_param[7], SESSION->codec);
+	GET16TO8(SAR_MSG->cmd_param[8], SAR_MSG->cmd_param[9], SESSION->raw_length);
+	GET16TO8(SAR_MSG->cmd_param[10], SAR_MSG->cmd_param[11], SESSION->ref_id);
+}
+
+
 // ===========================================================
 //
 // Receive the CMD, send the ACK
@@ -96,7 +156,8 @@ void pro_rx_recv_cmd_send_ack(pro_fsm *PRO_STATE, sess_t *SESSION, msg_t SAR_MSG
 {
 	uint16_t i;
 	uint8_t cmd_prefix, recv_error;
-	uint8_t msg_send[LARGE_BUFFER_SIZE];
+	uint16_t msg_length;
+	uint8_t msg_send[SAR_MSG_SIZE];
 
 	// 0x38 <-> 00 111 000: mask at Command prefix
 	cmd_prefix = msg_recv[0] & CMD_PREFIX_MASK;
@@ -111,7 +172,8 @@ void pro_rx_recv_cmd_send_ack(pro_fsm *PRO_STATE, sess_t *SESSION, msg_t SAR_MSG
 	{
 		// ------ CHECK command ------
 		case CHECK:
-			if ((*PRO_STATE == SEND) || (*PRO_STATE == CHECK))
+			// START: all packets of the first window are lost
+			if ((*PRO_STATE == START) || (*PRO_STATE == SEND) || (*PRO_STATE == CHECK))
 			{
 				*PRO_STATE = CHECK;
 				// Initialize the reset request
@@ -119,9 +181,18 @@ void pro_rx_recv_cmd_send_ack(pro_fsm *PRO_STATE, sess_t *SESSION, msg_t SAR_MSG
 				// Update the position and length in RECV_TAB
 				recv_error = pro_rx_check_loss((*SESSION), RECV_TAB, &msg_recv[0]);
 
+				// On its own, the table goes up to the last packet received: TX does not know it
+				if ((recv_error == false) && ((msg_recv[0] & OWN_ACK_PREFIX) == OWN_ACK_PREFIX) && (RECV_TAB->length > 0))
+				{
+					RECV_TAB->length = (RECV_TAB->pktid_end - RECV_TAB->pktid_update + 7) >> 3;
+					i = (SESSION->link == LINK_ML7396) ? MAX_NUM_LOSS_PKTS_ML7396 : MAX_NUM_LOSS_PKTS;
+					if (RECV_TAB->length > i)
+						RECV_TAB->length = i;
+				}
+
 				if (recv_error == false)
 				{
-					SAR_MSG.cmd_header |= CHECK_CPL;
+					SAR_MSG.cmd_header |= CHECK_CPL | (msg_recv[0] & OWN_ACK_PREFIX);
 					SAR_MSG.cmd_param_length = (CHECK_CPL << 1);
 					SAR_MSG.cmd_data_length = RECV_TAB->length;
 					GET16TO8(SAR_MSG.cmd_param[0], SAR_MSG.cmd_param[1], RECV_TAB->pktid_update);
@@ -129,8 +200,26 @@ void pro_rx_recv_cmd_send_ack(pro_fsm *PRO_STATE, sess_t *SESSION, msg_t SAR_MSG
 
 					printf("Info: --- --- --- Send CHECK acknowledge\n");
 					printf("Debug: --- --- --- --- Packet ID update = %d, table length = %d\n", RECV_TAB->pktid_update, RECV_TAB->length);
+
+#if SAR_USED_OBJECT == 1
+					// The whole object is received, it ends here without END
+					if ((RECV_TAB->length == 0) && (RECV_TAB->pktid_update == SESSION->num_of_packet))
+						*PRO_STATE = END;
+#endif
 				}
 			}
+#if SAR_USED_OBJECT == 1
+			// The ACK of the last CHECK is lost, TX sends it again after the object is received
+			else if ((*PRO_STATE == PING) || (*PRO_STATE == HALT))
+			{
+				SAR_MSG.cmd_header |= CHECK_CPL;
+				SAR_MSG.cmd_param_length = (CHECK_CPL << 1);
+				SAR_MSG.cmd_param[0] = msg_recv[CPARSP + 2];		// packet ID update = check packet ID end
+				SAR_MSG.cmd_param[1] = msg_recv[CPARSP + 3];
+				GET16TO8(SAR_MSG.cmd_param[2], SAR_MSG.cmd_param[3], 0);
+				printf("Info: --- --- --- Send CHECK acknowledge again\n");
+			}
+#endif
 			break;
 
 		// ------ PING command ------
@@ -144,27 +233,33 @@ void pro_rx_recv_cmd_send_ack(pro_fsm *PRO_STATE, sess_t *SESSION, msg_t SAR_MSG
 			}
 			break;
 
-		// ------ CONFIG command ------
+		// ------ CONFIG and SETUP command ------
+		// SETUP is CONFIG after PING and is START at once, it is acknowledged
+		// again while the first window comes in (and after its CHECK ACK sent on its own)
 		case CONFIG:
-			if ((*PRO_STATE == PING) || (*PRO_STATE == CONFIG))
+		case SETUP:
+			if ((*PRO_STATE == PING) || (*PRO_STATE == cmd_prefix) ||
+				((cmd_prefix == SETUP) && ((*PRO_STATE == START) || (*PRO_STATE == SEND) || (*PRO_STATE == CHECK))))
 			{
-				*PRO_STATE = CONFIG;
-
-				// Get configuration parameters
-				SESSION->frame_length =  (msg_recv[CPARSP] << 8) 	 + msg_recv[CPARSP + 1];
-				SESSION->packet_length = (msg_recv[CPARSP + 2] << 8) + msg_recv[CPARSP + 3];
-				SESSION->num_of_packet = (msg_recv[CPARSP + 4] << 8) + msg_recv[CPARSP + 5];
+				if (cmd_prefix == CONFIG)
+					*PRO_STATE = CONFIG;
+				else if (*PRO_STATE == PING)
+				{
+					*PRO_STATE = START;
+					// Guarantee END ACK is received
+					SESSION->guarantee_end = true;
+				}
 
-				// Because TX will check them again, so we do not need to check here
+				// Get configuration parameters, because TX will check them again, so we do not need to check here.
+				// A delta frame needs the same reference frame as TX, otherwise it is refused:
+				// the ACK has no codec and RX waits for the PING of the next session
+				if (pro_rx_config(SESSION, &msg_recv[0]) == false)
+					*PRO_STATE = PING;
 
-				// Re-send configuration parameters to sender
-				SAR_MSG.cmd_header |= CONFIG_CPL;
-				SAR_MSG.cmd_param_length = (CONFIG_CPL << 1);
-				GET16TO8(SAR_MSG.cmd_param[0], SAR_MSG.cmd_param[1], SESSION->frame_length);
-				GET16TO8(SAR_MSG.cmd_param[2], SAR_MSG.cmd_param[3], SESSION->packet_length);
-				GET16TO8(SAR_MSG.cmd_param[4], SAR_MSG.cmd_param[5], SESSION->num_of_packet);
+				// Re-send configuration parameters to sender, with the codec if TX sends it
+				pro_rx_config_ack(&SAR_MSG, SESSION);
 
-				printf("Info: --- --- --- Send CONFIG acknowledge\n");
+				printf("Info: --- --- --- Send %s acknowledge\n", (cmd_prefix == SETUP) ? "SETUP" : "CONFIG");
 				printf("Debug: --- --- --- --- Frame length = %d, packet length = %d, number of packets = %d", SESSION->frame_length, SESSION->packet_length, SESSION->num_of_packet);
 			}
 			break;
@@ -206,13 +301,13 @@ void pro_rx_recv_cmd_send_ack(pro_fsm *PRO_STATE, sess_t *SESSION, msg_t SAR_MSG
 		if (*PRO_STATE == CHECK)
 		{
 			i = (RECV_TAB->pktid_update - RECV_TAB->pktid_base) >> 3;
-			generate_command(SAR_MSG, &RECV_TAB->table[i], &msg_send[0]);
+			msg_length = generate_command(SAR_MSG, &RECV_TAB->table[i], &msg_send[0]);
 		}
 		else
-			generate_command(SAR_MSG, NULL, &msg_send[0]);
+			msg_length = generate_command(SAR_MSG, NULL, &msg_send[0]);
 
-		at86rfx_tx_frame(msg_send);
-		handle_tal_state();
+		// Reply on the link of the command
+		link_tx_frame(SESSION->link, &msg_send[0], msg_length);
 	}
 }
 
@@ -224,7 +319,7 @@ void pro_rx_recv_cmd_send_ack(pro_fsm *PRO_STATE, sess_t *SESSION, msg_t SAR_MSG
 // ===========================================================
 uint8_t pro_rx_recv_data(pro_fsm *PRO_STATE, scrp_t *RECV_TAB, sess_t *SESSION, uint8_t *msg_recv)
 {
-	uint16_t i, j, frame_index;
+	uint16_t i, j, frame_index, data_length;
 	uint16_t recv_pktid, recv_pktid_double;
 	uint8_t bit_select;
 
@@ -240,8 +335,17 @@ uint8_t pro_rx_recv_data(pro_fsm *PRO_STATE, scrp_t *RECV_TAB, sess_t *SESSION,
 
 	// Get the packet id
 	recv_pktid = (msg_recv[CPARSP] << 8) + msg_recv[CPARSP + 1];
+	if (recv_pktid >= SESSION->num_of_packet)
+		return (false);
+
+	// The last packet only carries the rest of the frame
+	frame_index = recv_pktid * SESSION->packet_length;
+	data_length = SESSION->packet_length;
+	if (data_length > (SESSION->frame_length - frame_index))
+		data_length = SESSION->frame_length - frame_index;
+
 	// Get the double check packet id
-	recv_pktid_double = (msg_recv[SCPL + CPARSP + 2] << 8) + msg_recv[SCPL + CPARSP + 3];
+	recv_pktid_double = (msg_recv[data_length + CPARSP + 2] << 8) + msg_recv[data_length + CPARSP + 3];
 
 #if DEBUG_INFO == 1
 	if (recv_pktid_double != recv_pktid)
@@ -262,8 +366,7 @@ uint8_t pro_rx_recv_data(pro_fsm *PRO_STATE, scrp_t *RECV_TAB, sess_t *SESSION,
 			RECV_TAB->table[i] |= bit_select;
 
 			// Copy received data to SESSION frame data
-			frame_index = recv_pktid * SESSION->packet_length;
-			memcpy(&SESSION->frame_data[frame_index], &msg_recv[CPARSP + 2], SESSION->packet_length);
+			memcpy(&SESSION->frame_data[frame_index], &msg_recv[CPARSP + 2], data_length);
 
 			// printf("Debug: --- --- --- --- Receive data from position of = %d\n", recv_pktid);
 			return (true);
@@ -275,95 +378,356 @@ uint8_t pro_rx_recv_data(pro_fsm *PRO_STATE, scrp_t *RECV_TAB, sess_t *SESSION,
 
 // ===========================================================
 //
-// Send the CMD ACK
+// Give up the lost packets of the window
 //
 // ===========================================================
-void pro_rx(sess_t *SESSION)
+static void pro_rx_give_up(pro_rx_t *PRX, uint8_t *msg_recv)
 {
-	msg_t SAR_MSG;
-	scrp_t RECV_TAB;	// Send Check Re-send (SCR)
-	pro_fsm PRO_STATE;
+	sess_t *SESSION;
+	uint16_t i, j, n, chk_pktid_start, chk_pktid_end, pktid, frame_index, data_length;
+	uint8_t bit_select;
 
-	uint8_t i, result, cmd_length;
-	uint8_t msg_recv[LARGE_BUFFER_SIZE];
-	uint16_t src_addr_recv, dest_addr_recv;
-	uint8_t cmd_prefix;
+	SESSION = PRX->SESSION;
+	chk_pktid_start = (msg_recv[CPARSP] << 8)     + msg_recv[CPARSP + 1];
+	chk_pktid_end 	= (msg_recv[CPARSP + 2] << 8) + msg_recv[CPARSP + 3];
+	if ((chk_pktid_end > SESSION->num_of_packet) || (chk_pktid_end <= chk_pktid_start))
+		return;
 
-	// Initialization
-	result = false;
+	// The table starts at chk_pktid_start, as in pro_rx_check_loss()
+	n = 0;
+	for (pktid = chk_pktid_start; pktid < chk_pktid_end; ++pktid)
+	{
+		j = pktid - chk_pktid_start;
+		i = j >> 3;
+		bit_select = 0x1 << (j % 8);
+		if ((PRX->RECV_TAB.table[i] & bit_select) != 0)
+			continue;
+		PRX->RECV_TAB.table[i] |= bit_select;
+
+		// Zero data instead of the data of the previous frame, so that the
+		// application can find the lost part (e.g. the JPEG decoder skips it)
+		frame_index = pktid * SESSION->packet_length;
+		data_length = SESSION->packet_length;
+		if (data_length > (SESSION->frame_length - frame_index))
+			data_length = SESSION->frame_length - frame_index;
+		memset(&SESSION->frame_data[frame_index], 0, data_length);
+
+		// Relay: the zeroed packet is sent to the next hop
+		if (PRX->ready != NULL)
+			PRX->ready[pktid >> 3] |= (0x1 << (pktid % 8));
+		++n;
+	}
+
+	SESSION->lost += n;
+	if (n > 0)
+		printf("Debug: --- --- --- --- %d packets are given up\n", n);
+}
+
+
+// ===========================================================
+//
+// Wait for a new RX session
+//
+// ===========================================================
+void pro_rx_init(pro_rx_t *PRX, sess_t *SESSION)
+{
+	PRX->SESSION = SESSION;
+	PRX->SAR_MSG.src_addr = SESSION->src_addr;
+	PRX->SAR_MSG.dest_addr = SESSION->dest_addr;
+	PRX->SAR_MSG.sess_id = SESSION->sess_id;
+
+	PRX->RECV_TAB.pktid_base = 0;
+	PRX->RECV_TAB.length = 0;
+	PRX->RECV_TAB.reset_req = 1;
+	PRX->RECV_TAB.pktid_end = 0;
+	memset(&PRX->RECV_TAB.table[0], 0, RECV_PACKET_TAB_MAX);	// CHECK may come before any SEND packet
+	PRX->ready = NULL;
+	PRX->ack_count = 0;
+	PRX->ack_pktid_end = 0;
+	PRX->ack_link = LINK_AT86RF212;
+	PRX->ack_us = 0;
+	PRX->refused = false;
+	SESSION->link = LINK_AT86RF212;
+	SESSION->lost = 0;
+	SESSION->status = SESS_STATUS_OK;
+
+	PRX->PRO_STATE = PING;
+}
+
+
+// ===========================================================
+//
+// CHECK from the table base to chk_pktid_end, as if TX had sent it (own: RX answers it on its own)
+//
+// ===========================================================
+static void pro_rx_check_msg(pro_rx_t *PRX, uint8_t *msg_check, uint16_t chk_pktid_end, uint8_t own)
+{
+	sess_t *SESSION;
+
+	SESSION = PRX->SESSION;
+	if (chk_pktid_end < PRX->RECV_TAB.pktid_end)
+		chk_pktid_end = PRX->RECV_TAB.pktid_end;
+
+	msg_check[0] = CHECK | CHECK_CPL | ((own == true) ? OWN_ACK_PREFIX : 0);
+	GET16TO8(msg_check[1], msg_check[2], SESSION->dest_addr);
+	GET16TO8(msg_check[3], msg_check[4], SESSION->src_addr);
+	msg_check[CSIDP] = SESSION->sess_id;
+	GET16TO8(msg_check[CPARSP], msg_check[CPARSP + 1], PRX->RECV_TAB.pktid_base);
+	GET16TO8(msg_check[CPARSP + 2], msg_check[CPARSP + 3], chk_pktid_end);
+}
+
+
+#if (SAR_USED_RX_ACK == 1) && (DEBUG_USED_CHECK == 1)
+// ===========================================================
+//
+// Count a new packet without CHECK, true if CHECK ACK is sent at once
+//
+// ===========================================================
+static uint8_t pro_rx_ack_count(pro_rx_t *PRX, uint16_t recv_pktid, uint8_t link_recv)
+{
+	sess_t *SESSION;
+
+	SESSION = PRX->SESSION;
+	++PRX->ack_count;
+	if (recv_pktid >= PRX->ack_pktid_end)
+		PRX->ack_pktid_end = recv_pktid + 1;
+	PRX->ack_link = link_recv;
+	if (PRX->ack_count >= RX_ACK_PACKETS)
+		return true;
+
+	// The packet with CHECK is lost if no packet comes for RX_ACK_GAPS packets
+	PRX->ack_us = reactor_now() + RX_ACK_GAPS * link_airtime(link_recv, CPARSP + (SEND_CPL << 1) + SESSION->packet_length + 2);
+	return false;
+}
+#endif
+
+
+// ===========================================================
+//
+// Process a received message of the session
+//
+// ===========================================================
+uint8_t pro_rx_input(pro_rx_t *PRX, uint8_t *msg_recv, uint8_t link_recv)
+{
+	sess_t *SESSION;
+	uint8_t result, cmd_prefix, sess_id_recv;
+	uint16_t src_addr_recv, dest_addr_recv, recv_pktid;
+	uint8_t msg_check[CPARSP + (CHECK_CPL << 1)];
+	uint8_t *ready;
+#if SAR_USED_OBJECT == 1
+	msg_t SAR_MSG;
+	uint16_t msg_length;
+	uint8_t msg_send[SAR_MSG_SIZE];
+#endif
 
-	SAR_MSG.src_addr = SESSION->src_addr;
-	SAR_MSG.dest_addr = SESSION->dest_addr;
+	SESSION = PRX->SESSION;
 
-	RECV_TAB.pktid_base = 0;
-	RECV_TAB.length = 0;
-	RECV_TAB.reset_req = 1;
+	// Check whether packet data are corrected
+	src_addr_recv = (msg_recv[1] << 8)  + msg_recv[2];
+	dest_addr_recv = (msg_recv[3] << 8) + msg_recv[4];
+	if ((src_addr_recv != SESSION->dest_addr) || (dest_addr_recv != SESSION->src_addr))
+		return false;
 
-	// Start main loop
-	PRO_STATE = PING;
+	// 0x38 <-> 00 111 000: mask at Command prefix
+	cmd_prefix = msg_recv[0] & CMD_PREFIX_MASK;
 
-	while ((SESSION->time_out < SESS_TIME_OUT) && (PRO_STATE != HALT))
+	// A new session starts with PING, SETUP or an object header, a re-sent END of the last session is acknowledged as before
+	sess_id_recv = msg_recv[CSIDP];
+	if ((sess_id_recv != SESSION->sess_id) &&
+		((PRX->PRO_STATE != PING) ||
+		 ((cmd_prefix != PING) && (cmd_prefix != SETUP) && (cmd_prefix != END) && (OBJECT_HEADER_MSG(msg_recv) == false))))
+		return false;
+	PRX->SAR_MSG.sess_id = sess_id_recv;
+
+#if SAR_USED_OBJECT == 1
+	// ------ Object header, the first SEND of a new object of the association ------
+	// It is SETUP without ACK, the header sent again before CHECK is only taken if RX has lost it
+	if (OBJECT_HEADER_MSG(msg_recv))
 	{
-		if (IRQ_VALUE() == true)
+		if ((PRX->PRO_STATE != PING) || ((sess_id_recv == SESSION->sess_id) && (PRX->refused == false)))
+			return true;
+
+		SESSION->time_out = 0;
+		SESSION->link = link_recv;
+		if (sess_id_recv != SESSION->sess_id)
 		{
-			// If data are already stored
-			trx_irq_handler_cb();
-			if (at86rfx_frame_rx == true)
+			SESSION->sess_id = sess_id_recv;
+			SESSION->status = SESS_STATUS_OK;
+			SESSION->guarantee_end = true;
+			printf("Info: --- --- --- Object %d\n", sess_id_recv);
+			PRX->refused = (pro_rx_config(SESSION, &msg_recv[0]) == true) ? false : true;
+			if (PRX->refused == false)
 			{
-				at86rfx_frame_rx = false;
-				cmd_length = at86rfx_rx_buffer[0] - FCS_LEN;
-				memcpy(&msg_recv[0], &at86rfx_rx_buffer[1], cmd_length);
+				printf("Debug: --- --- --- --- Frame length = %d, packet length = %d, number of packets = %d\n", SESSION->frame_length, SESSION->packet_length, SESSION->num_of_packet);
+				PRX->PRO_STATE = START;
+				return true;
+			}
+		}
 
+		// A refused delta is answered as SETUP is (again if the ACK is lost), RX waits for the next object
+		printf("Info: --- --- --- Send SETUP acknowledge\n");
+		SAR_MSG = PRX->SAR_MSG;
+		SAR_MSG.cmd_header = ISACK_PREFIX | SETUP;
+		SAR_MSG.cmd_data_length = 0;
+		pro_rx_config_ack(&SAR_MSG, SESSION);
+		msg_length = generate_command(SAR_MSG, NULL, &msg_send[0]);
+		link_tx_frame(SESSION->link, &msg_send[0], msg_length);
+		return true;
+	}
+#endif
 
-				// Check whether packet data are corrected
-				src_addr_recv = (msg_recv[1] << 8)  + msg_recv[2];
-				dest_addr_recv = (msg_recv[3] << 8) + msg_recv[4];
+	// ------ ABORT command, TX gives up the session ------
+	if ((cmd_prefix == END) && ((msg_recv[0] & ABORT_PREFIX) == ABORT_PREFIX))
+	{
+		if ((sess_id_recv == SESSION->sess_id) && (PRX->PRO_STATE != PING) && (PRX->PRO_STATE != HALT))
+		{
+			printf("Info: --- --- --- Session %d is aborted by TX\n", sess_id_recv);
+			ready = PRX->ready;
+			pro_rx_init(PRX, SESSION);
+			PRX->ready = ready;
+			SESSION->status = SESS_STATUS_ABORTED;
+			SESSION->time_out = 0;
+		}
+		return true;
+	}
 
-#if DEBUG_INFO == 1
-				if ((src_addr_recv != SESSION->dest_addr) || (dest_addr_recv != SESSION->src_addr))
-					++MYDEBUG.src_dest_addr_session[MYDEBUG.src_dest_addr_index];
+	// ------ SEND command ------
+	if (cmd_prefix == SEND)
+	{
+		// Data sent with SETUP before it is received, or after a refused SETUP
+		if ((PRX->PRO_STATE != START) && (PRX->PRO_STATE != SEND) && (PRX->PRO_STATE != CHECK))
+			return true;
+
+		// Clear the system time-out
+		SESSION->time_out = 0;
+
+		result = pro_rx_recv_data(&PRX->PRO_STATE, &PRX->RECV_TAB, SESSION, &msg_recv[0]);
+		//if (result == true)
+		//	MYDEBUG.recv_pkt_session_correct++;
+
+		// Relay: the packet can be sent to the next hop
+		recv_pktid = (msg_recv[CPARSP] << 8) + msg_recv[CPARSP + 1];
+		if ((result == true) && (PRX->ready != NULL))
+			PRX->ready[recv_pktid >> 3] |= (0x1 << (recv_pktid % 8));
+
+		// The last packet of a window or a re-send carries CHECK, which is answered below.
+		// The window starts at the table base and ends after the packet (new window)
+		// or where the last CHECK ends (re-send)
+		if ((msg_recv[0] & CHECK_REQ_PREFIX) == 0)
+		{
+#if (SAR_USED_RX_ACK == 1) && (DEBUG_USED_CHECK == 1)
+			// Without CHECK, RX answers on its own after RX_ACK_PACKETS new packets (relay
+			// window), or after a gap (pro_rx_tick()) if the packet with CHECK is lost
+			if ((result == false) || (pro_rx_ack_count(PRX, recv_pktid, link_recv) == false))
+				return true;
+			pro_rx_check_msg(PRX, &msg_check[0], PRX->ack_pktid_end, true);
+#else
+			return true;
 #endif
-
-				if ((src_addr_recv == SESSION->dest_addr) && (dest_addr_recv == SESSION->src_addr))
-				{
-					// 0x38 <-> 00 111 000: mask at Command prefix
-					cmd_prefix = msg_recv[0] & CMD_PREFIX_MASK;
-
-					// ------ SEND command ------
-					if (cmd_prefix == SEND)
-					{
-						// Clear the system time-out
-						SESSION->time_out = 0;
-
-						result = pro_rx_recv_data(&PRO_STATE, &RECV_TAB, SESSION, &msg_recv[0]);
-						//if (result == true)
-						//	MYDEBUG.recv_pkt_session_correct++;
-					}
-
-					// ------ PING, CONFIG, START, CHECK, END command ------
-					else if ((cmd_prefix == PING) || (cmd_prefix == CONFIG) ||
-							 (cmd_prefix == START) || (cmd_prefix == END) ||
-							 (cmd_prefix == CHECK))
-					{
-						// Clear the system time-out
-						SESSION->time_out = 0;
-
-						pro_rx_recv_cmd_send_ack(&PRO_STATE, SESSION, SAR_MSG, &RECV_TAB, &msg_recv[0]);
-						// Ending condition
-						if (PRO_STATE == END)
-						{
-							PRO_STATE = HALT;
-						}
-					}
-				}
-			}
-		} 	//
+		}
 		else
+			pro_rx_check_msg(PRX, &msg_check[0], recv_pktid + 1, false);
+		msg_recv = &msg_check[0];
+		cmd_prefix = CHECK;
+	}
+
+	// ------ PING, CONFIG, START, SETUP, CHECK, END command ------
+	if ((cmd_prefix == PING) || (cmd_prefix == CONFIG) ||
+			 (cmd_prefix == START) || (cmd_prefix == SETUP) ||
+			 (cmd_prefix == END) || (cmd_prefix == CHECK))
+	{
+		// Clear the system time-out
+		SESSION->time_out = 0;
+		SESSION->link = link_recv;
+		if (cmd_prefix == CHECK)
 		{
-			hal_delay_us(SESS_WAIT_RECV);
+			PRX->ack_count = 0;
+			PRX->ack_pktid_end = 0;
+			PRX->ack_us = 0;
+		}
+		if ((cmd_prefix == PING) || (cmd_prefix == SETUP))
+		{
+			SESSION->sess_id = sess_id_recv;
+			SESSION->status = SESS_STATUS_OK;
+		}
 
-			// System time-out, if time-out reaches, halt the program
-			SESSION->time_out += SESS_WAIT_RECV;
+		// Deadline of TX, the lost packets of the window are not re-sent
+		if ((cmd_prefix == CHECK) && ((msg_recv[0] & 0x07) == CHECK_SKIP_CPL) &&
+			((PRX->PRO_STATE == SEND) || (PRX->PRO_STATE == CHECK)))
+			pro_rx_give_up(PRX, &msg_recv[0]);
+
+		pro_rx_recv_cmd_send_ack(&PRX->PRO_STATE, SESSION, PRX->SAR_MSG, &PRX->RECV_TAB, &msg_recv[0]);
+		// Ending condition
+		if (PRX->PRO_STATE == END)
+		{
+			PRX->PRO_STATE = HALT;
 		}
-	}	// while;
+	}
+
+	return true;
+}
+
+
+// ===========================================================
+//
+// Time of the CHECK ACK sent on its own
+//
+// ===========================================================
+uint64_t pro_rx_when(pro_rx_t *PRX)
+{
+	if (PRX->ack_us == 0)
+		return PRO_TX_NEVER;
+	return PRX->ack_us;
+}
+
+
+// ===========================================================
+//
+// CHECK ACK on its own, the packet with CHECK is lost
+//
+// ===========================================================
+void pro_rx_tick(pro_rx_t *PRX)
+{
+	uint8_t msg_check[CPARSP + (CHECK_CPL << 1)];
+
+	if ((PRX->ack_us == 0) || (reactor_now() < PRX->ack_us))
+		return;
+	PRX->ack_us = 0;
+	if ((PRX->PRO_STATE != SEND) && (PRX->PRO_STATE != CHECK))
+		return;
+
+	printf("Info: --- --- --- No CHECK after %d packets\n", PRX->ack_count);
+	pro_rx_check_msg(PRX, &msg_check[0], PRX->ack_pktid_end, true);
+	pro_rx_input(PRX, &msg_check[0], PRX->ack_link);
+}
+
+
+// ===========================================================
+//
+// Give up the session of TX
+//
+// ===========================================================
+void pro_rx_abort(msg_t SAR_MSG, uint8_t link)
+{
+	uint16_t msg_length;
+	uint8_t msg_send[SAR_MSG_SIZE];
+
+	printf("Info: --- --- --- Send ABORT acknowledge ... \n");
+	SAR_MSG.cmd_header = ISACK_PREFIX | ABORT;
+	SAR_MSG.cmd_param_length = 0;
+	SAR_MSG.cmd_data_length = 0;
+	msg_length = generate_command(SAR_MSG, NULL, &msg_send[0]);
+	link_tx_frame(link, &msg_send[0], msg_length);
+}
+
+
+// ===========================================================
+//
+// Send the CMD ACK
+//
+// ===========================================================
+void pro_rx(sess_t *SESSION)
+{
+	if (pro_sess_rx_open(SESSION) >= 0)
+		pro_sess_rx_run(NULL);
 }
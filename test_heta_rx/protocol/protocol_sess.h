@@ -0,0 +1,212 @@
+/*
+ * protocol_sess.h
+ *
+ * Session table of the SAR protocol: several TX or RX sessions, keyed by
+ * (source address, destination address, session ID), are interleaved on the links.
+ * A TX session is stepped when it is ready (pro_tx_when(): not waiting for an ACK, the
+ * gap after its last packet or the airtime budget), one frame per step. A session keeps
+ * the link until its window is sent, then the ready session of the lowest tx_class goes
+ * first, then the earliest due time, so a CONTROL session waits one window of a BULK
+ * session at most. The received messages are read by a link input handler (protocol_link.h).
+ * Other threads (e.g. the camera or a telemetry producer) give their sessions to the running
+ * loop with pro_sess_tx_submit(), they are taken at the next window boundary.
+ */
+
+#ifndef PROTOCOL_PROTOCOL_SESS_H_
+#define PROTOCOL_PROTOCOL_SESS_H_
+
+#include <stdint.h>
+
+
+// *******************************************************************************************
+// Session table
+#define SESS_TABLE_MAX			(4)			// concurrent sessions of each role
+#define SESS_ADDR_ANY			(0xFFFF)	// RX: the session takes the first node which sends PING or END
+#define SESS_QUEUE_MAX			(8)			// sessions submitted by other threads and not opened yet (power of 2)
+
+// Called when an RX session is ended by END, return true to wait for the next session
+// of the same node, false to close the entry
+typedef uint8_t (*pro_sess_end_cb)(sess_t *SESSION);
+
+// Called when a TX session is closed (SESSION->status tells how), the session can be
+// given again to pro_sess_tx_open() or pro_sess_tx_submit()
+typedef void (*pro_sess_tx_end_cb)(sess_t *SESSION);
+
+
+// =========================================================================================================================================
+// *******************************************************************************************
+// Function:
+//		int8_t pro_sess_tx_open(sess_t *SESSION)
+//
+// Description:
+//		Add a TX session to the table, a new session ID is given to SESSION. It can be
+//		called while the sessions run (e.g. by a timer of the event loop). A SESS_CLASS_VIDEO
+//		session which is not started at SESSION->due is dropped
+//
+// Parameters:
+//		SESSION		- Session information, must stay valid until pro_sess_tx_run() returns
+//
+// Return:
+//		Entry of the session, -1 if the table is full
+//
+// *******************************************************************************************
+int8_t pro_sess_tx_open(sess_t *SESSION);
+
+
+// *******************************************************************************************
+// Function:
+//		uint8_t pro_sess_tx_submit(sess_t *SESSION)
+//
+// Description:
+//		Give a TX session to the event loop from another thread, without waiting: it is
+//		queued, the loop is woken up (reactor_wake()) and opens it with pro_sess_tx_open().
+//		If the table is full, it is opened when an entry is closed
+//
+// Parameters:
+//		SESSION		- Session information, must stay valid until its end callback
+//
+// Return:
+//		true if the session is queued, false if SESS_QUEUE_MAX sessions are waiting
+//
+// *******************************************************************************************
+uint8_t pro_sess_tx_submit(sess_t *SESSION);
+
+
+// *******************************************************************************************
+// Function:
+//		int8_t pro_sess_tx_abort(sess_t *SESSION)
+//
+// Description:
+//		Give up a TX session, e.g. from a timer of the event loop when a newer frame
+//		replaces it: ABORT is sent if the session is started, SESSION->status is
+//		SESS_STATUS_ABORTED and the entry is closed
+//
+// Parameters:
+//		SESSION		- Session given to pro_sess_tx_open()
+//
+// Return:
+//		Entry of the session, -1 if it is not open
+//
+// *******************************************************************************************
+int8_t pro_sess_tx_abort(sess_t *SESSION);
+
+
+// *******************************************************************************************
+// Function:
+//		void pro_sess_tx_run(void)
+//
+// Description:
+//		Run all open TX sessions until each one is ended or timed out. Each session takes
+//		a step from the event loop (utils/reactor.h) at once after its ACK, or when the RTO
+//		of its command is reached, so that a window of one session is sent while the others
+//		wait for their CHECK ACK. Each ACK is given to the session of its
+//		(source address, destination address, session ID)
+//
+// Parameters:
+//		None
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void pro_sess_tx_run(void);
+
+
+// =========================================================================================================================================
+// *******************************************************************************************
+// Function:
+//		int8_t pro_sess_rx_open(sess_t *SESSION)
+//
+// Description:
+//		Add an RX session to the table
+//
+// Parameters:
+//		SESSION		- Session information, SESSION->dest_addr can be SESS_ADDR_ANY
+//
+// Return:
+//		Entry of the session, -1 if the table is full
+//
+// *******************************************************************************************
+int8_t pro_sess_rx_open(sess_t *SESSION);
+
+
+// *******************************************************************************************
+// Function:
+//		void pro_sess_rx_run(pro_sess_end_cb sess_end)
+//
+// Description:
+//		Receive on all open RX sessions until each one is closed, or until none has had
+//		a command for SESS_TIME_OUT. A session timed out alone leaves its entry waiting
+//		for the next one (back to SESS_ADDR_ANY if it was opened so).
+//		Each message is given to the session of its (source address, destination address,
+//		session ID), a PING (or a re-sent END) of an unknown node takes a free
+//		SESS_ADDR_ANY entry. The event loop sleeps until a message or a time-out
+//
+// Parameters:
+//		sess_end	- Called after END, NULL closes the entry
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void pro_sess_rx_run(pro_sess_end_cb sess_end);
+
+
+// *******************************************************************************************
+// Function:
+//		void pro_sess_run(pro_sess_end_cb sess_end)
+//
+// Description:
+//		Run the TX and RX sessions in the same event loop, e.g. a node which sends its
+//		frames and receives the frames of the other nodes, until both tables are empty
+//
+// Parameters:
+//		sess_end	- Called after END of an RX session, NULL closes the entry
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void pro_sess_run(pro_sess_end_cb sess_end);
+
+
+// *******************************************************************************************
+// Function:
+//		void pro_sess_serve(pro_sess_tx_end_cb tx_end, pro_sess_end_cb rx_end)
+//
+// Description:
+//		Run the TX and RX sessions and open the submitted ones, until pro_sess_stop()
+//		is called and all sessions are ended. The TX sessions of all classes share the
+//		loop, so a CONTROL session which is submitted during a video frame is sent at
+//		the end of the current window
+//
+// Parameters:
+//		tx_end		- Called when a TX session is closed, can be NULL
+//		rx_end		- Called after END of an RX session, NULL closes the entry
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void pro_sess_serve(pro_sess_tx_end_cb tx_end, pro_sess_end_cb rx_end);
+
+
+// *******************************************************************************************
+// Function:
+//		void pro_sess_stop(void)
+//
+// Description:
+//		pro_sess_serve() returns when the open and the submitted sessions are ended.
+//		It can be called from any thread
+//
+// Parameters:
+//		None
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void pro_sess_stop(void);
+
+
+#endif /* PROTOCOL_PROTOCOL_SESS_H_ */
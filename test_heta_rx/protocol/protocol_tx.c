@@ -3,7 +3,15 @@
 #include "../tal/tal_at86rf212_trx.h"
 #include "../hal/hal_at86rf212_trx_access.h"
 #include "../mydebug/mydebug.h"
+#include "../utils/reactor.h"
 #include "protocol.h"
+#include "protocol_link.h"
+#include "protocol_route.h"
+#include "protocol_rtt.h"
+#include "protocol_sess.h"
+
+
+static uint8_t pro_tx_sess_id;		// ID of the last session started by this node
 
 
 // *********************************************************************************************************************************
@@ -12,9 +20,9 @@
 // Generate the command
 //
 // ===========================================================
-inline void generate_command(msg_t SAR_MSG, uint8_t *cmd_data, uint8_t *msg)
+inline uint16_t generate_command(msg_t SAR_MSG, uint8_t *cmd_data, uint8_t *msg)
 {
-	uint8_t i = 0;
+	uint16_t i = 0;
 	
 	// Generate Command ID
 	msg[1] = SAR_MSG.cmd_header; 			// If the command is ACK command, add ISACK_PREFIX
@@ -23,6 +31,9 @@ inline void generate_command(msg_t SAR_MSG, uint8_t *cmd_data, uint8_t *msg)
 	GET16TO8(msg[2], msg[3], SAR_MSG.src_addr);
 	GET16TO8(msg[4], msg[5], SAR_MSG.dest_addr);
 
+	// Add session ID
+	msg[CSIDP + 1] = SAR_MSG.sess_id;
+
 	// Add Command parameters (if any)
 	i = CPARSP + 1;
 	if (SAR_MSG.cmd_param_length > 0)
@@ -49,100 +60,72 @@ inline void generate_command(msg_t SAR_MSG, uint8_t *cmd_data, uint8_t *msg)
 	// The first byte is the length of raw data in packet
 	// FCS_LEN = 2: 2-byte of hardware CRC-16
 	msg[0] = i + FCS_LEN - 1;
+
+	return (i - 1);
 }
 
 
 // *********************************************************************************************************************************
 // ===========================================================
 //
-// Send the CMD which has ACK (PING, CONFIG, START, END) 
+// Parameter length of CONFIG, SETUP and the object header
 //
 // ===========================================================
-void pro_tx_send_cmd_recv_ack(pro_fsm PRO_STATE, msg_t SAR_MSG, sess_t *SESSION, uint8_t *msg_recv)
+static uint8_t pro_tx_config_cpl(sess_t *SESSION)
 {
-	uint16_t i;
-	uint16_t src_addr_recv, dest_addr_recv;
-	int32_t local_time_out;
-	uint8_t cmd_prefix, ack_recv, cmd_length_recv;
-	uint8_t msg_send[LARGE_BUFFER_SIZE];
+	// has 3 parameters, 5 with the codec, 6 with the reference frame
+	if (SESSION->codec == SESS_CODEC_NONE)
+		return CONFIG_CPL;
+	if (SESSION->codec == SESS_CODEC_DELTA)
+		return CONFIG_DELTA_CPL;
+	return CONFIG_CODEC_CPL;
+}
+
+
+// ===========================================================
+//
+// Send the CMD which has ACK (PING, CONFIG, START, SETUP, CHECK, END)
+//
+// ===========================================================
+static void pro_tx_send_cmd(pro_tx_t *PTX)
+{
+	msg_t SAR_MSG;
+	uint16_t msg_length;
+	uint8_t msg_send[SAR_MSG_SIZE];
 
 	// ------------- Generate command -------------
+	SAR_MSG = PTX->SAR_MSG;
 	SAR_MSG.cmd_param_length = 0;
 	SAR_MSG.cmd_data_length = 0;
-	SAR_MSG.cmd_header = PRO_STATE;		// default for PING, START, END
+	SAR_MSG.cmd_header = PTX->PRO_STATE;	// default for PING, START, END
 
-	if (PRO_STATE == CHECK) {
-		SAR_MSG.cmd_header |= CHECK_CPL;	// has 2 parameters
-		SAR_MSG.cmd_param_length = (CHECK_CPL << 1);
-	}		
+	if (PTX->PRO_STATE == CHECK) {
+		// has 2 parameters, or 3 when the lost packets are given up
+		if (PTX->give_up == 0) {
+			SAR_MSG.cmd_header |= CHECK_CPL;
+			SAR_MSG.cmd_param_length = (CHECK_CPL << 1);
+		}
+		else {
+			SAR_MSG.cmd_header |= CHECK_SKIP_CPL;
+			SAR_MSG.cmd_param_length = (CHECK_SKIP_CPL << 1);
+		}
+	}
 
-	else if (PRO_STATE == CONFIG) {
-		SAR_MSG.cmd_header |= CONFIG_CPL;	// has 3 parameters
-		SAR_MSG.cmd_param_length = (CONFIG_CPL << 1);
+	else if ((PTX->PRO_STATE == CONFIG) || (PTX->PRO_STATE == SETUP)) {
+		SAR_MSG.cmd_header |= pro_tx_config_cpl(PTX->SESSION);
+		SAR_MSG.cmd_param_length = (SAR_MSG.cmd_header & 0x07) << 1;
 	}
 
-	generate_command(SAR_MSG, NULL, &msg_send[0]);
+	msg_length = generate_command(SAR_MSG, NULL, &msg_send[0]);
 
-	// ------------- Send, wait, and check ACK -------------
-	local_time_out = TIME_OUT_1;
-	ack_recv = false;
-	
-	// Start main loop
+	// Send the command, the SEND packets striped before are on air (pro_tx_wait())
+	link_tx_frame(PTX->SESSION->link, &msg_send[0], msg_length);
 
-	while ((SESSION->time_out < SESS_TIME_OUT) && (ack_recv == false))
-	{
-		// Send the command
-		if (local_time_out == TIME_OUT_1)
-		{
-			// Send the command			
-			at86rfx_tx_frame(&msg_send[0]);
-			handle_tal_state();
-		}
-		
-		// Wait for reply
-		else if (IRQ_VALUE() == true)	
-		{
-			trx_irq_handler_cb();
-
-			// If data are already stored
-			if (at86rfx_frame_rx == true)
-			{
-				at86rfx_frame_rx = false;
-				cmd_length_recv = at86rfx_rx_buffer[0] - FCS_LEN;
-				memcpy(&msg_recv[0], &at86rfx_rx_buffer[1], cmd_length_recv);
-
-				// Check whether ACK, source, and destination addresses are correct
-				src_addr_recv = (msg_recv[1] << 8) + msg_recv[2];
-				dest_addr_recv = (msg_recv[3] << 8) + msg_recv[4];
-				
-				if (((msg_recv[0] & ISACK_PREFIX) == ISACK_PREFIX) &&
-					(src_addr_recv == SAR_MSG.dest_addr) &&
-					(dest_addr_recv == SAR_MSG.src_addr))
-				{											
-					// 0x38 <-> 00 111 000: mask at Command prefix
-					cmd_prefix = msg_recv[0] & CMD_PREFIX_MASK;
-					if (cmd_prefix == PRO_STATE)
-					{
-						// Clear the system time-out
-						SESSION->time_out = 0;
-
-						local_time_out = TIME_OUT_1 - 1;
-						ack_recv = true;
-					}
-				}				
-			}
-		}	// no need to wait for IRQ_VALUE goes to 0 because the int32_t code above
-		//
-		hal_delay_us(SESS_WAIT_SEND);
-		if (local_time_out == TIME_OUT_1)
-			local_time_out = 0;
-		else
-			local_time_out += SESS_WAIT_SEND;
-		
-
-		// System time-out, if time-out reaches, halt the program
-		SESSION->time_out += SESS_WAIT_RECV;
-	}
+	// Wait for the ACK, the ACK of a command sent again is not an RTT sample (Karn)
+	PTX->retry = PTX->wait_ack;
+	PTX->wait_ack = true;
+	PTX->sent_us = reactor_now();
+	PTX->rto = rtt_rto(PTX->SAR_MSG.dest_addr);
 }
 
 
@@ -153,25 +136,26 @@ void pro_tx_send_cmd_recv_ack(pro_fsm PRO_STATE, msg_t SAR_MSG, sess_t *SESSION,
 // ===========================================================
 void pro_tx_send_data(msg_t SAR_MSG, sess_t SESSION, uint16_t send_pktid)
 {
-	uint16_t frame_index;
-	uint8_t msg_send[LARGE_BUFFER_SIZE];
+	uint16_t frame_index, msg_length;
+	uint8_t msg_send[SAR_MSG_SIZE];
 
 	// Initialize SAR
 	SAR_MSG.cmd_header = SEND | SEND_CPL;	// has 1 parameter
 	SAR_MSG.cmd_param_length = (SEND_CPL << 1);
-	SAR_MSG.cmd_data_length = SESSION.packet_length;
 
 	frame_index = send_pktid * SESSION.packet_length;
 	// Send data
 	do {
 		GET16TO8(SAR_MSG.cmd_param[0], SAR_MSG.cmd_param[1], send_pktid);
+		// The last packet only carries the rest of the frame
+		SAR_MSG.cmd_data_length = SESSION.packet_length;
+		if (SESSION.packet_length > (SESSION.frame_length - frame_index))
+			SAR_MSG.cmd_data_length = SESSION.frame_length - frame_index;
 		// Make command
-		generate_command(SAR_MSG, &SESSION.frame_data[frame_index], &msg_send[0]);
+		msg_length = generate_command(SAR_MSG, &SESSION.frame_data[frame_index], &msg_send[0]);
 
 		// Send command
-		at86rfx_tx_frame(&msg_send[0]);
-		handle_tal_state();
-		PTX_SEND_WAIT(SESSION.tx_delay);
+		link_send_data(SESSION.link_mode, send_pktid, &msg_send[0], msg_length);
 
 		////// Debug only ///////
 		// printf("Debug: --- --- --- --- Send data from position of %d\n", send_pktid);
@@ -189,249 +173,979 @@ void pro_tx_send_data(msg_t SAR_MSG, sess_t SESSION, uint16_t send_pktid)
 
 // ===========================================================
 //
-// Re-send image data
+// Send one packet of the window, the next one waits for the gap
 //
 // ===========================================================
-void pro_tx_resend_data(msg_t SAR_MSG, sess_t SESSION, scrp_t RECV_TAB)
+static void pro_tx_send_packet(pro_tx_t *PTX, uint16_t send_pktid)
 {
-	uint16_t i, j, k, n;
-	uint16_t send_pktid;
-	uint16_t frame_index;
-	uint8_t msg_send[LARGE_BUFFER_SIZE];
+	sess_t SESSION;
 
-	// Initialize SAR
+	SESSION = *PTX->SESSION;
+	SESSION.window_size = 1;
+	pro_tx_send_data(PTX->SAR_MSG, SESSION, send_pktid);
+	PTX->pace_us = reactor_now() + SESSION.tx_delay;
+}
+
+
+// ===========================================================
+//
+// Gap and airtime before the next frame, true if it must wait
+//
+// ===========================================================
+static uint8_t pro_tx_wait(pro_tx_t *PTX, uint8_t data, uint8_t flush)
+{
+	sess_t *SESSION;
+	uint32_t wait;
+	uint64_t now;
+
+	SESSION = PTX->SESSION;
+	now = reactor_now();
+	if (PTX->pace_us > now)
+		return true;
+
+	// A SEND packet waits for the airtime budget, a command or CHECK for the packets striped before it
+	wait = 0;
+	if (data == true)
+		wait = link_wait(SESSION->link_mode, PTX->SAR_MSG.dest_addr, SESSION->sess_id,
+						 CPARSP + (SEND_CPL << 1) + SESSION->packet_length + 2);
+	if ((wait == 0) && (flush == true) && (link_idle() == false))
+		wait = SESS_WAIT_SEND;
+	if (wait == 0)
+		return false;
+
+	PTX->pace_us = now + wait;
+	return true;
+}
+
+
+// ===========================================================
+//
+// Parameters of CHECK
+//
+// ===========================================================
+static void pro_tx_check_param(pro_tx_t *PTX)
+{
+	GET16TO8(PTX->SAR_MSG.cmd_param[0], PTX->SAR_MSG.cmd_param[1], PTX->chk_pktid_start);	// RECV_TAB.pktid_base = chk_pktid_start
+	GET16TO8(PTX->SAR_MSG.cmd_param[2], PTX->SAR_MSG.cmd_param[3], PTX->chk_pktid_end);
+	GET16TO8(PTX->SAR_MSG.cmd_param[4], PTX->SAR_MSG.cmd_param[5], PTX->give_up);
+}
+
+
+// ===========================================================
+//
+// Re-send one packet, with CHECK if check is true
+//
+// ===========================================================
+static void pro_tx_resend_packet(pro_tx_t *PTX, uint16_t send_pktid, uint8_t check)
+{
+	msg_t SAR_MSG;
+	sess_t *SESSION;
+	uint16_t frame_index, msg_length;
+	uint8_t msg_send[SAR_MSG_SIZE];
+
+	SESSION = PTX->SESSION;
+	SAR_MSG = PTX->SAR_MSG;
 	SAR_MSG.cmd_header = SEND | SEND_CPL;	// has 1 parameter
 	SAR_MSG.cmd_param_length = (SEND_CPL << 1);
-	SAR_MSG.cmd_data_length = SESSION.packet_length;
+	if (check == true)
+		SAR_MSG.cmd_header |= CHECK_REQ_PREFIX;
+
+	GET16TO8(SAR_MSG.cmd_param[0], SAR_MSG.cmd_param[1], send_pktid);
+	frame_index = send_pktid * SESSION->packet_length;
+	SAR_MSG.cmd_data_length = SESSION->packet_length;
+	if (SESSION->packet_length > (SESSION->frame_length - frame_index))
+		SAR_MSG.cmd_data_length = SESSION->frame_length - frame_index;
+	// Make command
+	msg_length = generate_command(SAR_MSG, &SESSION->frame_data[frame_index], &msg_send[0]);
+
+	// Send command on the healthiest link, with CHECK the packets striped before are on air (pro_tx_wait())
+	link_resend_data(SESSION->link_mode, send_pktid, &msg_send[0], msg_length);
+	PTX->pace_us = reactor_now() + SESSION->tx_delay;
+}
 
-	// printf("RECV_TAB.length = %d:\n", RECV_TAB.length);
-	// for (i = 0; i < (SESSION.window_size >> 3); ++i)
-	//	printf("%x ", RECV_TAB.table[i]);
-	// printf("\n");
 
-	// Read table and re-send data
-	i = 0;
-	do {
-		n = RECV_TAB.table[i];
-		// If there is any loss packets
-		if (n != 0xFF)
-		{
-			// Calculate the packet ID
-			j = 0;
-			k = i << 3;
-			send_pktid = 0;
-			do {
-				if ((n & 0x01) == 0)
-				{
-					send_pktid = RECV_TAB.pktid_update + k + j;
-					// Check the condition:
-					// For example: if there is 28 packets left -> table will be ff ff ff f0
-					// We only count ff ff ff f
-					if (send_pktid < SESSION.num_of_packet)
-					{
-						GET16TO8(SAR_MSG.cmd_param[0], SAR_MSG.cmd_param[1], send_pktid);
-						frame_index = send_pktid * SESSION.packet_length;
-						// Make command
-						generate_command(SAR_MSG, &SESSION.frame_data[frame_index], &msg_send[0]);
-						// Send command
-						at86rfx_tx_frame(&msg_send[0]);
-						handle_tal_state();
-						PTX_SEND_WAIT(SESSION.tx_delay);
+#if SAR_USED_SEND_CHECK == 1
+// ===========================================================
+//
+// Send the CHECK of the window with its last packet
+//
+// ===========================================================
+static void pro_tx_send_check(pro_tx_t *PTX, uint16_t send_pktid)
+{
+	printf("Info: --- --- --- Send CHECK with packet %d ... \n", send_pktid);
+	pro_tx_check_param(PTX);
+	pro_tx_resend_packet(PTX, send_pktid, true);
+
+	// Wait for the CHECK ACK, CHECK is sent after the RTO if the packet or the ACK is lost
+	PTX->PRO_STATE = CHECK;
+	PTX->wait_ack = true;
+	PTX->retry = false;
+	PTX->sent_us = reactor_now();
+	PTX->rto = rtt_rto(PTX->SAR_MSG.dest_addr);
+}
+#endif
+
+
+// ===========================================================
+//
+// First lost packet of the received-data-table from pktid
+//
+// ===========================================================
+static uint16_t pro_tx_next_lost(pro_tx_t *PTX, uint16_t pktid)
+{
+	uint16_t j;
+
+	// For example: if there is 28 packets left -> table will be ff ff ff f0
+	// We only count ff ff ff f
+	for (; pktid < PTX->SESSION->num_of_packet; ++pktid)
+	{
+		j = pktid - PTX->RECV_TAB.pktid_update;
+		if ((j >> 3) >= PTX->RECV_TAB.length)
+			break;
+		if ((PTX->RECV_TAB.table[j >> 3] & (0x1 << (j % 8))) == 0)
+			return pktid;
+	}
+	return PTX->SESSION->num_of_packet;
+}
+
+
+// ===========================================================
+//
+// Re-send image data
+//
+// ===========================================================
+void pro_tx_resend_data(pro_tx_t *PTX)
+{
+	sess_t *SESSION;
+	uint16_t send_pktid;
+	uint8_t last;
+
+	SESSION = PTX->SESSION;
+
+	// One lost packet per step, the last one is known when there is no other after it
+	send_pktid = pro_tx_next_lost(PTX, PTX->resend_pktid);
+	if (send_pktid >= SESSION->num_of_packet)
+	{
+		PTX->PRO_STATE = CHECK;
+		return;
+	}
+	last = (pro_tx_next_lost(PTX, send_pktid + 1) >= SESSION->num_of_packet) ? true : false;
+
+#if SAR_USED_SEND_CHECK == 1
+	if (pro_tx_wait(PTX, true, last) == true)
+		return;
+	if (PTX->resend_pktid == PTX->RECV_TAB.pktid_update)
+		printf("Info: --- --- --- Send RESEND ... \n");
+	if (last == true)
+		pro_tx_send_check(PTX, send_pktid);
+	else
+		pro_tx_resend_packet(PTX, send_pktid, false);
+#else
+	if (pro_tx_wait(PTX, true, false) == true)
+		return;
+	if (PTX->resend_pktid == PTX->RECV_TAB.pktid_update)
+		printf("Info: --- --- --- Send RESEND ... \n");
+	pro_tx_resend_packet(PTX, send_pktid, false);
+	if (last == true)
+		PTX->PRO_STATE = CHECK;
+#endif
+	PTX->resend_pktid = send_pktid + 1;
 
 #if DEBUG_INFO == 1		// ----------------------------------------
-						// printf("Debug: --- --- --- --- Re-send data from position of %d\n", send_pktid);
-						++MYDEBUG.loss_msg_session[MYDEBUG.loss_msg_index];
+	// printf("Debug: --- --- --- --- Re-send data from position of %d\n", send_pktid);
+	++MYDEBUG.loss_msg_session[MYDEBUG.loss_msg_index];
 #endif
+}
 
-					}
-				}
-				n >>= 1;
-				++j;
-			} while ((j < 8) && (send_pktid < SESSION.num_of_packet));
+
+// ===========================================================
+//
+// Deadline: keep only the lost packets in SESSION->must
+//
+// ===========================================================
+static uint16_t pro_tx_give_up(pro_tx_t *PTX)
+{
+	sess_t *SESSION;
+	uint16_t i, j, pktid, must_lost;
+	uint8_t bit_select;
+
+	SESSION = PTX->SESSION;
+	PTX->give_up = 0;
+	must_lost = 0;
+	for (i = 0; i < PTX->RECV_TAB.length; ++i)
+	{
+		for (j = 0; j < 8; ++j)
+		{
+			pktid = PTX->RECV_TAB.pktid_update + (i << 3) + j;
+			bit_select = 0x1 << j;
+			if ((pktid >= PTX->chk_pktid_end) || ((PTX->RECV_TAB.table[i] & bit_select) != 0))
+				continue;
+
+			if ((SESSION->must != NULL) && ((SESSION->must[pktid >> 3] & (0x1 << (pktid % 8))) != 0))
+				++must_lost;
+			else
+			{
+				// Not re-sent any more
+				PTX->RECV_TAB.table[i] |= bit_select;
+				++PTX->give_up;
+			}
 		}
-		++i;
+	}
+	return must_lost;
+}
+
 
-	} while (i < RECV_TAB.length);
+// ===========================================================
+//
+// Configuration parameters of CONFIG and SETUP
+//
+// ===========================================================
+static void pro_tx_config_param(sess_t *SESSION, msg_t *SAR_MSG)
+{
+	printf("Debug: --- --- --- --- Frame length = %d, packet length = %d, Number of packets = %d\n", SESSION->frame_length, SESSION->packet_length, SESSION->num_of_packet);
+	// Put frame_length, packet_length, and num_of_packet to cmd_param in SAR message.
+	GET16TO8(SAR_MSG->cmd_param[0], SAR_MSG->cmd_param[1], SESSION->frame_length);
+	GET16TO8(SAR_MSG->cmd_param[2], SAR_MSG->cmd_param[3], SESSION->packet_length);
+	GET16TO8(SAR_MSG->cmd_param[4], SAR_MSG->cmd_param[5], SESSION->num_of_packet);
+	GET16TO8(SAR_MSG->cmd_param[6], SAR_MSG->cmd_param[7], SESSION->codec);
+	GET16TO8(SAR_MSG->cmd_param[8], SAR_MSG->cmd_param[9], SESSION->raw_length);
+	GET16TO8(SAR_MSG->cmd_param[10], SAR_MSG->cmd_param[11], SESSION->ref_id);
 }
 
 
+#if SAR_USED_OBJECT == 1
 // ===========================================================
 //
-// Protocol for send progress
+// Send the header of the object, SEND without data and without ACK
 //
 // ===========================================================
-void pro_tx(sess_t *SESSION)
+static void pro_tx_send_header(pro_tx_t *PTX)
 {
-	// SAR message
 	msg_t SAR_MSG;
-	scrp_t RECV_TAB;	// Send Check Re-send (SCR)
-	pro_fsm PRO_STATE;
+	uint16_t msg_length;
+	uint8_t msg_send[SAR_MSG_SIZE];
+
+	printf("Info: --- --- --- Send header of object %d ... \n", PTX->SESSION->sess_id);
+	SAR_MSG = PTX->SAR_MSG;
+	pro_tx_config_param(PTX->SESSION, &SAR_MSG);
+	SAR_MSG.cmd_header = SEND | pro_tx_config_cpl(PTX->SESSION);
+	SAR_MSG.cmd_param_length = (SAR_MSG.cmd_header & 0x07) << 1;
+	SAR_MSG.cmd_data_length = 0;
+	msg_length = generate_command(SAR_MSG, NULL, &msg_send[0]);
+	link_tx_frame(PTX->SESSION->link, &msg_send[0], msg_length);
 
-	uint16_t i, tmp_length;
-	uint8_t msg_recv[LARGE_BUFFER_SIZE];
-	uint16_t packet_length_ack, frame_length_ack, num_of_packet_ack;
-	uint16_t send_pktid, chk_pktid_start, chk_pktid_end;	// send and check packet ID (start, end)
-	
+	PTX->header = OBJECT_HEADER_SENT;
+	PTX->pace_us = reactor_now() + PTX->SESSION->tx_delay;
+}
+#endif
+
+
+// ===========================================================
+//
+// Check the configuration parameters of CONFIG ACK and SETUP ACK
+//
+// ===========================================================
+static uint8_t pro_tx_check_config(pro_tx_t *PTX, uint8_t *msg_recv)
+{
+	sess_t *SESSION;
+	uint16_t packet_length_ack, frame_length_ack, num_of_packet_ack, codec_ack, raw_length_ack, ref_id_ack;
+
+	SESSION = PTX->SESSION;
+	frame_length_ack  = (msg_recv[CPARSP] << 8)     + msg_recv[CPARSP + 1];
+	packet_length_ack = (msg_recv[CPARSP + 2] << 8) + msg_recv[CPARSP + 3];
+	num_of_packet_ack = (msg_recv[CPARSP + 4] << 8) + msg_recv[CPARSP + 5];
+	codec_ack = SESS_CODEC_NONE;
+	raw_length_ack = frame_length_ack;
+	if ((msg_recv[0] & 0x07) >= CONFIG_CODEC_CPL)
+	{
+		codec_ack      = (msg_recv[CPARSP + 6] << 8) + msg_recv[CPARSP + 7];
+		raw_length_ack = (msg_recv[CPARSP + 8] << 8) + msg_recv[CPARSP + 9];
+	}
+	ref_id_ack = SESSION->ref_id;
+	if ((msg_recv[0] & 0x07) >= CONFIG_DELTA_CPL)
+		ref_id_ack     = (msg_recv[CPARSP + 10] << 8) + msg_recv[CPARSP + 11];
+
+	if ((SESSION->frame_length  == frame_length_ack) &&
+		(SESSION->packet_length == packet_length_ack) &&
+		(SESSION->num_of_packet == num_of_packet_ack) &&
+		(SESSION->codec != SESS_CODEC_NONE) && (codec_ack == SESS_CODEC_NONE))
+	{
+		// RX refuses the codec (e.g. it has another reference frame), the
+		// session ends here and the application sends the frame in full
+		printf("Info: --- --- --- Codec %d is refused\n", SESSION->codec);
+		SESSION->codec = SESS_CODEC_NONE;
+		PTX->PRO_STATE = HALT;
+		return false;
+	}
+
+	if ((SESSION->frame_length  != frame_length_ack) ||
+		(SESSION->packet_length != packet_length_ack) ||
+		(SESSION->num_of_packet != num_of_packet_ack) ||
+		(SESSION->codec != codec_ack) ||
+		(SESSION->raw_length != raw_length_ack) ||
+		(SESSION->ref_id != ref_id_ack))
+	{
+		// Send the command again at once
+		PTX->wait_ack = true;
+		PTX->sent_us = 0;
+		return false;
+	}
+	return true;
+}
+
+
+// ===========================================================
+//
+// Start a new window of SEND packets
+//
+// ===========================================================
+static void pro_tx_window_start(pro_tx_t *PTX)
+{
+	sess_t *SESSION;
+
+	SESSION = PTX->SESSION;
+	printf("Info: --- --- --- Send SEND ... \n");
+	if ((PTX->send_pktid + SESSION->window_size) > SESSION->num_of_packet)
+		SESSION->window_size = SESSION->num_of_packet - PTX->send_pktid;
+
+	PTX->tmp_length = SESSION->window_size >> 3;
+	if ((SESSION->window_size % 8) != 0)
+		++PTX->tmp_length;
+
+	link_window_start(SESSION->sess_id, PTX->send_pktid);
+}
+
+
+// ===========================================================
+//
+// Start a TX session
+//
+// ===========================================================
+void pro_tx_init(pro_tx_t *PTX, sess_t *SESSION)
+{
+	// A new session ID for each session of this node, 0 is never used
+	++pro_tx_sess_id;
+	if (pro_tx_sess_id == 0)
+		++pro_tx_sess_id;
+	SESSION->sess_id = pro_tx_sess_id;
+	SESSION->link = (SESSION->link_mode == LINK_MODE_ML7396) ? LINK_ML7396 : LINK_AT86RF212;
+	if (SESSION->codec == SESS_CODEC_NONE)
+		SESSION->raw_length = SESSION->frame_length;
+
+	PTX->SESSION = SESSION;
+	PTX->SAR_MSG.src_addr = SESSION->src_addr;
+	PTX->SAR_MSG.dest_addr = SESSION->dest_addr;
+	PTX->SAR_MSG.sess_id = SESSION->sess_id;
+#if SAR_USED_SETUP == 1
+	PTX->PRO_STATE = SETUP;
+#else
+	PTX->PRO_STATE = PING;
+#endif
+	PTX->wait_ack = false;
+	PTX->sent_us = 0;
+	PTX->rto = 0;
+	PTX->retry = false;
+	PTX->tick_us = reactor_now();
+	PTX->send_pktid = 0;
+	PTX->chk_pktid_start = 0;
+	PTX->chk_pktid_end = 0;
+	PTX->tmp_length = 0;
+	PTX->fwd_pktid = 0;
+	PTX->resend_pktid = 0;
+	PTX->pace_us = 0;
+	PTX->ready = NULL;
+	PTX->deadline_us = 0;
+	PTX->give_up = 0;
+	PTX->header = OBJECT_HEADER_NONE;
+	PTX->RECV_TAB.pktid_base = 0;
+	PTX->RECV_TAB.reset_req = 0;
+	SESSION->lost = 0;
+	SESSION->status = SESS_STATUS_OK;
+
+#if SAR_USED_OBJECT == 1
+	// A new object of the association, its header comes with the first SEND
+	if (rtt_assoc(SESSION->dest_addr) == true)
+	{
+		PTX->PRO_STATE = SEND;
+		PTX->header = OBJECT_HEADER_SEND;
+		if (SESSION->deadline > 0)
+			PTX->deadline_us = reactor_now() + SESSION->deadline;
+	}
+#endif
+}
+
+
+// ===========================================================
+//
+// The first command of the session is sent
+//
+// ===========================================================
+uint8_t pro_tx_started(pro_tx_t *PTX)
+{
+	return ((PTX->wait_ack == true) || ((PTX->PRO_STATE != PING) && (PTX->PRO_STATE != SETUP))) ? true : false;
+}
+
+
+// ===========================================================
+//
+// Give up the session
+//
+// ===========================================================
+void pro_tx_abort(pro_tx_t *PTX, uint8_t status)
+{
+	msg_t SAR_MSG;
+	uint16_t msg_length;
+	uint8_t msg_send[SAR_MSG_SIZE];
+
+	// RX may have the session open, ABORT is sent once without ACK
+	if (pro_tx_started(PTX) == true)
+	{
+		printf("Info: --- --- --- Send ABORT ... \n");
+		SAR_MSG = PTX->SAR_MSG;
+		SAR_MSG.cmd_header = ABORT;
+		SAR_MSG.cmd_param_length = 0;
+		SAR_MSG.cmd_data_length = 0;
+		msg_length = generate_command(SAR_MSG, NULL, &msg_send[0]);
+		link_flush();
+		link_tx_frame(PTX->SESSION->link, &msg_send[0], msg_length);
+	}
+
+	PTX->SESSION->status = status;
+	PTX->wait_ack = false;
+	PTX->PRO_STATE = HALT;
+#if SAR_USED_OBJECT == 1
+	// The next object sets the association up again
+	rtt_assoc_set(PTX->SAR_MSG.dest_addr, false);
+#endif
+}
+
+
+// ===========================================================
+//
+// SETUP is sent, the first window follows it without waiting for its ACK
+//
+// ===========================================================
+static uint8_t pro_tx_setup_window(pro_tx_t *PTX)
+{
+	return ((PTX->PRO_STATE == SETUP) && (PTX->wait_ack == true) && (PTX->sent_us > 0) && (PTX->ready == NULL) &&
+			(PTX->fwd_pktid < PTX->SESSION->num_of_packet) &&
+			(PTX->fwd_pktid < PTX->send_pktid + PTX->SESSION->window_size)) ? true : false;
+}
+
+
+// ===========================================================
+//
+// Relay: the next packet of the window is not received from the previous hop yet
+//
+// ===========================================================
+static uint8_t pro_tx_fwd_wait(pro_tx_t *PTX)
+{
+	return ((PTX->ready != NULL) && (PTX->fwd_pktid < PTX->SESSION->num_of_packet) &&
+			((PTX->ready[PTX->fwd_pktid >> 3] & (0x1 << (PTX->fwd_pktid % 8))) == 0)) ? true : false;
+}
+
+
+// ===========================================================
+//
+// Protocol for send progress, one step
+//
+// ===========================================================
+void pro_tx_step(pro_tx_t *PTX)
+{
+	sess_t *SESSION;
+	uint16_t pktid_end;
+	uint8_t setup;
+	uint32_t time_out;
+
+	SESSION = PTX->SESSION;
 
-	// Initialization
-	SAR_MSG.src_addr = SESSION->src_addr;
-	SAR_MSG.dest_addr = SESSION->dest_addr;
-	PRO_STATE = PING;
-	send_pktid = 0;
-	chk_pktid_start = 0;
-	chk_pktid_end = 0;
-	RECV_TAB.pktid_base = 0;
-	RECV_TAB.reset_req = 0;
+	// The first window after SETUP, one packet per step.
+	// If SETUP is lost, RX drops the window and CHECK finds the lost packets
+	if (pro_tx_setup_window(PTX) == true)
+	{
+		if (pro_tx_wait(PTX, true, false) == true)
+			return;
+		pro_tx_send_packet(PTX, PTX->fwd_pktid);
+		++PTX->fwd_pktid;
+
+		// The ACK may come after the window: the RTO starts after the last packet, and there is no RTT sample
+		PTX->retry = true;
+		PTX->sent_us = reactor_now();
+		return;
+	}
+
+	// Waiting for reply, send the command again after the RTO of the peer
+	if (PTX->wait_ack == true)
+	{
+		if ((PTX->sent_us > 0) && ((reactor_now() - PTX->sent_us) < PTX->rto))
+			return;
 
+		if (PTX->sent_us > 0)
+		{
+			// Time-out of the phase: before the first ACK, the peer is unreachable
+			setup = (PTX->PRO_STATE == PING) || (PTX->PRO_STATE == SETUP);
+			if (setup == true)
+				time_out = (SESSION->time_out_setup > 0) ? SESSION->time_out_setup : SESS_TIME_OUT_SETUP;
+			else
+				time_out = (SESSION->time_out_data > 0) ? SESSION->time_out_data : SESS_TIME_OUT_DATA;
+			if (SESSION->time_out >= time_out)
+			{
+				printf("Info: --- --- --- No ACK for %d ms\n", SESSION->time_out / 1000);
+				if (setup == true)
+				{
+					rtt_unreachable(PTX->SAR_MSG.dest_addr);
+					route_invalidate(PTX->SAR_MSG.dest_addr);
+					pro_tx_abort(PTX, SESS_STATUS_UNREACHABLE);
+				}
+				else
+					pro_tx_abort(PTX, SESS_STATUS_TIME_OUT);
+				return;
+			}
+		}
 
-	while ((SESSION->time_out < SESS_TIME_OUT) && (PRO_STATE != HALT))
+		if (pro_tx_wait(PTX, false, true) == true)
+			return;
+		// The command or its ACK is lost
+		if ((PTX->sent_us > 0) && (PTX->header != OBJECT_HEADER_AGAIN))
+			rtt_backoff(PTX->SAR_MSG.dest_addr);
+#if SAR_USED_OBJECT == 1
+		// RX may have lost the header, without it the object is not taken: the header goes
+		// first, the command after the gap
+		if (PTX->header == OBJECT_HEADER_SENT)
+		{
+			pro_tx_send_header(PTX);
+			PTX->header = OBJECT_HEADER_AGAIN;
+			return;
+		}
+		if (PTX->header == OBJECT_HEADER_AGAIN)
+			PTX->header = OBJECT_HEADER_SENT;
+#endif
+		pro_tx_send_cmd(PTX);
+		return;
+	}
+
+	// A peer which was unreachable is held down, the session fails without airtime
+	if ((pro_tx_started(PTX) == false) && (rtt_down(PTX->SAR_MSG.dest_addr) == true))
 	{
-		switch (PRO_STATE) {
+		printf("Info: --- --- --- 0x%04x is held down\n", PTX->SAR_MSG.dest_addr);
+		SESSION->status = SESS_STATUS_UNREACHABLE;
+		PTX->PRO_STATE = HALT;
+		return;
+	}
+
+	switch (PTX->PRO_STATE) {
 
-			// ---------- Send PING and wait for PING_ACK ----------
-			case PING:
-				printf("Info: --- --- --- Send PING ... \n");
-				pro_tx_send_cmd_recv_ack(PING, SAR_MSG, SESSION, &msg_recv[0]);
-				PRO_STATE = CONFIG;
+		// ---------- Send PING and wait for PING_ACK ----------
+		case PING:
+			if (pro_tx_wait(PTX, false, true) == true)
 				break;
+			printf("Info: --- --- --- Send PING ... \n");
+			pro_tx_send_cmd(PTX);
+			break;
 
-			// ---------- Send CONFIG and wait for CONFIG_ACK ----------
-			case CONFIG:
-				printf("Info: --- --- --- Send CONFIG ... \n");
-				printf("Debug: --- --- --- --- Frame length = %d, packet length = %d, Number of packets = %d\n", SESSION->frame_length, SESSION->packet_length, SESSION->num_of_packet);
-				// Put frame_length, packet_length, and num_of_packet to cmd_param in SAR message.
-				GET16TO8(SAR_MSG.cmd_param[0], SAR_MSG.cmd_param[1], SESSION->frame_length);
-				GET16TO8(SAR_MSG.cmd_param[2], SAR_MSG.cmd_param[3], SESSION->packet_length);
-				GET16TO8(SAR_MSG.cmd_param[4], SAR_MSG.cmd_param[5], SESSION->num_of_packet);
-
-				do 	{
-						pro_tx_send_cmd_recv_ack(CONFIG, SAR_MSG, SESSION, &msg_recv[0]);
-
-						if (SESSION->time_out < SESS_TIME_OUT)
-						{
-							// Check whether configuration parameters are correct
-							frame_length_ack  = (msg_recv[CPARSP] << 8)     + msg_recv[CPARSP + 1];
-							packet_length_ack = (msg_recv[CPARSP + 2] << 8) + msg_recv[CPARSP + 3];
-							num_of_packet_ack = (msg_recv[CPARSP + 4] << 8) + msg_recv[CPARSP + 5];
-						}
-					} while ((SESSION->time_out < SESS_TIME_OUT) &&
-							 ((SESSION->frame_length  != frame_length_ack) ||
-							 (SESSION->packet_length != packet_length_ack) ||
-							 (SESSION->num_of_packet != num_of_packet_ack)));
-
-				PRO_STATE = START;
+		// ---------- Send CONFIG and wait for CONFIG_ACK ----------
+		case CONFIG:
+			if (pro_tx_wait(PTX, false, true) == true)
+				break;
+			printf("Info: --- --- --- Send CONFIG ... \n");
+			pro_tx_config_param(SESSION, &PTX->SAR_MSG);
+			pro_tx_send_cmd(PTX);
+			break;
+
+		// ---------- Send START and wait for START ACK ----------
+		case START:
+			if (pro_tx_wait(PTX, false, true) == true)
 				break;
+			printf("Info: --- --- --- Send START ... \n");
+			pro_tx_send_cmd(PTX);
+			break;
 
-			// ---------- Send START and wait for START ACK ----------
-			case START:
-				printf("Info: --- --- --- Send START ... \n");
-				pro_tx_send_cmd_recv_ack(START, SAR_MSG, SESSION, &msg_recv[0]);
-				PRO_STATE = SEND;
+		// ---------- Send SETUP and the first window, wait for SETUP ACK ----------
+		case SETUP:
+			if (pro_tx_wait(PTX, false, true) == true)
 				break;
+			printf("Info: --- --- --- Send SETUP ... \n");
+			pro_tx_config_param(SESSION, &PTX->SAR_MSG);
+			pro_tx_send_cmd(PTX);
 
-			// ---------- Send SEND command ----------
-			case SEND:
-				if (send_pktid < SESSION->num_of_packet)
-				{
-					printf("Info: --- --- --- Send SEND ... \n");
-					if ((send_pktid + SESSION->window_size) > SESSION->num_of_packet)
-						SESSION->window_size = SESSION->num_of_packet - send_pktid;
+			// The first window does not wait for the ACK (relay: the packets come later)
+			if ((PTX->ready == NULL) && (SESSION->num_of_packet > 0))
+			{
+				pro_tx_window_start(PTX);
+				PTX->fwd_pktid = PTX->send_pktid;
+			}
+			break;
+
+		// ---------- Send SEND command ----------
+		case SEND:
+			if (PTX->send_pktid >= SESSION->num_of_packet)
+			{
+				PTX->PRO_STATE = END;
+				break;
+			}
 
+#if SAR_USED_OBJECT == 1
+			// The first SEND of the object is its header (relay: once the first packet is here)
+			if (PTX->header == OBJECT_HEADER_SEND)
+			{
+				if ((pro_tx_fwd_wait(PTX) == true) || (pro_tx_wait(PTX, false, true) == true))
+					break;
+				pro_tx_send_header(PTX);
+				break;
+			}
+#endif
 
-					tmp_length = SESSION->window_size >> 3;
-					if ((SESSION->window_size % 8) != 0)
-						++tmp_length;
+			// New window, once its first packet can go
+			if (PTX->fwd_pktid == PTX->send_pktid)
+			{
+				if ((pro_tx_fwd_wait(PTX) == true) || (pro_tx_wait(PTX, true, false) == true))
+					break;
+				pro_tx_window_start(PTX);
+			}
 
-					pro_tx_send_data(SAR_MSG, *SESSION, send_pktid);
+			// One packet per step, in packet ID order (relay: once it is received from the previous hop)
+			pktid_end = PTX->send_pktid + SESSION->window_size;
+			if (PTX->fwd_pktid < pktid_end)
+			{
+				if (pro_tx_fwd_wait(PTX) == true)
+					break;
+#if (SAR_USED_SEND_CHECK == 1) && (DEBUG_USED_CHECK == 1)
+				// The last packet is sent with CHECK (relay: CHECK follows the window)
+				if ((PTX->ready == NULL) && (PTX->fwd_pktid == pktid_end - 1))
+				{
+					if (pro_tx_wait(PTX, true, true) == true)
+						break;
+					++PTX->fwd_pktid;
+					PTX->chk_pktid_start = PTX->send_pktid;
+					PTX->chk_pktid_end += SESSION->window_size;
+					pro_tx_send_check(PTX, pktid_end - 1);
+					break;
+				}
+#endif
+				if (pro_tx_wait(PTX, true, false) == true)
+					break;
+				pro_tx_send_packet(PTX, PTX->fwd_pktid);
+				++PTX->fwd_pktid;
+				if (PTX->fwd_pktid < pktid_end)
+					break;
+			}
 
-					chk_pktid_start = send_pktid;
-					chk_pktid_end += SESSION->window_size;
+			PTX->chk_pktid_start = PTX->send_pktid;
+			PTX->chk_pktid_end += SESSION->window_size;
 #if DEBUG_USED_CHECK == 1
-					PRO_STATE = CHECK;
+			PTX->PRO_STATE = CHECK;
 #else
-					PRO_STATE = SEND;
+			PTX->send_pktid += SESSION->window_size;
+			PTX->PRO_STATE = SEND;
 #endif
-				}
-				else
-					PRO_STATE = END;
+			break;
+
+		// ---------- Send CHECK command ----------
+		case CHECK:
+			if (pro_tx_wait(PTX, false, true) == true)
+				break;
+			printf("Info: --- --- --- Send CHECK ... \n");
+			printf("Debug: --- --- --- --- Packet ID start = %d, packet ID end = %d ... \n", PTX->chk_pktid_start, PTX->chk_pktid_end);
+			pro_tx_check_param(PTX);
+			pro_tx_send_cmd(PTX);
+			break;
+
+		// ---------- Send RESEND command ----------
+		case RESEND:
+			pro_tx_resend_data(PTX);
+			break;
+
+		// ---------- Send END command ----------
+		case END:
+			if (pro_tx_wait(PTX, false, true) == true)
 				break;
+			printf("Info: --- --- --- Send END ... \n");
+			pro_tx_send_cmd(PTX);
+			break;
 
-			// ---------- Send CHECK command ----------
-			case CHECK:
-				printf("Info: --- --- --- Send CHECK ... \n");
-				printf("Debug: --- --- --- --- Packet ID start = %d, packet ID end = %d ... \n", chk_pktid_start, chk_pktid_end);
-				GET16TO8(SAR_MSG.cmd_param[0], SAR_MSG.cmd_param[1], chk_pktid_start);	// RECV_TAB.pktid_base = chk_pktid_start
-				GET16TO8(SAR_MSG.cmd_param[2], SAR_MSG.cmd_param[3], chk_pktid_end);
-				SAR_MSG.cmd_param_length = (CHECK_CPL << 1);
+		// --------------------------------------
+		default:
+			break;
 
-				do {
-					pro_tx_send_cmd_recv_ack(CHECK, SAR_MSG, SESSION, &msg_recv[0]);
+	} // switch (PRO_STATE)
+}
 
-					if (SESSION->time_out < SESS_TIME_OUT)
-					{
-						RECV_TAB.pktid_update = (msg_recv[CPARSP] << 8)     + msg_recv[CPARSP + 1];
-						RECV_TAB.length 	= (msg_recv[CPARSP + 2] << 8) + msg_recv[CPARSP + 3];
-						printf("Debug: --- --- --- --- Packet ID update = %d, table length = %d ... \n", RECV_TAB.pktid_update, RECV_TAB.length);
-					}
-				} while ((SESSION->time_out < SESS_TIME_OUT) &&
-						 ((RECV_TAB.pktid_update < chk_pktid_start) ||
-						 (RECV_TAB.pktid_update > chk_pktid_end) ||
-						 (RECV_TAB.length > tmp_length)));
 
+// ===========================================================
+//
+// Time of the next step
+//
+// ===========================================================
+uint64_t pro_tx_when(pro_tx_t *PTX)
+{
+	uint64_t when;
 
+	if (PTX->PRO_STATE == HALT)
+		return PRO_TX_NEVER;
 
+	// The gap or the airtime, at once if it is over
+	when = PTX->pace_us;
+	if (pro_tx_setup_window(PTX) == true)
+		return when;
 
+	// The RTO of the command
+	if (PTX->wait_ack == true)
+	{
+		if ((PTX->sent_us > 0) && (PTX->sent_us + PTX->rto > when))
+			when = PTX->sent_us + PTX->rto;
+		return when;
+	}
 
+	// Relay: the next packet comes from the previous hop
+	if ((PTX->PRO_STATE == SEND) && (PTX->send_pktid < PTX->SESSION->num_of_packet) &&
+		(PTX->fwd_pktid < PTX->send_pktid + PTX->SESSION->window_size) && (pro_tx_fwd_wait(PTX) == true))
+		return PRO_TX_NEVER;
+	return when;
+}
 
 
+// ===========================================================
+//
+// In the middle of a window
+//
+// ===========================================================
+uint8_t pro_tx_burst(pro_tx_t *PTX)
+{
+	if (pro_tx_setup_window(PTX) == true)
+		return true;
+	if (PTX->wait_ack == true)
+		return false;
+	if (PTX->PRO_STATE == RESEND)
+		return true;
+	return ((PTX->PRO_STATE == SEND) && (PTX->fwd_pktid != PTX->send_pktid) &&
+			(PTX->fwd_pktid < PTX->send_pktid + PTX->SESSION->window_size)) ? true : false;
+}
 
-				// Check with system time-out
-				if (SESSION->time_out < SESS_TIME_OUT)
-				{
-					// If there is any error, move to RESEND
-					if (RECV_TAB.length > 0)
-					{
-						memcpy(&RECV_TAB.table[0], &msg_recv[CPARSP + 4], RECV_TAB.length);
-						PRO_STATE = RESEND;
-					}
-					else
-					{
-						send_pktid += SESSION->window_size;
-						PRO_STATE = SEND;
-					}
-
-					printf("Debug: --- --- --- --- Packet ID update = %d, table length = %d\n", RECV_TAB.pktid_update, RECV_TAB.length);
-					for (i = 0; i < RECV_TAB.length; ++i)
-						printf("%x ", RECV_TAB.table[i]);
-					printf("\n");
-				}
 
+// ===========================================================
+//
+// CHECK ACK sent by RX on its own: its table ends at the last packet
+// received, the packets after it up to the CHECK packet ID end are lost
+//
+// ===========================================================
+static void pro_tx_ack_extend(pro_tx_t *PTX, uint16_t pktid_end)
+{
+	uint16_t pktid, j, length;
+
+	length = (pktid_end - PTX->RECV_TAB.pktid_update + 7) >> 3;
+	for (j = 0; j < (length << 3); ++j)
+	{
+		pktid = PTX->RECV_TAB.pktid_update + j;
+		if (pktid >= pktid_end)
+			PTX->RECV_TAB.table[j >> 3] |= (0x1 << (j % 8));
+		else if ((j >> 3) >= PTX->RECV_TAB.length)
+			PTX->RECV_TAB.table[j >> 3] &= ~(0x1 << (j % 8));
+	}
+	PTX->RECV_TAB.length = length;
+}
 
 
+// ===========================================================
+//
+// Receive the ACK of the session
+//
+// ===========================================================
+uint8_t pro_tx_recv_ack(pro_tx_t *PTX, uint8_t *msg_recv)
+{
+	sess_t *SESSION;
+	uint16_t i;
+	uint16_t src_addr_recv, dest_addr_recv;
+	uint8_t cmd_prefix, own;
 
+	SESSION = PTX->SESSION;
 
-				break;
+	// Check whether ACK, source, and destination addresses, and session ID are correct
+	src_addr_recv = (msg_recv[1] << 8) + msg_recv[2];
+	dest_addr_recv = (msg_recv[3] << 8) + msg_recv[4];
+	if (((msg_recv[0] & ISACK_PREFIX) != ISACK_PREFIX) ||
+		(src_addr_recv != PTX->SAR_MSG.dest_addr) ||
+		(dest_addr_recv != PTX->SAR_MSG.src_addr) ||
+		(msg_recv[CSIDP] != PTX->SAR_MSG.sess_id))
+		return false;
 
-			// ---------- Send RESEND command ----------
-			case RESEND:
-				printf("Info: --- --- --- Send RESEND ... \n");
-				pro_tx_resend_data(SAR_MSG, *SESSION, RECV_TAB);
-				PRO_STATE = CHECK;
-				break;
+	// ABORT of RX (a relay whose next hop has given up the frame), the session is over
+	if ((msg_recv[0] & (ABORT_PREFIX | CMD_PREFIX_MASK)) == ABORT)
+	{
+		if (PTX->PRO_STATE == HALT)
+			return false;
+		printf("Info: --- --- --- Session %d is aborted by RX\n", SESSION->sess_id);
+		SESSION->status = SESS_STATUS_ABORTED;
+		PTX->wait_ack = false;
+		PTX->PRO_STATE = HALT;
+#if SAR_USED_OBJECT == 1
+		rtt_assoc_set(PTX->SAR_MSG.dest_addr, false);
+#endif
+		return true;
+	}
 
-			// ---------- Send END command ----------
-			case END:
-				printf("Info: --- --- --- Send END ... \n");
-				pro_tx_send_cmd_recv_ack(END, SAR_MSG, SESSION, &msg_recv[0]);
-				PRO_STATE = HALT;
-				break;
+	// 0x38 <-> 00 111 000: mask at Command prefix
+	cmd_prefix = msg_recv[0] & CMD_PREFIX_MASK;
 
-			// --------------------------------------
-			default:
+#if SAR_USED_OBJECT == 1
+	// RX refuses the codec of the object header with the ACK of SETUP, as it refuses SETUP
+	if ((PTX->header != OBJECT_HEADER_NONE) && (cmd_prefix == SETUP))
+	{
+		if ((PTX->PRO_STATE == HALT) || (SESSION->codec == SESS_CODEC_NONE))
+			return false;
+		printf("Info: --- --- --- Codec %d is refused\n", SESSION->codec);
+		SESSION->codec = SESS_CODEC_NONE;
+		SESSION->time_out = 0;
+		PTX->wait_ack = false;
+		PTX->PRO_STATE = HALT;
+		return true;
+	}
+#endif
+	if (cmd_prefix != PTX->PRO_STATE)
+		return false;
+
+	// RX sends the CHECK ACK on its own when the packet with CHECK is lost
+	own = ((cmd_prefix == CHECK) && ((msg_recv[0] & OWN_ACK_PREFIX) == OWN_ACK_PREFIX)) ? true : false;
+	if ((PTX->wait_ack == false) && (own == false))
+		return false;
+
+	// Clear the system time-out, the RTT is sampled only on the ACK of a CHECK sent once
+	SESSION->time_out = 0;
+	rtt_reachable(PTX->SAR_MSG.dest_addr);
+	if ((PTX->wait_ack == true) && (own == false) && (PTX->retry == false) && (PTX->sent_us > 0))
+		rtt_sample(PTX->SAR_MSG.dest_addr, (uint32_t)(reactor_now() - PTX->sent_us));
+	PTX->wait_ack = false;
+
+	switch (PTX->PRO_STATE) {
+
+		case PING:
+			PTX->PRO_STATE = CONFIG;
+			break;
+
+		case CONFIG:
+			// Check whether configuration parameters are correct
+			if (pro_tx_check_config(PTX, &msg_recv[0]) == true)
+				PTX->PRO_STATE = START;
+			break;
+
+		case SETUP:
+			// SETUP ACK is also the START ACK
+			if (pro_tx_check_config(PTX, &msg_recv[0]) == false)
+				break;
+			// fall through
+		case START:
+			if (SESSION->deadline > 0)
+				PTX->deadline_us = reactor_now() + SESSION->deadline;
+			PTX->PRO_STATE = SEND;
+#if SAR_USED_OBJECT == 1
+			// The next objects of the association need no SETUP
+			rtt_assoc_set(PTX->SAR_MSG.dest_addr, true);
+#endif
+			break;
+
+		case CHECK:
+			// RX has the header of the object
+			PTX->header = OBJECT_HEADER_NONE;
+			PTX->RECV_TAB.pktid_update = (msg_recv[CPARSP] << 8)     + msg_recv[CPARSP + 1];
+			PTX->RECV_TAB.length 	= (msg_recv[CPARSP + 2] << 8) + msg_recv[CPARSP + 3];
+			printf("Debug: --- --- --- --- Packet ID update = %d, table length = %d ... \n", PTX->RECV_TAB.pktid_update, PTX->RECV_TAB.length);
+
+			if ((PTX->RECV_TAB.pktid_update < PTX->chk_pktid_start) ||
+				(PTX->RECV_TAB.pktid_update > PTX->chk_pktid_end) ||
+				(PTX->RECV_TAB.length > PTX->tmp_length))
+			{
+				// Send CHECK again at once, a late CHECK ACK of RX on its own waits for the RTO
+				PTX->wait_ack = true;
+				if (own == false)
+					PTX->sent_us = 0;
 				break;
+			}
+
+			// The lost packets at the end of the window are added to the table
+			if (own == true)
+			{
+				printf("Debug: --- --- --- --- CHECK acknowledge of RX, packets up to %d are lost\n", PTX->chk_pktid_end);
+				memcpy(&PTX->RECV_TAB.table[0], &msg_recv[CPARSP + 4], PTX->RECV_TAB.length);
+				pro_tx_ack_extend(PTX, PTX->chk_pktid_end);
+			}
+
+			// If there is any error, move to RESEND
+			if (PTX->RECV_TAB.length > 0)
+			{
+				if (own == false)
+					memcpy(&PTX->RECV_TAB.table[0], &msg_recv[CPARSP + 4], PTX->RECV_TAB.length);
+				link_update_loss(SESSION->sess_id, PTX->RECV_TAB.pktid_update, PTX->RECV_TAB.length, &PTX->RECV_TAB.table[0]);
+				PTX->PRO_STATE = RESEND;
+				PTX->resend_pktid = PTX->RECV_TAB.pktid_update;
+
+				// After the deadline, RX gives up the window when only the other packets are lost
+				if ((PTX->deadline_us > 0) && (reactor_now() >= PTX->deadline_us))
+				{
+					if (pro_tx_give_up(PTX) == 0)
+						PTX->PRO_STATE = CHECK;
+					else
+						PTX->give_up = 0;
+				}
+			}
+			else
+			{
+				if (PTX->give_up > 0)
+				{
+					printf("Debug: --- --- --- --- %d packets are given up\n", PTX->give_up);
+					SESSION->lost += PTX->give_up;
+					PTX->give_up = 0;
+				}
+				link_update_loss(SESSION->sess_id, PTX->RECV_TAB.pktid_update, 0, NULL);
+				PTX->send_pktid += SESSION->window_size;
+				PTX->PRO_STATE = SEND;
+#if SAR_USED_OBJECT == 1
+				// RX has the whole object, there is no END
+				if (PTX->send_pktid >= SESSION->num_of_packet)
+					PTX->PRO_STATE = HALT;
+#endif
+			}
 
-		} // switch (PRO_STATE)
+			printf("Debug: --- --- --- --- Packet ID update = %d, table length = %d\n", PTX->RECV_TAB.pktid_update, PTX->RECV_TAB.length);
+			for (i = 0; i < PTX->RECV_TAB.length; ++i)
+				printf("%x ", PTX->RECV_TAB.table[i]);
+			printf("\n");
+			break;
 
+		case END:
+			PTX->PRO_STATE = HALT;
+			break;
 
+		default:
+			break;
 	}
+
+	return true;
+}
+
+
+// ===========================================================
+//
+// Count the time of the session time-out
+//
+// ===========================================================
+void pro_tx_tick(pro_tx_t *PTX)
+{
+	uint64_t now;
+
+	// System time-out, if time-out reaches, halt the session
+	now = reactor_now();
+	if (PTX->wait_ack == true)
+		PTX->SESSION->time_out += (uint32_t)(now - PTX->tick_us);
+	PTX->tick_us = now;
+}
+
+
+// ===========================================================
+//
+// Protocol for send progress
+//
+// ===========================================================
+void pro_tx(sess_t *SESSION)
+{
+	if (pro_sess_tx_open(SESSION) >= 0)
+		pro_sess_tx_run();
 }
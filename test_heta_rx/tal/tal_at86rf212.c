@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "../at86rf212_param.h"
 #include "../hal/hal_at86rf212_trx_access.h"
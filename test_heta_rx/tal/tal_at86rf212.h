@@ -9,6 +9,7 @@ typedef enum at86rfx_retval_tag
 } SHORTENUM at86rfx_retval_t;
 
 
+
 // *******************************************************************************************
 // Function: 
 //		at86rfx_retval_t at86rfx_init(void)
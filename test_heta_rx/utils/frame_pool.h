@@ -0,0 +1,173 @@
+/*
+ * frame_pool.h
+ *
+ * Pool of frame buffers between a producer thread and a consumer thread. The filled
+ * frames go to the consumer through one lock-free queue and come back through another,
+ * so a frame is handed over by its pointer and never copied. The semaphores only put
+ * a thread to sleep when there is nothing to take.
+ */
+
+#ifndef UTILS_FRAME_POOL_H_
+#define UTILS_FRAME_POOL_H_
+
+#include <stdint.h>
+#include <semaphore.h>
+#include "spsc_queue.h"
+
+
+// *******************************************************************************************
+#define FRAME_POOL_MAX			(8)			// frames in a pool
+#define FRAME_POOL_WAIT			(-1)		// frame_pool_get(): wait until a frame is queued
+
+
+// *******************************************************************************************
+// -------- Frame --------
+typedef struct frame_t {
+	uint8_t		*data;				// buffer of the pool, or given by the producer if the pool has no buffer
+	uint32_t	length;				// bytes in the frame
+	uint32_t	index;				// number of the frame
+	uint8_t		codec;				// compression of data, set by the producer (SESS_CODEC_NONE: none)
+	uint32_t	raw_length;			// bytes before compression
+	uint64_t	time;				// monotonic time the producer has filled the frame (us), 0: unknown
+} frame_t;
+
+// -------- Frame pool --------
+typedef struct frame_pool_t {
+	frame_t			frame[FRAME_POOL_MAX];
+	uint8_t			num;			// frames in the pool
+	uint32_t		size;			// bytes of each buffer, 0: no buffer
+	spsc_queue_t	full;			// filled frames, producer -> consumer
+	spsc_queue_t	empty;			// free frames, consumer -> producer
+	sem_t			full_sem;
+	sem_t			empty_sem;
+	uint8_t			done;			// the producer has no more frame
+} frame_pool_t;
+
+
+// =========================================================================================================================================
+// *******************************************************************************************
+// Function:
+//		void frame_pool_init(frame_pool_t *POOL, uint8_t num, uint32_t size)
+//
+// Description:
+//		Allocate the frames, all frames are free
+//
+// Parameters:
+//		POOL		- Frame pool
+//		num			- Number of frames, up to FRAME_POOL_MAX
+//		size		- Bytes of each buffer, 0 if the producer gives the data of each frame
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void frame_pool_init(frame_pool_t *POOL, uint8_t num, uint32_t size);
+
+
+// *******************************************************************************************
+// Function:
+//		void frame_pool_free(frame_pool_t *POOL)
+//
+// Description:
+//		Free the buffers and the queues, both threads must be stopped
+//
+// Parameters:
+//		POOL		- Frame pool
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void frame_pool_free(frame_pool_t *POOL);
+
+
+// *******************************************************************************************
+// Function:
+//		frame_t* frame_pool_take(frame_pool_t *POOL, uint8_t wait)
+//
+// Description:
+//		Take a free frame. Called by the producer only
+//
+// Parameters:
+//		POOL		- Frame pool
+//		wait		- true: wait until the consumer gives a frame back
+//
+// Return:
+//		The frame, NULL if no frame is free and wait is false
+//
+// *******************************************************************************************
+frame_t* frame_pool_take(frame_pool_t *POOL, uint8_t wait);
+
+
+// *******************************************************************************************
+// Function:
+//		void frame_pool_give(frame_pool_t *POOL, frame_t *FRAME)
+//
+// Description:
+//		Queue a filled frame to the consumer. Called by the producer only
+//
+// Parameters:
+//		POOL		- Frame pool
+//		FRAME		- Frame from frame_pool_take()
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void frame_pool_give(frame_pool_t *POOL, frame_t *FRAME);
+
+
+// *******************************************************************************************
+// Function:
+//		void frame_pool_end(frame_pool_t *POOL)
+//
+// Description:
+//		Tell the consumer that no more frame will come. Called by the producer only
+//
+// Parameters:
+//		POOL		- Frame pool
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void frame_pool_end(frame_pool_t *POOL);
+
+
+// *******************************************************************************************
+// Function:
+//		frame_t* frame_pool_get(frame_pool_t *POOL, int32_t time_out)
+//
+// Description:
+//		Get the oldest filled frame. Called by the consumer only
+//
+// Parameters:
+//		POOL		- Frame pool
+//		time_out	- Seconds to wait, 0: no wait, FRAME_POOL_WAIT: no limit
+//
+// Return:
+//		The frame, NULL after time_out or when the producer has ended
+//
+// *******************************************************************************************
+frame_t* frame_pool_get(frame_pool_t *POOL, int32_t time_out);
+
+
+// *******************************************************************************************
+// Function:
+//		void frame_pool_put(frame_pool_t *POOL, frame_t *FRAME)
+//
+// Description:
+//		Give a used frame back to the producer. Called by the consumer only
+//
+// Parameters:
+//		POOL		- Frame pool
+//		FRAME		- Frame from frame_pool_get()
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void frame_pool_put(frame_pool_t *POOL, frame_t *FRAME);
+
+
+#endif /* UTILS_FRAME_POOL_H_ */
@@ -0,0 +1,288 @@
+#include <string.h>
+#include "lz.h"
+
+
+// ========================================================
+//
+// Read 4 bytes, hash of 4 bytes
+//
+// ========================================================
+static inline uint32_t lz_read32(const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint32_t lz_hash(uint32_t v)
+{
+	return (v * 2654435761U) >> (32 - LZ_HASH_LOG);
+}
+
+
+// ========================================================
+//
+// Byte and 4 bytes at a position of dictionary + data
+//
+// ========================================================
+static inline uint8_t lz_byte(const uint8_t *dict, uint32_t dict_length, const uint8_t *src, uint32_t p)
+{
+	return (p < dict_length) ? dict[p] : src[p - dict_length];
+}
+
+static inline uint32_t lz_read32_at(const uint8_t *dict, uint32_t dict_length, const uint8_t *src, uint32_t p)
+{
+	uint8_t b[4];
+	uint8_t i;
+
+	if (p >= dict_length)
+		return lz_read32(&src[p - dict_length]);
+	if ((p + 4) <= dict_length)
+		return lz_read32(&dict[p]);
+
+	// Across the end of the dictionary
+	for (i = 0; i < 4; ++i)
+		b[i] = lz_byte(dict, dict_length, src, p + i);
+	return lz_read32(b);
+}
+
+
+// ========================================================
+//
+// Write a length which does not fit in the token
+//
+// ========================================================
+static inline uint8_t *lz_write_length(uint8_t *op, uint32_t length)
+{
+	while (length >= 255)
+	{
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = (uint8_t)length;
+	return op;
+}
+
+
+// ========================================================
+//
+// Write one sequence: literals, then a match if offset > 0
+//
+// ========================================================
+static uint8_t *lz_write_sequence(uint8_t *op, uint8_t *op_end, const uint8_t *literal,
+								  uint32_t literal_length, uint16_t offset, uint32_t match_length)
+{
+	uint8_t *token;
+
+	// Worst case of this sequence
+	if ((op + 1 + (literal_length / 255) + 1 + literal_length + 2 + (match_length / 255) + 1) > op_end)
+		return NULL;
+
+	token = op++;
+	*token = (literal_length >= 15) ? 0xF0 : (literal_length << 4);
+	if (literal_length >= 15)
+		op = lz_write_length(op, literal_length - 15);
+	memcpy(op, literal, literal_length);
+	op += literal_length;
+
+	// The last sequence has no match
+	if (offset == 0)
+		return op;
+
+	*op++ = (uint8_t)(offset & 0xFF);
+	*op++ = (uint8_t)(offset >> 8);
+
+	match_length -= LZ_MIN_MATCH;
+	*token |= (match_length >= 15) ? 0x0F : match_length;
+	if (match_length >= 15)
+		op = lz_write_length(op, match_length - 15);
+	return op;
+}
+
+
+// ========================================================
+//
+// Compress a block
+//
+// ========================================================
+uint32_t lz_compress(const uint8_t *src, uint32_t src_length, uint8_t *dst, uint32_t dst_max)
+{
+	return lz_compress_dict(NULL, 0, src, src_length, dst, dst_max);
+}
+
+
+// ========================================================
+//
+// Compress a block, the matches can be in the dictionary
+//
+// ========================================================
+uint32_t lz_compress_dict(const uint8_t *dict, uint32_t dict_length, const uint8_t *src, uint32_t src_length,
+						  uint8_t *dst, uint32_t dst_max)
+{
+	uint32_t table[1 << LZ_HASH_LOG];
+	uint32_t ip, ip_end, anchor, ref, h, seq, match_length, step, misses, last_offset;
+	uint8_t *op, *op_end;
+
+	// The positions run over the dictionary, then the data
+	if (dict_length > LZ_MAX_OFFSET)
+	{
+		dict += dict_length - LZ_MAX_OFFSET;
+		dict_length = LZ_MAX_OFFSET;
+	}
+	op = dst;
+	op_end = dst + dst_max;
+	ip = dict_length;
+	anchor = dict_length;
+
+	if (src_length > LZ_MF_LIMIT)
+	{
+		memset(table, 0, sizeof(table));
+		for (h = 0; (h + 4) <= dict_length; ++h)
+			table[lz_hash(lz_read32_at(dict, dict_length, src, h))] = h;
+
+		ip_end = dict_length + src_length - LZ_MF_LIMIT;
+		misses = 0;
+		last_offset = dict_length;
+		while (ip < ip_end)
+		{
+			seq = lz_read32(&src[ip - dict_length]);
+			h = lz_hash(seq);
+			ref = table[h];
+			table[h] = ip;
+
+			// The offset of the last match is tried first, at the start it is the same
+			// position in the dictionary (e.g. an unchanged part of the previous frame).
+			// Data which does not repeat is skipped faster and faster
+			if ((last_offset > 0) && (lz_read32_at(dict, dict_length, src, ip - last_offset) == seq))
+				ref = ip - last_offset;
+			else if ((ref >= ip) || ((ip - ref) > LZ_MAX_OFFSET) || (lz_read32_at(dict, dict_length, src, ref) != seq))
+			{
+				step = 1 + (misses++ >> LZ_SKIP_TRIGGER);
+				ip += step;
+				continue;
+			}
+			misses = 0;
+			last_offset = ip - ref;
+
+			// Longest match, the last bytes stay literals
+			match_length = LZ_MIN_MATCH;
+			while (((ip + match_length) < (dict_length + src_length - LZ_LAST_LITERALS)) &&
+				   (lz_byte(dict, dict_length, src, ref + match_length) == src[ip - dict_length + match_length]))
+				++match_length;
+
+			op = lz_write_sequence(op, op_end, &src[anchor - dict_length], ip - anchor, ip - ref, match_length);
+			if (op == NULL)
+				return 0;
+
+			ip += match_length;
+			anchor = ip;
+		}
+	}
+
+	// Last literals
+	op = lz_write_sequence(op, op_end, &src[anchor - dict_length], dict_length + src_length - anchor, 0, 0);
+	if (op == NULL)
+		return 0;
+	return op - dst;
+}
+
+
+// ========================================================
+//
+// Decompress a block
+//
+// ========================================================
+int32_t lz_decompress(const uint8_t *src, uint32_t src_length, uint8_t *dst, uint32_t dst_max)
+{
+	return lz_decompress_dict(src, src_length, NULL, 0, dst, dst_max);
+}
+
+
+// ========================================================
+//
+// Decompress a block, the matches can be in the dictionary
+//
+// ========================================================
+int32_t lz_decompress_dict(const uint8_t *src, uint32_t src_length, const uint8_t *dict, uint32_t dict_length,
+						   uint8_t *dst, uint32_t dst_max)
+{
+	uint32_t ip, op, length, offset;
+	uint8_t token, b;
+
+	ip = 0;
+	op = 0;
+	while (ip < src_length)
+	{
+		// Literals
+		token = src[ip++];
+		length = token >> 4;
+		if (length == 15)
+		{
+			do {
+				if (ip >= src_length)
+					return -1;
+				b = src[ip++];
+				length += b;
+			} while (b == 255);
+		}
+		if (((ip + length) > src_length) || ((op + length) > dst_max))
+			return -1;
+		memcpy(&dst[op], &src[ip], length);
+		ip += length;
+		op += length;
+
+		// The last sequence has no match
+		if (ip == src_length)
+			break;
+
+		// Match
+		if ((ip + 2) > src_length)
+			return -1;
+		offset = src[ip] + (src[ip + 1] << 8);
+		ip += 2;
+		if ((offset == 0) || (offset > (op + dict_length)))
+			return -1;
+
+		length = token & 0x0F;
+		if (length == 15)
+		{
+			do {
+				if (ip >= src_length)
+					return -1;
+				b = src[ip++];
+				length += b;
+			} while (b == 255);
+		}
+		length += LZ_MIN_MATCH;
+		if ((op + length) > dst_max)
+			return -1;
+
+		// The match may overlap the output, copy byte by byte
+		for (; length > 0; --length, ++op)
+			dst[op] = (op < offset) ? dict[dict_length + op - offset] : dst[op - offset];
+	}
+	return op;
+}
+
+
+// ========================================================
+//
+// Already compressed formats
+//
+// ========================================================
+uint8_t lz_is_compressed(const uint8_t *data, uint32_t length)
+{
+	if (length < 4)
+		return 0;
+
+	if ((data[0] == 0xFF) && (data[1] == 0xD8) && (data[2] == 0xFF))		// JPEG
+		return 1;
+	if ((data[0] == 0x89) && (data[1] == 'P') && (data[2] == 'N') && (data[3] == 'G'))	// PNG
+		return 1;
+	if ((data[0] == 0x1F) && (data[1] == 0x8B))								// GZIP
+		return 1;
+	if ((data[0] == 'P') && (data[1] == 'K') && (data[2] == 0x03) && (data[3] == 0x04))	// ZIP
+		return 1;
+	return 0;
+}
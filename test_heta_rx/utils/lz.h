@@ -0,0 +1,133 @@
+/*
+ * lz.h
+ *
+ * Fast LZ77 compression of a frame in the LZ4 block format: each sequence is a token
+ * (literal length, match length), the literals, and a 2-byte offset of the match.
+ * There is no entropy coding, so a Pi Zero compresses much faster than the radio sends.
+ */
+
+#ifndef UTILS_LZ_H_
+#define UTILS_LZ_H_
+
+#include <stdint.h>
+
+
+// *******************************************************************************************
+#define LZ_HASH_LOG				(14)		// 16,384 entries in the match table, so that a dictionary of a frame stays in it
+#define LZ_MIN_MATCH			(4)
+#define LZ_LAST_LITERALS		(5)			// the last bytes of a block are literals
+#define LZ_MF_LIMIT				(12)		// no match starts in the last bytes of a block
+#define LZ_MAX_OFFSET			(65535)
+#define LZ_SKIP_TRIGGER			(6)			// step of the match search grows after 2^6 misses
+
+
+// =========================================================================================================================================
+// *******************************************************************************************
+// Function:
+//		uint32_t lz_compress(const uint8_t *src, uint32_t src_length, uint8_t *dst, uint32_t dst_max)
+//
+// Description:
+//		Compress a block
+//
+// Parameters:
+//		src			- Data
+//		src_length	- Length of data (in byte)
+//		dst			- Compressed data
+//		dst_max		- Size of dst, the compression stops when it is reached
+//
+// Return:
+//		Length of compressed data, 0 if it is larger than dst_max
+//
+// *******************************************************************************************
+uint32_t lz_compress(const uint8_t *src, uint32_t src_length, uint8_t *dst, uint32_t dst_max);
+
+
+// *******************************************************************************************
+// Function:
+//		int32_t lz_decompress(const uint8_t *src, uint32_t src_length, uint8_t *dst, uint32_t dst_max)
+//
+// Description:
+//		Decompress a block from lz_compress()
+//
+// Parameters:
+//		src			- Compressed data
+//		src_length	- Length of compressed data (in byte)
+//		dst			- Data
+//		dst_max		- Size of dst
+//
+// Return:
+//		Length of data, -1 if the block is invalid or larger than dst_max
+//
+// *******************************************************************************************
+int32_t lz_decompress(const uint8_t *src, uint32_t src_length, uint8_t *dst, uint32_t dst_max);
+
+
+// *******************************************************************************************
+// Function:
+//		uint32_t lz_compress_dict(const uint8_t *dict, uint32_t dict_length, const uint8_t *src, uint32_t src_length,
+//								  uint8_t *dst, uint32_t dst_max)
+//
+// Description:
+//		Compress a block against a dictionary, e.g. the previous frame: the matches can be
+//		in the last LZ_MAX_OFFSET bytes of the dictionary, so that only the differences
+//		are written as literals
+//
+// Parameters:
+//		dict		- Dictionary, NULL if dict_length is 0
+//		dict_length	- Length of the dictionary (in byte)
+//		src			- Data
+//		src_length	- Length of data (in byte)
+//		dst			- Compressed data
+//		dst_max		- Size of dst, the compression stops when it is reached
+//
+// Return:
+//		Length of compressed data, 0 if it is larger than dst_max
+//
+// *******************************************************************************************
+uint32_t lz_compress_dict(const uint8_t *dict, uint32_t dict_length, const uint8_t *src, uint32_t src_length,
+						  uint8_t *dst, uint32_t dst_max);
+
+
+// *******************************************************************************************
+// Function:
+//		int32_t lz_decompress_dict(const uint8_t *src, uint32_t src_length, const uint8_t *dict, uint32_t dict_length,
+//								   uint8_t *dst, uint32_t dst_max)
+//
+// Description:
+//		Decompress a block from lz_compress_dict() with the same dictionary
+//
+// Parameters:
+//		src			- Compressed data
+//		src_length	- Length of compressed data (in byte)
+//		dict		- Dictionary, NULL if dict_length is 0
+//		dict_length	- Length of the dictionary (in byte)
+//		dst			- Data
+//		dst_max		- Size of dst
+//
+// Return:
+//		Length of data, -1 if the block is invalid or larger than dst_max
+//
+// *******************************************************************************************
+int32_t lz_decompress_dict(const uint8_t *src, uint32_t src_length, const uint8_t *dict, uint32_t dict_length,
+						   uint8_t *dst, uint32_t dst_max);
+
+
+// *******************************************************************************************
+// Function:
+//		uint8_t lz_is_compressed(const uint8_t *data, uint32_t length)
+//
+// Description:
+//		Check the signature of the formats which are already compressed (JPEG, PNG, GZIP, ZIP)
+//
+// Parameters:
+//		data		- Start of the file
+//		length		- Length of the file (in byte)
+//
+// Return:
+//		1 if the file is already compressed, 0 otherwise
+//
+// *******************************************************************************************
+uint8_t lz_is_compressed(const uint8_t *data, uint32_t length);
+
+
+#endif /* UTILS_LZ_H_ */
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include "pace.h"
+
+
+static uint64_t pace_slack = PACE_SLACK_INIT * 1000;	// ns spun at the end of a wait
+static uint32_t pace_loops = PACE_LOOPS_INIT;			// iterations of pace_loop() per us
+
+
+// ========================================================
+//
+// Nanosecond loop
+//
+// ========================================================
+static void pace_loop(uint32_t n)
+{
+	volatile uint32_t i = n;
+
+	while (i > 0)
+		i = i - 1;
+}
+
+
+// ========================================================
+//
+// Sleep until an absolute time
+//
+// ========================================================
+static void pace_sleep(uint64_t when)
+{
+	struct timespec ts;
+
+	ts.tv_sec = when / 1000000000;
+	ts.tv_nsec = when % 1000000000;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+}
+
+
+// ========================================================
+//
+// Calibration
+//
+// ========================================================
+void pace_init(void)
+{
+	uint8_t i, j;
+	uint64_t start, deadline, over[PACE_CALIB_NUM], tmp, slack;
+
+	// ------ Speed of the nanosecond loop ------
+	start = pace_now();
+	pace_loop(PACE_CALIB_LOOPS);
+	tmp = pace_now() - start;
+	pace_loops = (tmp > 0) ? (uint32_t)(((uint64_t)PACE_CALIB_LOOPS * 1000) / tmp) : PACE_LOOPS_INIT;
+	if (pace_loops == 0)
+		pace_loops = 1;
+
+	// ------ Oversleep of clock_nanosleep(), sorted ------
+	for (i = 0; i < PACE_CALIB_NUM; ++i)
+	{
+		deadline = pace_now() + (PACE_CALIB_US * 1000);
+		pace_sleep(deadline);
+		tmp = pace_now() - deadline;
+		for (j = i; (j > 0) && (over[j - 1] > tmp); --j)
+			over[j] = over[j - 1];
+		over[j] = tmp;
+	}
+
+	slack = (over[(PACE_CALIB_NUM * 9) / 10] / 1000) + 1;
+	if (slack < PACE_SLACK_MIN)
+		slack = PACE_SLACK_MIN;
+	if (slack > PACE_SLACK_MAX)
+		slack = PACE_SLACK_MAX;
+	pace_slack = slack * 1000;
+
+	printf("Debug: --- Pacing: slack = %d us, %d loops/us\n", (int)slack, pace_loops);
+}
+
+
+// ========================================================
+//
+// Monotonic time (ns)
+//
+// ========================================================
+uint64_t pace_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+
+// ========================================================
+//
+// Waits
+//
+// ========================================================
+void pace_until(uint64_t deadline)
+{
+	uint64_t now;
+
+	now = pace_now();
+	if (now >= deadline)
+		return;
+
+	// Sleep for the coarse part, the wake-up may be late by the slack
+	if (deadline - now > pace_slack)
+		pace_sleep(deadline - pace_slack);
+
+	// Spin for the rest
+	while (pace_now() < deadline)
+		;
+}
+
+void pace_delay_us(uint32_t us)
+{
+	if (us == 0)
+		return;
+	pace_until(pace_now() + ((uint64_t)us * 1000));
+}
+
+void pace_delay_ns(uint32_t ns)
+{
+	pace_loop((uint32_t)((((uint64_t)ns * pace_loops) + 999) / 1000));
+}
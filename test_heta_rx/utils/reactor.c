@@ -0,0 +1,264 @@
+#define _GNU_SOURCE		// ppoll()
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include "reactor.h"
+
+
+static reactor_timer_t *reactor_heap[REACTOR_TIMER_MAX];	// reactor_heap[0] expires first
+static uint16_t reactor_heap_num;
+
+static reactor_source_cb reactor_source[REACTOR_SOURCE_MAX];
+static void *reactor_source_arg[REACTOR_SOURCE_MAX];
+
+static int reactor_pipe[2] = {-1, -1};	// reactor_wake() writes, reactor_run_once() waits on it
+
+
+// ========================================================
+//
+// Create the wake-up pipe
+//
+// ========================================================
+void reactor_init(void)
+{
+	if (reactor_pipe[0] >= 0)
+		return;
+
+	if (pipe(reactor_pipe) < 0)
+	{
+		printf("Info: --- Cannot create the pipe of the event loop ... \n");
+		exit (1);
+	}
+	fcntl(reactor_pipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(reactor_pipe[1], F_SETFL, O_NONBLOCK);
+}
+
+
+// ========================================================
+//
+// Monotonic time (us)
+//
+// ========================================================
+uint64_t reactor_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+
+// ========================================================
+//
+// Heap of timers
+//
+// ========================================================
+static void reactor_heap_set(uint16_t i, reactor_timer_t *TIMER)
+{
+	reactor_heap[i] = TIMER;
+	TIMER->heap = i;
+}
+
+static void reactor_heap_up(uint16_t i)
+{
+	reactor_timer_t *TIMER;
+	uint16_t parent;
+
+	TIMER = reactor_heap[i];
+	while (i > 0)
+	{
+		parent = (i - 1) >> 1;
+		if (reactor_heap[parent]->when <= TIMER->when)
+			break;
+		reactor_heap_set(i, reactor_heap[parent]);
+		i = parent;
+	}
+	reactor_heap_set(i, TIMER);
+}
+
+static void reactor_heap_down(uint16_t i)
+{
+	reactor_timer_t *TIMER;
+	uint16_t child;
+
+	TIMER = reactor_heap[i];
+	while (1)
+	{
+		child = (i << 1) + 1;
+		if (child >= reactor_heap_num)
+			break;
+		if ((child + 1 < reactor_heap_num) && (reactor_heap[child + 1]->when < reactor_heap[child]->when))
+			++child;
+		if (TIMER->when <= reactor_heap[child]->when)
+			break;
+		reactor_heap_set(i, reactor_heap[child]);
+		i = child;
+	}
+	reactor_heap_set(i, TIMER);
+}
+
+
+// ========================================================
+//
+// Timers
+//
+// ========================================================
+void reactor_timer_init(reactor_timer_t *TIMER, reactor_timer_cb cb, void *arg)
+{
+	TIMER->when = 0;
+	TIMER->cb = cb;
+	TIMER->arg = arg;
+	TIMER->heap = -1;
+}
+
+void reactor_timer_start(reactor_timer_t *TIMER, uint64_t when)
+{
+	uint64_t before;
+
+	// Already armed: move it
+	if (TIMER->heap >= 0)
+	{
+		before = TIMER->when;
+		TIMER->when = when;
+		if (when < before)
+			reactor_heap_up(TIMER->heap);
+		else
+			reactor_heap_down(TIMER->heap);
+		return;
+	}
+
+	if (reactor_heap_num >= REACTOR_TIMER_MAX)
+	{
+		printf("Info: --- Too many timers in the event loop ... \n");
+		exit (1);
+	}
+	TIMER->when = when;
+	reactor_heap_set(reactor_heap_num, TIMER);
+	++reactor_heap_num;
+	reactor_heap_up(TIMER->heap);
+}
+
+void reactor_timer_stop(reactor_timer_t *TIMER)
+{
+	uint16_t i;
+	reactor_timer_t *LAST;
+
+	if (TIMER->heap < 0)
+		return;
+
+	// The last timer takes its place
+	i = TIMER->heap;
+	TIMER->heap = -1;
+	--reactor_heap_num;
+	if (i == reactor_heap_num)
+		return;
+	LAST = reactor_heap[reactor_heap_num];
+	reactor_heap_set(i, LAST);
+	reactor_heap_up(i);
+	reactor_heap_down(LAST->heap);
+}
+
+
+// ========================================================
+//
+// Event sources
+//
+// ========================================================
+int8_t reactor_source_add(reactor_source_cb cb, void *arg)
+{
+	int8_t i;
+
+	for (i = 0; i < REACTOR_SOURCE_MAX; ++i)
+	{
+		if (reactor_source[i] == NULL)
+		{
+			reactor_source[i] = cb;
+			reactor_source_arg[i] = arg;
+			return i;
+		}
+	}
+	return -1;
+}
+
+void reactor_source_remove(int8_t entry)
+{
+	if ((entry < 0) || (entry >= REACTOR_SOURCE_MAX))
+		return;
+	reactor_source[entry] = NULL;
+	reactor_source_arg[entry] = NULL;
+}
+
+
+// ========================================================
+//
+// Wake up the loop
+//
+// ========================================================
+void reactor_wake(void)
+{
+	uint8_t c = 0;
+
+	// The pipe is full: the loop is already woken up
+	if (write(reactor_pipe[1], &c, 1) < 0)
+		return;
+}
+
+
+// ========================================================
+//
+// One iteration of the loop
+//
+// ========================================================
+void reactor_run_once(void)
+{
+	uint8_t i, busy;
+	uint8_t drain[64];
+	uint16_t n;
+	uint64_t now, wait;
+	reactor_timer_t *TIMER;
+	struct pollfd fds;
+	struct timespec ts;
+
+	// ------ Sources, one event each so that the timers are not delayed ------
+	busy = 0;
+	for (i = 0; i < REACTOR_SOURCE_MAX; ++i)
+		if ((reactor_source[i] != NULL) && (reactor_source[i](reactor_source_arg[i]) != 0))
+			busy = 1;
+
+	// ------ Expired timers, a timer armed again by its callback waits for the next iteration ------
+	now = reactor_now();
+	n = reactor_heap_num;
+	while ((n > 0) && (reactor_heap_num > 0) && (reactor_heap[0]->when <= now))
+	{
+		TIMER = reactor_heap[0];
+		reactor_timer_stop(TIMER);
+		TIMER->cb(TIMER->arg);
+		busy = 1;
+		--n;
+	}
+	if (busy != 0)
+		return;
+
+	// ------ Wait for a wake-up or the next timer ------
+	wait = REACTOR_WAIT_MAX;
+	if (reactor_heap_num > 0)
+	{
+		now = reactor_now();
+		if (reactor_heap[0]->when <= now)
+			return;
+		if (reactor_heap[0]->when - now < wait)
+			wait = reactor_heap[0]->when - now;
+	}
+	ts.tv_sec = wait / 1000000;
+	ts.tv_nsec = (wait % 1000000) * 1000;
+
+	fds.fd = reactor_pipe[0];
+	fds.events = POLLIN;
+	fds.revents = 0;
+	if ((ppoll(&fds, 1, &ts, NULL) > 0) && ((fds.revents & POLLIN) != 0))
+		while (read(reactor_pipe[0], &drain[0], sizeof(drain)) > 0)
+			;
+}
@@ -0,0 +1,197 @@
+/*
+ * reactor.h
+ *
+ * Single-threaded event loop: a min-heap of timers on the monotonic clock and the
+ * event sources (e.g. the links) which are polled when the loop is woken up.
+ * An interrupt handler or another thread only calls reactor_wake(), all the
+ * callbacks run in the thread of reactor_run_once().
+ */
+
+#ifndef UTILS_REACTOR_H_
+#define UTILS_REACTOR_H_
+
+#include <stdint.h>
+
+
+// *******************************************************************************************
+#define REACTOR_TIMER_MAX		(32)		// armed timers
+#define REACTOR_SOURCE_MAX		(4)			// event sources
+#define REACTOR_WAIT_MAX		(1000000)	// us, longest wait without timer or wake-up
+
+// Called when a timer expires
+typedef void (*reactor_timer_cb)(void *arg);
+
+// Called at each wake-up, return 1 if an event is handled (the source is called again)
+typedef uint8_t (*reactor_source_cb)(void *arg);
+
+// -------- Timer --------
+typedef struct reactor_timer_t {
+	uint64_t			when;		// monotonic time of expiry (us)
+	reactor_timer_cb	cb;
+	void				*arg;
+	int16_t				heap;		// position in the heap, -1: not armed
+} reactor_timer_t;
+
+
+// =========================================================================================================================================
+// *******************************************************************************************
+// Function:
+//		void reactor_init(void)
+//
+// Description:
+//		Create the wake-up pipe, the timers and the sources are kept if it is already created
+//
+// Parameters:
+//		None
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void reactor_init(void);
+
+
+// *******************************************************************************************
+// Function:
+//		uint64_t reactor_now(void)
+//
+// Description:
+//		Monotonic time
+//
+// Parameters:
+//		None
+//
+// Return:
+//		Time (us)
+//
+// *******************************************************************************************
+uint64_t reactor_now(void);
+
+
+// *******************************************************************************************
+// Function:
+//		void reactor_timer_init(reactor_timer_t *TIMER, reactor_timer_cb cb, void *arg)
+//
+// Description:
+//		Initialize a timer which is not armed
+//
+// Parameters:
+//		TIMER		- Timer
+//		cb			- Called when the timer expires
+//		arg			- Argument of cb
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void reactor_timer_init(reactor_timer_t *TIMER, reactor_timer_cb cb, void *arg);
+
+
+// *******************************************************************************************
+// Function:
+//		void reactor_timer_start(reactor_timer_t *TIMER, uint64_t when)
+//
+// Description:
+//		Arm a timer, or move it if it is already armed. The timers of the same time
+//		expire in any order
+//
+// Parameters:
+//		TIMER		- Timer
+//		when		- Monotonic time of expiry (us), a past time expires at the next reactor_run_once()
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void reactor_timer_start(reactor_timer_t *TIMER, uint64_t when);
+
+
+// *******************************************************************************************
+// Function:
+//		void reactor_timer_stop(reactor_timer_t *TIMER)
+//
+// Description:
+//		Disarm a timer, nothing is done if it is not armed
+//
+// Parameters:
+//		TIMER		- Timer
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void reactor_timer_stop(reactor_timer_t *TIMER);
+
+
+// *******************************************************************************************
+// Function:
+//		int8_t reactor_source_add(reactor_source_cb cb, void *arg)
+//
+// Description:
+//		Add an event source, it is polled at each wake-up until it has no event
+//
+// Parameters:
+//		cb			- Handler of the source
+//		arg			- Argument of cb
+//
+// Return:
+//		Entry of the source, -1 if the table is full
+//
+// *******************************************************************************************
+int8_t reactor_source_add(reactor_source_cb cb, void *arg);
+
+
+// *******************************************************************************************
+// Function:
+//		void reactor_source_remove(int8_t entry)
+//
+// Description:
+//		Remove an event source
+//
+// Parameters:
+//		entry		- Entry from reactor_source_add(), nothing is done if it is -1
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void reactor_source_remove(int8_t entry);
+
+
+// *******************************************************************************************
+// Function:
+//		void reactor_wake(void)
+//
+// Description:
+//		Wake up the loop so that the sources are polled, e.g. from an interrupt handler.
+//		It can be called from any thread
+//
+// Parameters:
+//		None
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void reactor_wake(void);
+
+
+// *******************************************************************************************
+// Function:
+//		void reactor_run_once(void)
+//
+// Description:
+//		Poll the sources, run the expired timers, and if no source had an event, wait
+//		for reactor_wake() or the next timer (at most REACTOR_WAIT_MAX)
+//
+// Parameters:
+//		None
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void reactor_run_once(void);
+
+
+#endif /* UTILS_REACTOR_H_ */
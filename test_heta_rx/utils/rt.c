@@ -0,0 +1,119 @@
+#define _GNU_SOURCE		// CPU_SET(), pthread_setaffinity_np()
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "rt.h"
+
+
+// ========================================================
+//
+// CPU of the radio thread, -1 on a single-core Pi
+//
+// ========================================================
+static int rt_cpu(void)
+{
+	long num;
+
+	num = sysconf(_SC_NPROCESSORS_ONLN);
+	if (num <= 1)
+		return -1;
+	if ((RT_CPU >= 0) && (RT_CPU < num))
+		return RT_CPU;
+	return (int)(num - 1);
+}
+
+
+// ========================================================
+//
+// Map the stack of the calling thread
+//
+// ========================================================
+static void rt_stack_prefault(void)
+{
+	volatile uint8_t stack[RT_STACK_PREFAULT];
+
+	memset((uint8_t*)stack, 0, RT_STACK_PREFAULT);
+}
+
+
+// ========================================================
+//
+// Lock the memory
+//
+// ========================================================
+void rt_init(void)
+{
+	// The freed memory stays in the process, a later malloc() does not fault
+	mallopt(M_TRIM_THRESHOLD, -1);
+	mallopt(M_MMAP_MAX, 0);
+
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+		printf("Info: --- Cannot lock the memory (%s)\n", strerror(errno));
+	rt_stack_prefault();
+}
+
+
+// ========================================================
+//
+// Radio thread
+//
+// ========================================================
+void rt_thread_radio(void)
+{
+	int cpu, err;
+	cpu_set_t set;
+	struct sched_param param;
+
+	cpu = rt_cpu();
+	if (cpu >= 0)
+	{
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+		if (err != 0)
+			printf("Info: --- Cannot pin the radio thread to CPU %d (%s)\n", cpu, strerror(err));
+	}
+
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = RT_PRIORITY;
+	err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	if (err != 0)
+		printf("Info: --- Cannot set SCHED_FIFO (%s), the radio thread keeps the normal scheduling\n", strerror(err));
+	else
+		printf("Debug: --- Radio thread: SCHED_FIFO %d, CPU %d\n", RT_PRIORITY, cpu);
+
+	rt_stack_prefault();
+}
+
+
+// ========================================================
+//
+// Other threads
+//
+// ========================================================
+void rt_thread_other(void)
+{
+	int cpu, i;
+	long num;
+	cpu_set_t set;
+	struct sched_param param;
+
+	memset(&param, 0, sizeof(param));
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+
+	cpu = rt_cpu();
+	if (cpu < 0)
+		return;
+
+	num = sysconf(_SC_NPROCESSORS_ONLN);
+	CPU_ZERO(&set);
+	for (i = 0; i < num; ++i)
+		if (i != cpu)
+			CPU_SET(i, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+}
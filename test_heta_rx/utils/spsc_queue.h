@@ -0,0 +1,115 @@
+/*
+ * spsc_queue.h
+ *
+ * Bounded lock-free queue of pointers between one producer thread and one consumer
+ * thread. The producer only writes tail, the consumer only writes head, so no lock
+ * is needed: each side publishes its index with a release store.
+ */
+
+#ifndef UTILS_SPSC_QUEUE_H_
+#define UTILS_SPSC_QUEUE_H_
+
+#include <stdint.h>
+
+
+// *******************************************************************************************
+#define SPSC_CACHE_LINE			(64)		// head and tail are kept on different cache lines
+
+// -------- Queue --------
+typedef struct spsc_queue_t {
+	void		**slot;
+	uint32_t	mask;				// number of slots - 1, the number of slots is a power of 2
+	uint32_t	head __attribute__((aligned(SPSC_CACHE_LINE)));		// next slot to read, consumer only
+	uint32_t	tail __attribute__((aligned(SPSC_CACHE_LINE)));		// next slot to write, producer only
+} spsc_queue_t;
+
+
+// =========================================================================================================================================
+// *******************************************************************************************
+// Function:
+//		void spsc_init(spsc_queue_t *Q, uint32_t size)
+//
+// Description:
+//		Allocate the slots of the queue, size is rounded up to a power of 2
+//
+// Parameters:
+//		Q			- Queue
+//		size		- Minimum number of items in the queue
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void spsc_init(spsc_queue_t *Q, uint32_t size);
+
+
+// *******************************************************************************************
+// Function:
+//		void spsc_free(spsc_queue_t *Q)
+//
+// Description:
+//		Free the slots of the queue, the items are not freed
+//
+// Parameters:
+//		Q			- Queue
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void spsc_free(spsc_queue_t *Q);
+
+
+// *******************************************************************************************
+// Function:
+//		uint8_t spsc_push(spsc_queue_t *Q, void *item)
+//
+// Description:
+//		Add an item at the tail of the queue. Called by the producer only
+//
+// Parameters:
+//		Q			- Queue
+//		item		- Item, not NULL
+//
+// Return:
+//		true if the item is added, false if the queue is full
+//
+// *******************************************************************************************
+uint8_t spsc_push(spsc_queue_t *Q, void *item);
+
+
+// *******************************************************************************************
+// Function:
+//		void* spsc_pop(spsc_queue_t *Q)
+//
+// Description:
+//		Remove the item at the head of the queue. Called by the consumer only
+//
+// Parameters:
+//		Q			- Queue
+//
+// Return:
+//		The item, NULL if the queue is empty
+//
+// *******************************************************************************************
+void* spsc_pop(spsc_queue_t *Q);
+
+
+// *******************************************************************************************
+// Function:
+//		uint32_t spsc_count(spsc_queue_t *Q)
+//
+// Description:
+//		Number of items in the queue, only a hint when the other side is running
+//
+// Parameters:
+//		Q			- Queue
+//
+// Return:
+//		Number of items
+//
+// *******************************************************************************************
+uint32_t spsc_count(spsc_queue_t *Q);
+
+
+#endif /* UTILS_SPSC_QUEUE_H_ */
@@ -2,7 +2,7 @@
 
 // *******************************************************************************************
 // Function: 
-//		long writeBinaryFileToArray (char frame_name[], unsigned char *frame_data);
+//		long writeBinaryFileToArray (char frame_name[], unsigned char *frame_data, long frame_data_max);
 // 
 // Description:
 //		This routine open a binary file in read mode, and copy the file content to an array.
@@ -10,11 +10,49 @@
 // Parameters:
 // 		frame_name	- The binay file name
 //		frame_data	- The array name
+//		frame_data_max - The size of array (in byte)
 //
 // Return:
 //		The size of binary file or the length of array (in byte).
+//		0 if the file cannot be read or is larger than the array.
 // *******************************************************************************************
-long writeBinaryFileToArray (char frame_name[], unsigned char *frame_data);
+long writeBinaryFileToArray (char frame_name[], unsigned char *frame_data, long frame_data_max);
+
+
+// *******************************************************************************************
+// Function: 
+//		unsigned char* mapBinaryFile (char frame_name[], long *frame_data_size, int populate);
+// 
+// Description:
+//		This routine map a binary file in read-only mode, the pages are read ahead
+//		sequentially. The file content is used in place, without copy.
+// 
+// Parameters:
+// 		frame_name	- The binay file name
+//		frame_data_size - The size of binary file (in byte), 0 if the file cannot be mapped
+//		populate	- 1: read the whole file now, 0: read the pages when they are used
+//
+// Return:
+//		The first address of file content, NULL if the file cannot be mapped or is empty.
+// *******************************************************************************************
+unsigned char* mapBinaryFile (char frame_name[], long *frame_data_size, int populate);
+
+
+// *******************************************************************************************
+// Function: 
+//		void unmapBinaryFile (unsigned char *frame_data, long frame_data_size);
+// 
+// Description:
+//		This routine unmap a binary file mapped by mapBinaryFile().
+// 
+// Parameters:
+//		frame_data	- The first address of file content
+//		frame_data_size - The size of binary file (in byte)
+//
+// Return:
+//		None
+// *******************************************************************************************
+void unmapBinaryFile (unsigned char *frame_data, long frame_data_size);
 
 
 // *******************************************************************************************
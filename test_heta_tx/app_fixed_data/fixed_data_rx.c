@@ -3,7 +3,9 @@
 #include "../tal/tal_at86rf212.h"
 #include "../tal/tal_at86rf212_trx.h"
 #include "../protocol/protocol.h"
+#include "../protocol/protocol_link.h"
 #include "../utils/utils.h"
+#include "../utils/lz.h"
 #include "../mydebug/mydebug.h"
 #include "fixed_data.h"
 
@@ -17,6 +19,7 @@ void app_fixed_data_rx_data(node_t NODE)
 {
 	sess_t SESSION;
 	appbuff_t BUFFER;
+	uint8_t *frame_lz;
 
 	register uint32_t i;
 	char i_str[10];
@@ -24,6 +27,7 @@ void app_fixed_data_rx_data(node_t NODE)
 
 
 	at86rfx_frame_rx = false;
+	link_init(NODE.src_addr);
 
 	// ------ Initialize BUFFER information  ------
 	BUFFER.data = (uint8_t*) calloc (APPBUFF_SIZE, sizeof(uint8_t));
@@ -35,6 +39,14 @@ void app_fixed_data_rx_data(node_t NODE)
 	printf("Info: --- Read image data from file ... \n");
 	BUFFER.length = 0;
 
+	// Compressed SESSION frames are moved here, then decompressed to BUFFER
+	frame_lz = (uint8_t*) calloc (FRAME_SIZE, sizeof(uint8_t));
+	if (frame_lz == NULL)
+	{
+		printf("Info: --- Not enough memory to store data file ... \n");
+		exit (1);
+	}
+
 #if DEBUG_INFO == 1		// ----------------------------------------
 	debug_init();
 #endif
@@ -51,6 +63,9 @@ void app_fixed_data_rx_data(node_t NODE)
 		SESSION.frame_length = 0;
 		SESSION.packet_length = 0;
 		SESSION.num_of_packet = 0;
+		SESSION.codec = SESS_CODEC_NONE;	// given by CONFIG
+		SESSION.raw_length = 0;
+		SESSION.ref_id = SESS_REF_NONE;		// no delta frame
 		SESSION.frame_data = &BUFFER.data[i];
 
 		SESSION.src_addr = NODE.src_addr;
@@ -60,8 +75,9 @@ void app_fixed_data_rx_data(node_t NODE)
 		SESSION.window_size = PACKETS_PER_TRANS;
 		SESSION.tx_delay = 0;
 		SESSION.time_out = 0;
-		SESSION.guarantee_end = false;	// it is set to 1 in PING command,
+		SESSION.guarantee_end = false;	// it is set to 1 in PING or SETUP command,
 									// i.e., END is sent to TX perfectly
+		SESSION.link_mode = LINK_MODE_DEFAULT;
 
 
 		// ------ Run SESSION ------
@@ -70,7 +86,15 @@ void app_fixed_data_rx_data(node_t NODE)
 
 		if ((SESSION.guarantee_end == true) && (SESSION.time_out < SESS_TIME_OUT))
 		{
-			BUFFER.length += SESSION.frame_length;
+			if (SESSION.codec == SESS_CODEC_LZ)
+			{
+				memcpy(frame_lz, &BUFFER.data[i], SESSION.frame_length);
+				if (lz_decompress(frame_lz, SESSION.frame_length, &BUFFER.data[i], APPBUFF_SIZE - i) != SESSION.raw_length)
+					printf("Info: --- Cannot decompress the frame at position %d\n", i);
+				printf("Debug: --- Decompress %d bytes to %d bytes\n", SESSION.frame_length, SESSION.raw_length);
+			}
+
+			BUFFER.length += SESSION.raw_length;
 			i += FRAME_SIZE;
 
 #if DEBUG_INFO == 1		// ----------------------------------------
@@ -105,6 +129,7 @@ void app_fixed_data_rx_data(node_t NODE)
 		file_name [1] = ISACK_PREFIX | END;
 		GET16TO8(file_name[2], file_name[3], SESSION.src_addr);
 		GET16TO8(file_name[4], file_name[5], SESSION.dest_addr);
+		file_name[CSIDP + 1] = SESSION.sess_id;
 
 		for (i = 0; i < 10; ++i)
 		{
@@ -134,5 +159,6 @@ void app_fixed_data_rx_data(node_t NODE)
 		debug_print();
 #endif
 
+	free(frame_lz);
 	free(BUFFER.data);
 }
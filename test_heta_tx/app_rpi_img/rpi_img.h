@@ -4,15 +4,71 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include <unistd.h>
+#include "../utils/frame_pool.h"
 
 
 #define TRX_ENABLE 		(0)	// 0: This module is TX
 							// 1: This module is RX
+							// 2: This module is a relay between TX and RX
+#define RELAY_USED		(0)	// 1: TX -> NODE_02_ADDR (relay) -> RX, 0: TX -> RX
 #define FRAME_SIZE		(57344)	// The size of each SESSION frame
 
+// *******************************************************************************************
+// Camera capture, the frames go to TX through a queue so that the next frame is
+// captured while the previous one is sent
+#define CAPTURE_SOURCE	(1)	// 1: JPEG stream piped from the camera tool
+							// 0: img<N>.jpg files written to IMG_DIR by the camera tool
+#define CAPTURE_CMD		"raspistill -w 320 -h 240 -q 10 -rs 20 -th none -t 30000 -tl 2000 -o -"
+#define CAPTURE_FILE_CMD	"raspistill -w 320 -h 240 -q 10 -rs 20 -t 30000 -tl 2000 -o /home/pi/my_code/tmp/data/img%d.jpg"
+#define IMG_DIR			"/home/pi/my_code/tmp/data"
+#define IMG_PREFIX		"img"		// IMG_DIR/img<N>.jpg
+#define CAPTURE_FRAMES	(4)		// frame buffers shared by capture and TX
+#define CAPTURE_TIME_OUT	(10)	// s without a new frame before TX is stopped
+#define CAPTURE_STALE	(4000000)	// us after the capture, a frame which TX has not started is dropped
+								// (a newer frame is in the queue, SESS_CLASS_VIDEO)
+
+// Storage of the received frames, the next frame is received while the writer
+// stores the previous ones to IMG_DIR
+#define STORE_FRAMES	(4)		// frame buffers shared by RX and the writer
+#define STORE_BATCH		(4)		// frames written before their files are closed
+#define STORE_FSYNC		(0)		// 1: sync the files of each batch to the SD card
+#define RX_SESSIONS		(2)		// sessions received at once, each to its own frame: overlapping sessions
+								// of TX, or of several nodes when SAR_USED_ROUTE is 1 (at most SESS_TABLE_MAX,
+								// less than STORE_FRAMES)
+
+// JPEG framer, the camera puts a restart marker (RSTn) after each row of MCUs (-rs 20).
+// TX moves the markers to the start of a packet, so that a lost packet only damages its
+// restart intervals. After JPEG_DEADLINE, only the headers and the coarse scans of a
+// progressive JPEG are re-sent, RX stores the frame with the other lost packets zeroed
+#define JPEG_FRAMER		(1)		// 1: frame the JPEG with restart markers or progressive scans
+								// 0: send the frames as they are, until every packet is received
+#define JPEG_GROUP		(4)		// packets between two restart markers moved to the start of a packet
+#define JPEG_MUST_SE	(5)		// progressive scans up to this coefficient are re-sent after the deadline
+#define JPEG_DEADLINE	(2000000)	// us from START, the capture period (-tl)
+#define JPEG_MUST_SIZE	(0x10000 >> 3)	// one bit for each packet ID
+
+// Delta frames, TX and RX keep the last frame which RX has received in full. The next frame
+// is sent as its difference to that frame (lz_compress_dict()) when it is smaller, so that
+// an unchanged scene costs little air time. RX refuses a delta frame if it has another
+// reference frame, then TX sends the frame in full
+#define DELTA_USED		(1)		// 1: send delta frames, 0: send each frame in full
+
+// Telemetry of TX, a SESS_CLASS_CONTROL session which the session table sends between two
+// windows of the current frame. RX prints it instead of storing it
+#define TELEMETRY_PERIOD	(1000000)	// us between two telemetry messages, 0: no telemetry
+#define TELEMETRY_TAG		"TLM "		// first bytes of a telemetry message
+#define TELEMETRY_SIZE		(80)		// bytes of a telemetry message at most
+
+// Real-time radio thread (utils/rt.h), the thread which runs the protocol gets SCHED_FIFO
+// and its own CPU, the memory is locked after the buffers are allocated. Capture and
+// storage stay on the other CPUs and exchange frames with it through the frame pools
+#define RT_USED			(1)		// 1: run the protocol in a real-time thread, it needs root or CAP_SYS_NICE
+
 // *******************************************************************************************
 #define NODE_00_ADDR	(0x1234)
 #define NODE_01_ADDR	(0x5678)
+#define NODE_02_ADDR	(0x9ABC)	// relay
+#define SINK_ADDR		NODE_01_ADDR	// destination of the routes when SAR_USED_ROUTE is 1
 
 // -------- Node --------
 typedef struct node_t {
@@ -20,6 +76,17 @@ typedef struct node_t {
 	uint16_t	dest_addr;		// destination address
 } node_t;
 
+// -------- Capture stage --------
+typedef struct capture_t {
+	frame_pool_t	POOL;		// capture -> TX, FRAME_SIZE buffers, or the mapped files if CAPTURE_SOURCE is 0
+	uint32_t		dropped;	// frames lost because TX keeps all buffers
+	pthread_t		tid;
+	// JPEG parser
+	uint8_t			state;
+	uint8_t			marker;
+	uint16_t		seg_left;	// bytes left in the current segment
+} capture_t;
+
 
 // *******************************************************************************************
 // Function:
@@ -43,7 +110,8 @@ void app_rpi_img_init();
 //		void app_rpi_img_send_data(node_t NODE)
 //
 // Description:
-//		Read image from file and send to RX
+//		Capture images from the camera and send to RX. The frames and the telemetry are
+//		given to one event loop (pro_sess_serve()) by their own threads
 //
 // Parameters:
 //		NODE		- Node information
@@ -55,6 +123,118 @@ void app_rpi_img_init();
 void app_rpi_img_send_data(node_t NODE);
 
 
+// *******************************************************************************************
+// Function:
+//		void app_rpi_img_capture_start(capture_t *CAPTURE)
+//
+// Description:
+//		Allocate the frame buffers and start the capture thread
+//
+// Parameters:
+//		CAPTURE		- Capture stage
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void app_rpi_img_capture_start(capture_t *CAPTURE);
+
+
+// *******************************************************************************************
+// Function:
+//		frame_t* app_rpi_img_capture_get(capture_t *CAPTURE)
+//
+// Description:
+//		Wait for the next captured frame, the frame belongs to TX until it is
+//		given back by app_rpi_img_capture_put()
+//
+// Parameters:
+//		CAPTURE		- Capture stage
+//
+// Return:
+//		The oldest captured frame, NULL if the camera is stopped or after CAPTURE_TIME_OUT
+//
+// *******************************************************************************************
+frame_t* app_rpi_img_capture_get(capture_t *CAPTURE);
+
+
+// *******************************************************************************************
+// Function:
+//		void app_rpi_img_capture_put(capture_t *CAPTURE, frame_t *FRAME)
+//
+// Description:
+//		Give a sent frame back to the capture thread
+//
+// Parameters:
+//		CAPTURE		- Capture stage
+//		FRAME		- Frame from app_rpi_img_capture_get()
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void app_rpi_img_capture_put(capture_t *CAPTURE, frame_t *FRAME);
+
+
+// *******************************************************************************************
+// Function:
+//		void app_rpi_img_capture_stop(capture_t *CAPTURE)
+//
+// Description:
+//		Stop the capture thread and free the frame buffers
+//
+// Parameters:
+//		CAPTURE		- Capture stage
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void app_rpi_img_capture_stop(capture_t *CAPTURE);
+
+
+// *******************************************************************************************
+// Function:
+//		void* app_rpi_img_capture_data(void *arg)
+//
+// Description:
+//		Capture thread: start the camera tool, read its frames (CAPTURE_SOURCE) to
+//		the free buffers and queue them to TX
+//
+// Parameters:
+//		CAPTURE		- Capture stage
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void* app_rpi_img_capture_data(void *arg);
+
+
+// *******************************************************************************************
+// Function:
+//		uint32_t app_rpi_img_jpeg_frame(uint8_t *src, uint32_t length, uint8_t *dst, uint16_t packet_length, uint8_t *must)
+//
+// Description:
+//		Copy a JPEG with its restart markers moved to the start of a packet (0xFF fill bytes
+//		before the marker), and set the packets which are needed to decode the image:
+//		the headers, the EOI and the coarse scans of a progressive JPEG
+//
+// Parameters:
+//		src				- JPEG from the camera
+//		length			- Length of the JPEG (in byte)
+//		dst				- Framed JPEG, FRAME_SIZE bytes
+//		packet_length	- Length of the packets of the session
+//		must			- Bit = 1 for each needed packet, JPEG_MUST_SIZE bytes
+//
+// Return:
+//		Length of the framed JPEG, 0 if it is not a JPEG which can be decoded from partial
+//		data (no restart marker and not progressive) or it does not fit FRAME_SIZE
+//
+// *******************************************************************************************
+uint32_t app_rpi_img_jpeg_frame(uint8_t *src, uint32_t length, uint8_t *dst, uint16_t packet_length, uint8_t *must);
+
+
 // *******************************************************************************************
 // Function:
 //		void app_rpi_img_recv_store_data(node_t NODE)
@@ -77,10 +257,12 @@ void app_rpi_img_recv_store_data(node_t NODE);
 //		void* app_rpi_img_recv_data(void *arg)
 //
 // Description:
-//		Receive image from TX
+//		Receive image from TX on RX_SESSIONS entries of the session table in one event
+//		loop, each frame is queued to the writer. It returns when no session has received
+//		a command for SESS_TIME_OUT
 //
 // Parameters:
-//		SESSION	- Session information
+//		SESSION	- Session information, copied to each entry
 //
 // Return:
 //		None
@@ -94,7 +276,7 @@ void* app_rpi_img_recv_data(void *arg);
 //		void* app_rpi_img_store_data(void *arg)
 //
 // Description:
-//		Store image to file
+//		Writer thread: store the queued frames to IMG_DIR, in batches
 //
 // Parameters:
 //		SESSION	- Session information
@@ -106,3 +288,19 @@ void* app_rpi_img_recv_data(void *arg);
 void* app_rpi_img_store_data(void *arg);
 
 
+// *******************************************************************************************
+// Function:
+//		void app_rpi_img_relay_data(node_t NODE, uint16_t up_addr)
+//
+// Description:
+//		Receive image from the previous hop and forward it to the next hop
+//
+// Parameters:
+//		NODE		- Node information, dest_addr is the next hop
+//		up_addr		- Address of the previous hop
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void app_rpi_img_relay_data(node_t NODE, uint16_t up_addr);
@@ -3,12 +3,30 @@
 #include "../hal/hal_config_wiringpi.h"
 #include "../tal/tal_at86rf212.h"
 #include "../protocol/protocol.h"
+#include "../protocol/protocol_link.h"
+#include "../protocol/protocol_route.h"
+#include "../protocol/protocol_sess.h"
 #include "../utils/utils.h"
+#include "../utils/rt.h"
+#include "../utils/lz.h"
 #include "../mydebug/mydebug.h"
+#include <fcntl.h>
 
 
-pthread_mutex_t app_recv_done_mutex;
-pthread_cond_t app_recv_done_cond;
+// Received frames, recv -> store
+frame_pool_t app_store_pool;
+
+// Last frame received in full and the received delta frame (DELTA_USED)
+static uint8_t *app_ref_data;
+static uint32_t app_ref_length;
+static uint8_t *app_delta_data;
+
+// Entries of the session table and the frame each one receives to
+static sess_t app_rx_sess[RX_SESSIONS];
+static frame_t *app_rx_frame[RX_SESSIONS];
+static uint32_t app_rx_index;			// number of the next frame
+static uint32_t app_rx_dropped;			// frames dropped because the writer keeps all frames
+static uint16_t app_rx_part;			// parts which follow the last part of a frame (SESS_CODEC_PART), 0: none
 
 // ===========================================================
 //
@@ -32,31 +50,45 @@ void app_rpi_img_recv_store_data(node_t NODE)
 #endif
 
 	at86rfx_frame_rx = false;
+	link_init(NODE.src_addr);
+#if SAR_USED_ROUTE == 1
+	route_init(NODE.src_addr, SINK_ADDR);
+#endif
 
 	// ------ Initialize SESSION information  ------
-	SESSION.frame_data = (uint8_t*) calloc (FRAME_SIZE, sizeof(uint8_t));
-	if (SESSION.frame_data == NULL)
+	// Each session is received to a free frame of the pool
+	frame_pool_init(&app_store_pool, STORE_FRAMES, FRAME_SIZE);
+#if DELTA_USED == 1
+	app_ref_data = (uint8_t*) calloc (FRAME_SIZE, sizeof(uint8_t));
+	app_delta_data = (uint8_t*) calloc (FRAME_SIZE, sizeof(uint8_t));
+	if ((app_ref_data == NULL) || (app_delta_data == NULL))
 	{
 		printf("Info: --- Not enough memory to store data file ... \n");
 		exit (1);
 	}
-	printf("Info: --- Read image data from file ... \n");
+	app_ref_length = 0;
+#endif
+#if RT_USED == 1
+	rt_init();
+#endif
 
 	SESSION.frame_length = 0;
 	SESSION.packet_length = 0;
 	SESSION.num_of_packet = 0;
+	SESSION.codec = SESS_CODEC_NONE;	// given by CONFIG
+	SESSION.raw_length = 0;
+	SESSION.ref_id = SESS_REF_NONE;	// no delta frame before the first frame
 	SESSION.src_addr = NODE.src_addr;
 	SESSION.dest_addr = NODE.dest_addr;
+	SESSION.sess_id = 0;			// taken from the PING or SETUP of each session
 	SESSION.window_size = PACKETS_PER_TRANS;
 	SESSION.tx_delay = 0;
 	SESSION.time_out = 0;
-	SESSION.guarantee_end = false;	// it is set to true in PING command,
+	SESSION.guarantee_end = false;	// it is set to true in PING or SETUP command,
 									// i.e., END is sent to TX perfectly
+	SESSION.link_mode = LINK_MODE_DEFAULT;
 
 	// ------ Initialize THREAD  ------
-	pthread_mutex_init(&app_recv_done_mutex, NULL);
-	pthread_cond_init (&app_recv_done_cond, NULL);
-
 	printf("Debug: --- Create thread to receive data\n");
 	pthread_create(&tid[0], NULL, app_rpi_img_recv_data, &SESSION);
 	printf("Debug: --- Create thread to store data\n");
@@ -72,68 +104,188 @@ void app_rpi_img_recv_store_data(node_t NODE)
 	debug_print();
 #endif
 
-	free(SESSION.frame_data);
-
 	// Clean up and destroy
-	pthread_mutex_destroy(&app_recv_done_mutex);
-	pthread_cond_destroy(&app_recv_done_cond);
+	frame_pool_free(&app_store_pool);
+#if DELTA_USED == 1
+	free(app_ref_data);
+	free(app_delta_data);
+#endif
 
 	pthread_exit(NULL);
 }
 
 
+#if DELTA_USED == 1
 // ===========================================================
 //
-// Receive image from TX
+// Reference frame of the next delta frame of each entry
 //
 // ===========================================================
-void* app_rpi_img_recv_data(void *arg)
+static void app_rpi_img_recv_ref(uint16_t ref_id)
 {
-	sess_t *SESSION;
+	uint8_t i;
 
-	// Initialization
-	SESSION = (sess_t *)arg;
+	for (i = 0; i < RX_SESSIONS; ++i)
+		app_rx_sess[i].ref_id = ref_id;
+}
+#endif
 
 
-	while (SESSION->time_out < SESS_TIME_OUT)
+// ===========================================================
+//
+// End of a session: the frame goes to the writer
+//
+// ===========================================================
+static uint8_t app_rpi_img_recv_frame(sess_t *SESSION)
+{
+	uint8_t entry, part;
+	uint32_t length;
+	frame_t *FRAME, *NEXT;
+
+	for (entry = 0; entry < RX_SESSIONS; ++entry)
+		if (&app_rx_sess[entry] == SESSION)
+			break;
+	if (entry == RX_SESSIONS)
+		return false;
+	FRAME = app_rx_frame[entry];
+
+	printf("Debug: --- Session %d of 0x%04x, entry %d\n", SESSION->sess_id, SESSION->dest_addr, entry);
+	SESSION->guarantee_end = false;
+
+	// Telemetry of TX is printed, the frame stays with the entry and the reference is kept
+	if ((SESSION->codec == SESS_CODEC_NONE) && (SESSION->frame_length < TELEMETRY_SIZE) &&
+		(SESSION->frame_length >= strlen(TELEMETRY_TAG)) &&
+		(memcmp(FRAME->data, TELEMETRY_TAG, strlen(TELEMETRY_TAG)) == 0))
 	{
-		// ------ Run SESSION ------
-		printf("Debug: --- Session %d\n", MYDEBUG.loss_msg_index);
-		pro_rx(SESSION);
+		printf("Info: --- Telemetry: %.*s\n", (int)(SESSION->frame_length - strlen(TELEMETRY_TAG)), FRAME->data + strlen(TELEMETRY_TAG));
+#if SAR_USED_ROUTE == 1
+		SESSION->dest_addr = SESS_ADDR_ANY;
+#endif
+		return true;
+	}
 
-		pthread_mutex_lock(&app_recv_done_mutex);
-		if ((SESSION->guarantee_end == true) || (SESSION->time_out >= SESS_TIME_OUT))
+	// The next part of a frame larger than FRAME_SIZE is appended to the same frame
+	part = ((SESSION->codec == SESS_CODEC_PART) && (app_rx_part > 0) && ((SESSION->raw_length + 1) == app_rx_part)) ? true : false;
+	if ((part == false) && (app_rx_part > 0))
+		printf("Info: --- Frame %d is incomplete, %d parts are lost\n", app_rx_index - 1, app_rx_part);
+	if (part == true)
+		--app_rx_index;
+	app_rx_part = (SESSION->codec == SESS_CODEC_PART) ? SESSION->raw_length : 0;
+
+	if (SESSION->lost > 0)
+		printf("Info: --- Frame %d is degraded, %d packets are lost\n", app_rx_index, SESSION->lost);
+	length = SESSION->frame_length;
+
+#if DELTA_USED == 1
+	// A delta frame is decoded with the reference frame
+	if (SESSION->codec == SESS_CODEC_DELTA)
+	{
+		memcpy(app_delta_data, FRAME->data, SESSION->frame_length);
+		length = lz_decompress_dict(app_delta_data, SESSION->frame_length, app_ref_data, app_ref_length, FRAME->data, FRAME_SIZE);
+		printf("Debug: --- Delta to frame of session %d, %d bytes to %d bytes\n", SESSION->ref_id, SESSION->frame_length, length);
+		if (length != SESSION->raw_length)
 		{
-			// Waiting thread when condition is reached.
-			pthread_cond_signal(&app_recv_done_cond);
+			printf("Info: --- Cannot decode the delta frame %d\n", app_rx_index);
+			length = 0;
+		}
+	}
 
-			if (SESSION->guarantee_end == true)
-			{
-				SESSION->guarantee_end = false;
+	// The frame received in full is the reference of the next delta frame, on every entry
+	app_rpi_img_recv_ref(SESS_REF_NONE);
+	if ((SESSION->lost == 0) && (length > 0) && (SESSION->codec != SESS_CODEC_PART))
+	{
+		memcpy(app_ref_data, FRAME->data, length);
+		app_ref_length = length;
+		app_rpi_img_recv_ref(SESSION->sess_id);
+	}
+#endif
+
+	// The frame goes to the writer and the next session is received to a free
+	// frame. If the writer keeps all frames, the next session overwrites this one
+	NEXT = frame_pool_take(&app_store_pool, false);
+	if (NEXT != NULL)
+	{
+		FRAME->length = length;
+		FRAME->index = app_rx_index;
+		FRAME->codec = (part == true) ? SESS_CODEC_PART : SESS_CODEC_NONE;	// SESS_CODEC_PART: appended
+		frame_pool_give(&app_store_pool, FRAME);
+		app_rx_frame[entry] = NEXT;
+		SESSION->frame_data = NEXT->data;
+	}
+	else
+	{
+		printf("Debug: --- Frame %d dropped, the storage is busy\n", app_rx_index);
+		++app_rx_dropped;
+	}
+	++app_rx_index;
+
+#if SAR_USED_ROUTE == 1
+	// The last hop of each session is given by the routes
+	SESSION->dest_addr = SESS_ADDR_ANY;
+#endif
 
 #if DEBUG_INFO == 1		// ----------------------------------------
-				// +1: the 1st message ID is 0
-				MYDEBUG.recv_msgid_current = 0;
-				MYDEBUG.recv_msgid_order_total += (MYDEBUG.recv_msgid_order_session[MYDEBUG.recv_msgid_index] + 1);
-				++MYDEBUG.recv_msgid_index;
+	// +1: the 1st message ID is 0
+	MYDEBUG.recv_msgid_current = 0;
+	MYDEBUG.recv_msgid_order_total += (MYDEBUG.recv_msgid_order_session[MYDEBUG.recv_msgid_index] + 1);
+	++MYDEBUG.recv_msgid_index;
 
-				MYDEBUG.loss_msg_total += MYDEBUG.loss_msg_session[MYDEBUG.loss_msg_index];
-				++MYDEBUG.loss_msg_index;
+	MYDEBUG.loss_msg_total += MYDEBUG.loss_msg_session[MYDEBUG.loss_msg_index];
+	++MYDEBUG.loss_msg_index;
 
-				MYDEBUG.crob_total += MYDEBUG.crob_session[MYDEBUG.crob_index];
-				++MYDEBUG.crob_index;
+	MYDEBUG.crob_total += MYDEBUG.crob_session[MYDEBUG.crob_index];
+	++MYDEBUG.crob_index;
 
-				MYDEBUG.crc_invalid_total += MYDEBUG.crc_invalid_session[MYDEBUG.crc_invalid_index];
-				++MYDEBUG.crc_invalid_index;
+	MYDEBUG.crc_invalid_total += MYDEBUG.crc_invalid_session[MYDEBUG.crc_invalid_index];
+	++MYDEBUG.crc_invalid_index;
 
-				MYDEBUG.flen_invalid_total += MYDEBUG.flen_invalid_session[MYDEBUG.flen_invalid_index];
-				++MYDEBUG.flen_invalid_index;
+	MYDEBUG.flen_invalid_total += MYDEBUG.flen_invalid_session[MYDEBUG.flen_invalid_index];
+	++MYDEBUG.flen_invalid_index;
 #endif
-			}
-		}
-		pthread_mutex_unlock(&app_recv_done_mutex);
+
+	// The entry waits for the next session
+	return true;
+}
+
+
+// ===========================================================
+//
+// Receive image from TX
+//
+// ===========================================================
+void* app_rpi_img_recv_data(void *arg)
+{
+	uint8_t i;
+
+	// Initialization
+#if RT_USED == 1
+	rt_thread_radio();
+#endif
+	app_rx_index = 1;
+	app_rx_dropped = 0;
+	app_rx_part = 0;
+
+	// Each entry receives to its own frame, a session which overlaps another one takes the next entry
+	for (i = 0; i < RX_SESSIONS; ++i)
+	{
+		app_rx_sess[i] = *(sess_t *)arg;
+#if SAR_USED_ROUTE == 1
+		// The last hop of each session is given by the routes
+		app_rx_sess[i].dest_addr = SESS_ADDR_ANY;
+#endif
+		app_rx_frame[i] = frame_pool_take(&app_store_pool, true);
+		app_rx_sess[i].frame_data = app_rx_frame[i]->data;
+		pro_sess_rx_open(&app_rx_sess[i]);
 	}
 
+	// ------ Run the SESSIONS ------
+	pro_sess_rx_run(app_rpi_img_recv_frame);
+
+	if (app_rx_dropped > 0)
+		printf("Info: --- %d frames are dropped, the storage is slower than the radio\n", app_rx_dropped);
+
+	// The writer stores the queued frames and exits
+	frame_pool_end(&app_store_pool);
 	printf("Debug: --- Time-out, exit app_recv_data()\n");
 	pthread_exit(NULL);
 }
@@ -141,44 +293,83 @@ void* app_rpi_img_recv_data(void *arg)
 
 // ===========================================================
 //
-// Store image to file
+// Write one frame to its file
 //
 // ===========================================================
-void* app_rpi_img_store_data(void *arg)
+static int app_rpi_img_store_frame(frame_t *FRAME)
 {
+	int fd;
+	ssize_t n;
+	uint32_t i;
 	char cmd[256];
 	char cmd_sub[32];
-	uint16_t sess_fram_length;
-	uint8_t *sess_frame_data;
-	sess_t *SESSION;
 
-	// Initialize
-	SESSION = (sess_t *) arg;
+	// Make the command
+	strcpy(cmd, IMG_DIR "/" IMG_PREFIX);
+	int2str(FRAME->index, cmd_sub, 10);
+	strcat(cmd, cmd_sub);
+	strcat(cmd, ".jpg");
 
-	// Lock mutex and wait for signals
-	pthread_mutex_lock(&app_recv_done_mutex);
-	while (SESSION->time_out < SESS_TIME_OUT)
+	// The next part of a frame larger than FRAME_SIZE is appended to its file
+	printf("Debug: --- Store to %s, %d bytes\n", cmd, FRAME->length);
+	fd = open(cmd, O_WRONLY | O_CREAT | ((FRAME->codec == SESS_CODEC_PART) ? O_APPEND : O_TRUNC), 0644);
+	if (fd < 0)
 	{
-		pthread_cond_wait(&app_recv_done_cond, &app_recv_done_mutex);
+		printf ("Error: Open %s file FAILED\n", cmd);
+		return -1;
+	}
 
-		// In case app_recv_data() is halt due to time-out
-		if (SESSION->time_out < SESS_TIME_OUT)
+	for (i = 0; i < FRAME->length; i += n)
+	{
+		n = write(fd, &FRAME->data[i], FRAME->length - i);
+		if (n <= 0)
 		{
-			sess_frame_data = &SESSION->frame_data[0];
-			sess_fram_length = SESSION->frame_length;
+			printf ("Error: Write %s file FAILED\n", cmd);
+			break;
+		}
+	}
+	return fd;
+}
 
-			// Make the command
-			strcpy(cmd, "/home/pi/my_code/tmp/data/img");
 
-			int2str(MYDEBUG.recv_msgid_index, cmd_sub, 10);
-			strcat(cmd, cmd_sub);
-			strcat(cmd, ".jpg");
+// ===========================================================
+//
+// Store image to file
+//
+// ===========================================================
+void* app_rpi_img_store_data(void *arg)
+{
+	uint8_t i, n;
+	int fd[STORE_BATCH];
+	frame_t *FRAME;
 
-			printf("Debug: --- Store to %s, %d bytes\n", cmd, sess_fram_length);
-			writeArrayToBinaryFile (cmd, sess_frame_data, sess_fram_length);
+	(void)arg;
+#if RT_USED == 1
+	rt_thread_other();
+#endif
+
+	// Sleep until a frame is received, then store all queued frames
+	while ((FRAME = frame_pool_get(&app_store_pool, FRAME_POOL_WAIT)) != NULL)
+	{
+		n = 0;
+		do {
+			fd[n++] = app_rpi_img_store_frame(FRAME);
+
+			// The data is in the page cache, RX can reuse the frame
+			frame_pool_put(&app_store_pool, FRAME);
+		} while ((n < STORE_BATCH) && ((FRAME = frame_pool_get(&app_store_pool, 0)) != NULL));
+
+		// The SD card is written once for the batch
+		for (i = 0; i < n; ++i)
+		{
+			if (fd[i] < 0)
+				continue;
+#if STORE_FSYNC == 1
+			fdatasync(fd[i]);
+#endif
+			close(fd[i]);
 		}
 	}
-	pthread_mutex_unlock(&app_recv_done_mutex);
 
 	printf("Debug: --- Time-out, exit app_store_data()\n");
 	pthread_exit(NULL);
@@ -121,6 +121,8 @@ void hal_trx_rf212_init()
 	else
 	{
 		printf("Info: --- --- SUCCEEDED\n");
+		// The short waits of the radio are calibrated once
+		pace_init();
 		// Initialize SPI in master mode to access the transceiver
 		printf("Info: --- --- Initialize SPI channel 0, clock speed 6.4 MHz ... \n");
 		if (hal_SPI0Setup(6400000) == -1)
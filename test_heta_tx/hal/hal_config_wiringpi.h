@@ -1,3 +1,5 @@
+#include "../utils/pace.h"
+
 // ***********************************************************
 // Redefine the wiringPi library
 // ***********************************************************
@@ -21,11 +23,6 @@
 #define hal_GPIOISRAnyEdge(a1, a2)		wiringPiISR(a1, INT_EDGE_BOTH, a2)		// a1: pin number, a2: pointer to function
 //
 #define hal_delay_ms(a1)				usleep(1000*a1)
-#define hal_delay_us(a1)				usleep(a1)
-#define hal_delay_ns(a1) \
-    { \
-        unsigned char a1_div_16 = a1/16; \
-		while (a1_div_16 > 0) \
-			a1_div_16 = a1_div_16 - 1; \
-    }
+#define hal_delay_us(a1)				pace_delay_us(a1)						// calibrated by pace_init() (utils/pace.h)
+#define hal_delay_ns(a1)				pace_delay_ns(a1)
 	
@@ -14,8 +14,10 @@
 // *******************************************************************************************
 // Define the RF pins <-> RPCM pin
 // *******************************************************************************************
-#define BP3596_RST		(23)	// Reset pin connects with GPIO 23 in RPCM	- O
-#define BP3596_IRQ		(21)	// Interrupt pin connects with GPIO 21 in RPCM - I
+// GPIO 23 and 21 are RST and IRQ of the AT86RF212 (hal/hal_config_pin.h), the BP3596
+// is wired to free pins outside SPI1 (GPIO 24, 27, 28, 29 and 0, 1 in wiringPi numbers)
+#define BP3596_RST		(25)	// Reset pin connects with GPIO 25 in RPCM	- O
+#define BP3596_IRQ		(26)	// Interrupt pin (SINTN) connects with GPIO 26 in RPCM - I
 
 #define BP3596_EN		(17)
 
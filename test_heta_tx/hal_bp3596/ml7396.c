@@ -393,19 +393,25 @@ error:
  *  必要に応じて自動でML7396の状態を RX_ON に変更
  */
 // 2015.06.08 Eiichi Saito : addition delay
+// Watermark streaming: the delay (TX_ON transition) is only taken before the first chunk,
+// when nothing is on air yet. The next chunks are written at FIFO_EMPTY while the packet
+// is on air, a delay there eats the FIFO_MARGIN bytes left in the FIFO and can underflow it.
 #define REG_TXCONTINUE(_buffer) \
     do { \
         uint8_t _size; \
         uint16_t _data_size; \
+        int16_t _first; \
         ASSERT((_buffer)->status >= 0); \
         _size = 256-FIFO_MARGIN; \
         _data_size = (_buffer)->size - (_buffer)->status; \
+        _first = ((_buffer)->status == 0); \
         if (_data_size <= _size) \
             _size = _data_size; \
         if (_size > 0) { \
+            if (_first) \
+                HAL_delayMicroseconds(300); \
             ON_ERROR(ml7396_regwrite(REG_ADR_WR_TX_FIFO, (_buffer)->data + (_buffer)->status, _size)); \
             (_buffer)->status += _size; \
-            HAL_delayMicroseconds(300); \
         } \
     } while (0)
 
@@ -1114,6 +1120,9 @@ static int em_rx_datarecv(EM_Data *em_data, const uint32_t *hw_event) {
         }
         #endif
         REG_RXCONTINUE(em_data->rx);
+        /* Watermark streaming: the packet is still on air, give the first status bytes to the app */
+        if (!(*hw_event & HW_EVENT_FIFO_RX_DONE) && em_data->rx->opt.rx.progress != NULL)
+            em_data->rx->opt.rx.progress(em_data->rx);
         if (*hw_event & HW_EVENT_FIFO_RX_DONE) {  /* 受信完了 */
             REG_RXDONE(em_data->rx);  /* ED値を取得 */
             #ifndef SNIFFER
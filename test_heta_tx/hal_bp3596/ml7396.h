@@ -107,6 +107,7 @@ typedef struct {
  * opt.rx.done      U      -        -
  * opt.rx.next      U      -        -
  * opt.rx.filter    U      -        -
+ * opt.rx.progress  U      -        -
  * opt.rx.ed        S      -        -
  * opt.tx.done      -      U        -
  * opt.tx.next      -      U        -
@@ -116,7 +117,7 @@ typedef struct {
  * opt.tx.cca.retry -      U        -
  * opt.tx.ed        -      S        -
  */
-#define ML7396_BUFFER_CAPACITY (256-2)  /* capacity の最大値 (ML7369の最大パケットサイズ(2047バイト) - CRCサイズ(2バイト)) */
+#define ML7396_BUFFER_CAPACITY (2047-2)  /* capacity の最大値 (ML7369の最大パケットサイズ(2047バイト) - CRCサイズ(2バイト)) */
 typedef struct ml7396_buffer {
     uint8_t *data;                                   /* パケットデータ (capacity 分のサイズ領域へのポインタ) */
     uint16_t capacity;                               /* パケットデータの最大サイズ (最大値は ML7396_BUFFER_CAPACITY) */
@@ -128,6 +129,7 @@ typedef struct ml7396_buffer {
             void (*done)(struct ml7396_buffer *buffer);  /* 受信完了コールバック関数 */
             struct ml7396_buffer *next;                  /* 連続受信時の次のバッファポインタ(NULL=最後のバッファ) */
             int (*filter)(const ML7396_Header *header);  /* 受信フィルタ関数（戻り値: 真=受信, 偽=破棄) */
+            void (*progress)(struct ml7396_buffer *buffer);  /* Called at each FIFO_FULL while the packet is on air (NULL=none) */
         } rx;
         struct {                                       /* データ送信パラメータ */
             uint8_t ed;                                  /* ACK受信時のED値 */
@@ -168,6 +170,10 @@ extern int ml7396_setup(void *data);
  *   buffer->capacity: 受信データ収納領域のサイズ
  *   buffer->opt.rx.done: 受信完了コールバック関数
  *   buffer->opt.rx.filter: 受信フィルタ関数(フィルタリングしない場合はNULL)
+ *   buffer->opt.rx.progress: 受信途中コールバック関数(使用しない場合はNULL)
+ *                        FIFO_FULL 毎に呼ばれる, buffer->status = 読み出し済のデータサイズ
+ *                        Called at each FIFO_FULL, buffer->status = bytes already in data[]
+ *                        (MAC header not checked yet, the packet can still be dropped)
  *   buffer->opt.rx.next: 次の受信バッファ (最後ならNULL, 1つのバッファを繰り返し使うなら自分自身)
  *                        途中でエラーが発生しても次のバッファへ進む
  *
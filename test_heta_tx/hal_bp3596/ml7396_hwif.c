@@ -0,0 +1,262 @@
+/*
+ * ml7396_hwif.c
+ *
+ * Hardware interface of the ML7396 driver on the Raspberry Pi
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "hal_bp3596.h"
+#include "../hal/hal_config_wiringpi.h"
+#include "ml7396_hwif.h"
+#include "hal.h"
+
+
+// Register access of ml7396.c
+int ml7396_regwrite(uint8_t bank, uint8_t addr, const uint8_t *data, uint8_t size);
+
+// SINTN and the timer are one interrupt level: one recursive lock for both handlers
+static pthread_mutex_t hwif_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static void (*hwif_sint_func)(void);
+static void (*hwif_timer_func)(void);
+
+// One-shot timer, the thread sleeps until the deadline of the armed timer
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_cond;
+static pthread_t timer_thread;
+static uint8_t timer_armed;
+static struct timespec timer_deadline;
+
+static uint8_t hwif_started;
+
+
+// ***********************************************************
+//
+// SINTN interrupt (ISR thread of wiringPi)
+//
+// ***********************************************************
+static void hwif_sint_isr(void)
+{
+	// SINTN stays low while a source is pending, a new source does not make a new edge
+	do
+	{
+		pthread_mutex_lock(&hwif_lock);
+		if (hwif_sint_func != NULL)
+			hwif_sint_func();
+		pthread_mutex_unlock(&hwif_lock);
+	} while ((hwif_sint_func != NULL) && (hal_GPIOGetPin(BP3596_IRQ) == LOW));
+}
+
+
+// ***********************************************************
+//
+// Timer thread, the handler is called at the deadline unless the timer is stopped
+//
+// ***********************************************************
+static void *hwif_timer_thread(void *arg)
+{
+	struct timespec now;
+	uint8_t fire;
+
+	(void)arg;
+	while (1)
+	{
+		pthread_mutex_lock(&timer_lock);
+		while (1)
+		{
+			if (timer_armed == 0)
+				pthread_cond_wait(&timer_cond, &timer_lock);
+			else if (pthread_cond_timedwait(&timer_cond, &timer_lock, &timer_deadline) == ETIMEDOUT)
+				break;
+		}
+		pthread_mutex_unlock(&timer_lock);
+
+		// The lock of the handlers is taken first, as in ml7396_hwif_timer_start()
+		pthread_mutex_lock(&hwif_lock);
+		pthread_mutex_lock(&timer_lock);
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		fire = (timer_armed != 0) && ((now.tv_sec > timer_deadline.tv_sec) ||
+				((now.tv_sec == timer_deadline.tv_sec) && (now.tv_nsec >= timer_deadline.tv_nsec)));
+		if (fire != 0)
+			timer_armed = 0;
+		pthread_mutex_unlock(&timer_lock);
+		if ((fire != 0) && (hwif_timer_func != NULL))
+			hwif_timer_func();
+		pthread_mutex_unlock(&hwif_lock);
+	}
+	return NULL;
+}
+
+
+// ***********************************************************
+//
+// Reset the ML7396, start the interrupt and the timer threads
+//
+// ***********************************************************
+int ml7396_hwif_init(void)
+{
+	pthread_condattr_t attr;
+
+	hal_GPIOClearPin(BP3596_RST);
+	hal_delay_us(ML7396_HWIF_RST_US);
+	hal_GPIOSetPin(BP3596_RST);
+	hal_delay_us(ML7396_HWIF_BOOT_US);
+
+	// ml7396_setup() runs again after an error, the threads are started once
+	if (hwif_started != 0)
+		return 0;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&timer_cond, &attr);
+	pthread_condattr_destroy(&attr);
+	if (pthread_create(&timer_thread, NULL, hwif_timer_thread, NULL) != 0)
+	{
+		printf("Info: --- --- Cannot start the ML7396 timer thread\n");
+		return -1;
+	}
+
+	if (hal_GPIOISRFallingEdge(BP3596_IRQ, &hwif_sint_isr) < 0)
+	{
+		printf("Info: --- --- Cannot setup ISR of the ML7396\n");
+		return -1;
+	}
+
+	hwif_started = 1;
+	return 0;
+}
+
+
+// ***********************************************************
+//
+// SPI transfer, wiringPi reads into the written buffer
+//
+// ***********************************************************
+int ml7396_hwif_spi_transfer(const uint8_t *wdata, uint8_t *rdata, uint16_t size)
+{
+	memcpy(rdata, wdata, size);
+	return (hal_SPI1DataRW(rdata, size) < 0) ? -1 : 0;
+}
+
+
+// ***********************************************************
+//
+// Register setting after the PHY reset
+//
+// ***********************************************************
+int ml7396_hwif_regset(void *data)
+{
+	const ml7396_hwif_reg_t *reg;
+
+	for (reg = (const ml7396_hwif_reg_t *)data; (reg != NULL) && (reg->bank != ML7396_HWIF_REG_END); ++reg)
+	{
+		if (ml7396_regwrite(reg->bank, reg->addr, &reg->data, 1) < 0)
+			return -1;
+	}
+	return 0;
+}
+
+
+// ***********************************************************
+//
+// One-shot timer
+//
+// ***********************************************************
+int ml7396_hwif_timer_start(uint16_t msec)
+{
+	pthread_mutex_lock(&timer_lock);
+	clock_gettime(CLOCK_MONOTONIC, &timer_deadline);
+	timer_deadline.tv_sec += msec / 1000;
+	timer_deadline.tv_nsec += (long)(msec % 1000) * 1000000L;
+	if (timer_deadline.tv_nsec >= 1000000000L)
+	{
+		timer_deadline.tv_nsec -= 1000000000L;
+		++timer_deadline.tv_sec;
+	}
+	timer_armed = 1;
+	pthread_cond_signal(&timer_cond);
+	pthread_mutex_unlock(&timer_lock);
+	return 0;
+}
+
+
+int ml7396_hwif_timer_stop(void)
+{
+	pthread_mutex_lock(&timer_lock);
+	timer_armed = 0;
+	pthread_cond_signal(&timer_cond);
+	pthread_mutex_unlock(&timer_lock);
+	return 0;
+}
+
+
+// ***********************************************************
+//
+// Interrupt masks
+//
+// ***********************************************************
+void ml7396_hwif_sint_di(void)
+{
+	pthread_mutex_lock(&hwif_lock);
+}
+
+
+void ml7396_hwif_sint_ei(void)
+{
+	pthread_mutex_unlock(&hwif_lock);
+}
+
+
+void ml7396_hwif_timer_di(void)
+{
+	pthread_mutex_lock(&hwif_lock);
+}
+
+
+void ml7396_hwif_timer_ei(void)
+{
+	pthread_mutex_unlock(&hwif_lock);
+}
+
+
+// ***********************************************************
+//
+// Handlers of em_main()
+//
+// ***********************************************************
+void ml7396_hwif_sint_handler(void (*func)(void))
+{
+	hwif_sint_func = func;
+}
+
+
+void ml7396_hwif_timer_handler(void (*func)(void))
+{
+	hwif_timer_func = func;
+}
+
+
+// ***********************************************************
+//
+// No EEPROM on the Raspberry Pi, seed of the CSMA back-off
+//
+// ***********************************************************
+int HAL_I2C_read(uint8_t slave_addr, uint8_t reg_addr, uint8_t *data, uint8_t size)
+{
+	struct timespec now;
+	uint8_t i;
+
+	(void)slave_addr;
+	(void)reg_addr;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	for (i = 0; i < size; ++i)
+		data[i] = (uint8_t)(now.tv_nsec >> (i << 3));
+	return 0;
+}
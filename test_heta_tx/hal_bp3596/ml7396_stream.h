@@ -0,0 +1,140 @@
+/*
+ * ml7396_stream.h
+ *
+ * Buffer-pool streaming on top of ml7396_txstart()/ml7396_rxstart():
+ * TX buffers are chained with opt.tx.next and RX buffers with opt.rx.next,
+ * so the ML7396 goes from one packet to the next without a software restart.
+ */
+
+#ifndef HAL_BP3596_ML7396_STREAM_H_
+#define HAL_BP3596_ML7396_STREAM_H_
+
+#include <stdint.h>
+
+#include "ml7396.h"
+
+
+// *******************************************************************************************
+// Buffer pool
+// *******************************************************************************************
+#define ML7396_STREAM_TX_NUM		(16)	// TX buffers, i.e. packets in flight
+#define ML7396_STREAM_RX_NUM		(16)	// RX buffers, i.e. packets not read yet by the app
+#define ML7396_STREAM_BUFFER_SIZE	(ML7396_BUFFER_CAPACITY)
+
+#define ML7396_STREAM_CCA_WAIT		(1)
+#define ML7396_STREAM_CCA_RETRY		(4)
+
+// Completion callback, called in the ML7396 interrupt handler for each buffer
+typedef void (*ml7396_stream_cb)(ML7396_Buffer *buffer);
+
+
+// ===============================================================================================================================
+// *******************************************************************************************
+// Function:
+//		int ml7396_stream_init(ml7396_stream_cb tx_done, ml7396_stream_cb rx_done, ml7396_stream_cb rx_progress)
+//
+// Description:
+//		Build the buffer pools and start the continuous reception on the RX ring.
+//		ml7396_reset() and ml7396_setup() must be already called
+//
+// Parameters:
+//		tx_done		- Called after each TX buffer (status >= 0: sent, < 0: error), can be NULL
+//		rx_done		- Called after each received packet is queued for ml7396_stream_rx_get(), can be NULL
+//		rx_progress	- Called while a packet is received, at each RX FIFO watermark
+//					  (status = bytes already in data[]), can be NULL
+//
+// Return:
+//		ML7396_STATUS_OK or the error of ml7396_rxstart()
+//
+// *******************************************************************************************
+int ml7396_stream_init(ml7396_stream_cb tx_done, ml7396_stream_cb rx_done, ml7396_stream_cb rx_progress);
+
+
+// *******************************************************************************************
+// Function:
+//		ML7396_Buffer *ml7396_stream_tx_alloc(void)
+//
+// Description:
+//		Get a free TX buffer, the app fills data[] and size
+//
+// Parameters:
+//		None
+//
+// Return:
+//		TX buffer, NULL if all buffers are in flight
+//
+// *******************************************************************************************
+ML7396_Buffer *ml7396_stream_tx_alloc(void);
+
+
+// *******************************************************************************************
+// Function:
+//		int ml7396_stream_tx_enqueue(ML7396_Buffer *chain)
+//
+// Description:
+//		Append a buffer, or a chain of buffers linked by opt.tx.next, to the packets in
+//		flight. The transmission is started if the ML7396 is idle
+//
+// Parameters:
+//		chain		- First buffer of the chain (from ml7396_stream_tx_alloc())
+//
+// Return:
+//		ML7396_STATUS_OK or the error of ml7396_txstart()
+//
+// *******************************************************************************************
+int ml7396_stream_tx_enqueue(ML7396_Buffer *chain);
+
+
+// *******************************************************************************************
+// Function:
+//		uint8_t ml7396_stream_tx_pending(void)
+//
+// Description:
+//		Number of TX buffers in flight
+//
+// Parameters:
+//		None
+//
+// Return:
+//		0 if all packets are sent
+//
+// *******************************************************************************************
+uint8_t ml7396_stream_tx_pending(void);
+
+
+// *******************************************************************************************
+// Function:
+//		ML7396_Buffer *ml7396_stream_rx_get(void)
+//
+// Description:
+//		Get the oldest received packet, data[] and status (size) are valid
+//		until ml7396_stream_rx_release()
+//
+// Parameters:
+//		None
+//
+// Return:
+//		RX buffer, NULL if nothing is received
+//
+// *******************************************************************************************
+ML7396_Buffer *ml7396_stream_rx_get(void);
+
+
+// *******************************************************************************************
+// Function:
+//		void ml7396_stream_rx_release(ML7396_Buffer *buffer)
+//
+// Description:
+//		Give a buffer back to the RX ring, restart the reception if the ring was full
+//
+// Parameters:
+//		buffer		- Buffer from ml7396_stream_rx_get()
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void ml7396_stream_rx_release(ML7396_Buffer *buffer);
+
+
+#endif /* HAL_BP3596_ML7396_STREAM_H_ */
@@ -0,0 +1,634 @@
+#include "../at86rf212_param.h"
+#include "../tal/tal_at86rf212.h"
+#include "../tal/tal_at86rf212_trx.h"
+#include "../hal/hal_at86rf212_trx_access.h"
+#include "../utils/reactor.h"
+#include "protocol.h"
+#include "protocol_link.h"
+#include "protocol_airtime.h"
+#include "protocol_route.h"
+
+#if SAR_USED_ML7396 != 0
+#include "../hal_bp3596/hal_bp3596.h"
+#include "../hal_bp3596/ml7396.h"
+#include "../hal_bp3596/ml7396_stream.h"
+#include "../hal_bp3596/ieee802154.h"
+#include "../hal_bp3596/endian.h"
+
+// Both modules are reset and interrupt the Raspberry Pi on their own pins
+#if (BP3596_RST == AT86RF212_RST) || (BP3596_IRQ == AT86RF212_IRQ)
+#error "SAR_USED_ML7396: BP3596 shares RST/IRQ with AT86RF212, re-wire the BP3596 and update hal_bp3596_config_pin.h"
+#endif
+#endif
+
+
+link_t SAR_LINK[LINK_NUM];
+
+static uint8_t link_window_sess;				// session ID of the window, sessions are interleaved by protocol_sess
+static uint16_t link_window_base;
+static uint8_t link_window[LINK_WINDOW_MAX];	// link of each packet sent since the last CHECK
+static reactor_timer_t link_poll_timer;			// polls the links when the ISR cannot be set up
+static link_input_cb link_input[LINK_INPUT_MAX];	// handlers of the received messages
+static void *link_input_arg[LINK_INPUT_MAX];
+static int8_t link_source = -1;					// reactor source which reads the links
+#if SAR_USED_ML7396 != 0
+static volatile uint32_t link_ml7396_rx_left;	// us left of the ML7396 packet on air, 0: none
+static volatile uint8_t link_ml7396_rx_new;		// link_ml7396_rx_left is not read yet
+#endif
+
+
+// ===========================================================
+//
+// AT86RF212 IRQ (ISR thread of wiringPi), the frame is read by the event loop
+//
+// ===========================================================
+static void link_irq(void)
+{
+	reactor_wake();
+}
+
+
+// ===========================================================
+//
+// Poll timer, the links are polled at each wake-up of the loop
+//
+// ===========================================================
+static void link_poll(void *arg)
+{
+	(void)arg;
+	reactor_timer_start(&link_poll_timer, reactor_now() + LINK_POLL_US);
+}
+
+
+#if SAR_USED_ML7396 != 0
+// ===========================================================
+//
+// ML7396 packet received (ML7396 interrupt handler)
+//
+// ===========================================================
+static void link_ml7396_rx_done(ML7396_Buffer *buffer)
+{
+	(void)buffer;
+	link_ml7396_rx_left = 0;
+	link_ml7396_rx_new = 1;
+	reactor_wake();
+}
+
+
+// ===========================================================
+//
+// ML7396 RX FIFO watermark, the rest of the packet is still on air
+//
+// ===========================================================
+static void link_ml7396_rx_progress(ML7396_Buffer *buffer)
+{
+	if ((buffer->status < 0) || (buffer->status >= buffer->size))
+		return;
+	link_ml7396_rx_left = (uint32_t)(buffer->size - buffer->status + FCS_LEN) * LINK_ML7396_OCT_US;
+	link_ml7396_rx_new = 1;
+	reactor_wake();
+}
+#endif
+
+
+// ===========================================================
+//
+// Initialize all links
+//
+// ===========================================================
+void link_init(uint16_t src_addr)
+{
+	uint8_t i;
+
+	(void)src_addr;		// ML7396 address
+	memset(&SAR_LINK[0], 0, sizeof(SAR_LINK));
+	memset(&link_window[0], LINK_NONE, LINK_WINDOW_MAX);
+	link_window_sess = 0;
+	link_window_base = 0;
+
+	// AT86RF212 is initialized by at86rfx_init()
+	SAR_LINK[LINK_AT86RF212].enable = true;
+	SAR_LINK[LINK_AT86RF212].oct_us = LINK_AT86RF212_OCT_US;
+	SAR_LINK[LINK_ML7396].oct_us = LINK_ML7396_OCT_US;
+	airtime_init();
+
+	// The received frames are read by the event loop
+	reactor_init();
+	reactor_timer_init(&link_poll_timer, link_poll, NULL);
+	if (hal_GPIOISRRisingEdge(AT86RF212_IRQ, &link_irq) < 0)
+	{
+		printf("Info: --- Cannot setup ISR, poll AT86RF212 every %d us\n", LINK_POLL_US);
+		link_poll(NULL);
+	}
+
+#if SAR_USED_ML7396 != 0
+	printf("Info: --- Initialize BP3596 Power ... \n");
+	hal_bp3596_power_en(1);
+	hal_delay_ms(500);
+
+	printf("Info: --- Initialize BP3596 ... \n");
+	hal_bp3596_init();
+	if ((ml7396_reset() != ML7396_STATUS_OK) || (ml7396_setup(NULL) != ML7396_STATUS_OK))
+	{
+		printf("Info: --- FAILED, use AT86RF212 only\n");
+		hal_bp3596_power_en(0);
+		return;
+	}
+	*ml7396_myaddr() = src_addr;
+
+	// Continuous receive and transmit on chained buffers
+	if (ml7396_stream_init(NULL, link_ml7396_rx_done, link_ml7396_rx_progress) != ML7396_STATUS_OK)
+	{
+		printf("Info: --- FAILED, use AT86RF212 only\n");
+		hal_bp3596_power_en(0);
+		return;
+	}
+	printf("Info: --- SUCCEEDED\n");
+
+	SAR_LINK[LINK_ML7396].enable = true;
+#endif
+
+	for (i = 0; i < LINK_NUM; ++i)
+		printf("Debug: --- --- Link %d: enable = %d, %d us/octet\n", i, SAR_LINK[i].enable, SAR_LINK[i].oct_us);
+}
+
+
+// ===========================================================
+//
+// Airtime of a message
+//
+// ===========================================================
+uint32_t link_airtime(uint8_t link, uint16_t msg_length)
+{
+	uint32_t airtime;
+
+	airtime = (msg_length + FCS_LEN + LINK_PHY_OVERHEAD) * SAR_LINK[link].oct_us;
+	if (link == LINK_ML7396)
+		airtime += LINK_ML7396_MHR_LEN * SAR_LINK[link].oct_us;
+	return airtime;
+}
+
+
+// ===========================================================
+//
+// Send a message on one link
+//
+// ===========================================================
+void link_tx_frame(uint8_t link, uint8_t *msg, uint16_t msg_length)
+{
+	uint16_t dest_addr;
+#if SAR_USED_ML7396 != 0
+	uint16_t fc;
+	ML7396_Buffer *buffer;
+#endif
+
+	// Airtime of the link and of the session (BEACON: the link only), waited by the SEND packets (link_wait())
+	dest_addr = (msg[4] << 8) + msg[5];
+	airtime_take(link, (dest_addr != ROUTE_ADDR_NONE) ? airtime_sess(dest_addr, msg[CSIDP + 1]) : NULL,
+				 link_airtime(link, msg_length));
+
+#if SAR_USED_ML7396 != 0
+	if ((link == LINK_ML7396) && (SAR_LINK[LINK_ML7396].enable == true))
+	{
+		// Wait for a free buffer, the packet is appended to the chain in flight
+		// (the SEND packets leave one buffer for the commands and ACKs, see link_wait())
+		while ((buffer = ml7396_stream_tx_alloc()) == NULL)
+			hal_delay_us(SESS_WAIT_SEND);
+
+		// IEEE 802.15.4e MAC header: PAN ID compressed, sequence number suppressed, no ACK request
+		fc = IEEE802154_FC_IEEE802154_E | IEEE802154_FC_TYPE_DATA |
+			 IEEE802154_FC_DAMODE_SHORT | IEEE802154_FC_SAMODE_SHORT |
+			 IEEE802154_FC_PANID_COMPS  | IEEE802154_FC_SEQ_SUPPRESS;
+		u2v16_set(fc, &buffer->data[0]);
+		u2v16_set(((msg[4] << 8) + msg[5]), &buffer->data[2]);	// destination address
+		u2v16_set(((msg[2] << 8) + msg[3]), &buffer->data[4]);	// source address
+
+		memcpy(&buffer->data[LINK_ML7396_MHR_LEN], &msg[1], msg_length);
+		buffer->size = msg_length + LINK_ML7396_MHR_LEN;
+
+		ml7396_stream_tx_enqueue(buffer);
+		return;
+	}
+#endif
+
+	// AT86RF212 frames are limited to PHY_MAX_LENGTH
+	if (msg_length > PHY_MAX_LENGTH - FCS_LEN)
+	{
+		printf("Info: --- --- Message of %d bytes is too long for AT86RF212\n", msg_length);
+		return;
+	}
+	at86rfx_tx_frame(&msg[0]);
+	handle_tal_state();
+}
+
+
+// ===========================================================
+//
+// Wait until all links are idle
+//
+// ===========================================================
+void link_flush(void)
+{
+#if SAR_USED_ML7396 != 0
+	while (ml7396_stream_tx_pending() > 0)
+		hal_delay_us(SESS_WAIT_SEND);
+#endif
+}
+
+
+// ===========================================================
+//
+// All links are idle
+//
+// ===========================================================
+uint8_t link_idle(void)
+{
+#if SAR_USED_ML7396 != 0
+	if (ml7396_stream_tx_pending() > 0)
+		return false;
+#endif
+	return true;
+}
+
+
+// ===========================================================
+//
+// Time before a SEND packet can go on one link
+//
+// ===========================================================
+static uint32_t link_wait_one(uint8_t link, airtime_t *SESS, uint16_t msg_length)
+{
+#if SAR_USED_ML7396 != 0
+	// One TX buffer is kept for the commands and ACKs
+	if ((link == LINK_ML7396) && (SAR_LINK[LINK_ML7396].enable == true) &&
+		(ml7396_stream_tx_pending() >= ML7396_STREAM_TX_NUM - 1))
+		return SESS_WAIT_SEND;
+#endif
+	return airtime_wait(link, SESS, link_airtime(link, msg_length));
+}
+
+
+// ===========================================================
+//
+// Time before a SEND packet can go on air
+//
+// ===========================================================
+uint32_t link_wait(uint8_t link_mode, uint16_t dest_addr, uint8_t sess_id, uint16_t msg_length)
+{
+	uint8_t i;
+	uint32_t wait, wait_min;
+	airtime_t *SESS;
+
+	SESS = airtime_sess(dest_addr, sess_id);
+	if (link_mode == LINK_MODE_STRIPE)
+	{
+		// The first link which is free, link_send_data() only stripes on the free links
+		wait_min = 0xFFFFFFFF;
+		for (i = 0; i < LINK_NUM; ++i)
+		{
+			if (SAR_LINK[i].enable == false)
+				continue;
+			wait = link_wait_one(i, SESS, msg_length);
+			if (wait < wait_min)
+				wait_min = wait;
+		}
+		return wait_min;
+	}
+
+	return link_wait_one((link_mode == LINK_MODE_ML7396) ? LINK_ML7396 : LINK_AT86RF212, SESS, msg_length);
+}
+
+
+// ===========================================================
+//
+// Poll all links for a received message
+//
+// ===========================================================
+static uint16_t link_rx_poll(uint8_t *msg_recv, uint8_t *link)
+{
+	uint16_t cmd_length;
+#if SAR_USED_ML7396 != 0
+	ML7396_Buffer *buffer;
+#endif
+
+	if (IRQ_VALUE() == true)
+	{
+		trx_irq_handler_cb();
+
+		// If data are already stored
+		if (at86rfx_frame_rx == true)
+		{
+			at86rfx_frame_rx = false;
+			cmd_length = at86rfx_rx_buffer[0] - FCS_LEN;
+			memcpy(&msg_recv[0], &at86rfx_rx_buffer[1], cmd_length);
+			*link = LINK_AT86RF212;
+			return cmd_length;
+		}
+	}
+
+#if SAR_USED_ML7396 != 0
+	buffer = ml7396_stream_rx_get();
+	if (buffer != NULL)
+	{
+		cmd_length = 0;
+		if ((buffer->status > LINK_ML7396_MHR_LEN) && (buffer->status - LINK_ML7396_MHR_LEN < SAR_MSG_SIZE))
+		{
+			cmd_length = buffer->status - LINK_ML7396_MHR_LEN;
+			memcpy(&msg_recv[0], &buffer->data[LINK_ML7396_MHR_LEN], cmd_length);
+			*link = LINK_ML7396;
+		}
+		ml7396_stream_rx_release(buffer);
+		return cmd_length;
+	}
+#endif
+
+	return 0;
+}
+
+
+// ===========================================================
+//
+// Get a received message for the sessions
+//
+// ===========================================================
+uint16_t link_rx_frame(uint8_t *msg_recv, uint8_t *link)
+{
+	uint16_t cmd_length;
+
+#if SAR_USED_ROUTE == 1
+	route_poll();
+#endif
+
+	cmd_length = link_rx_poll(&msg_recv[0], link);
+
+#if SAR_USED_ROUTE == 1
+	// BEACON is only for the routing
+	if ((cmd_length > 0) && ((msg_recv[0] & (ISACK_PREFIX | CMD_PREFIX_MASK)) == BEACON))
+	{
+		route_input(&msg_recv[0], *link);
+		return 0;
+	}
+#endif
+
+	return cmd_length;
+}
+
+
+// ===========================================================
+//
+// Reactor source: read one message and give it to the handlers
+//
+// ===========================================================
+static uint8_t link_rx_event(void *arg)
+{
+	uint8_t i, link_recv;
+	uint8_t msg_recv[SAR_MSG_SIZE];
+
+	(void)arg;
+
+#if SAR_USED_ML7396 != 0
+	// End of the packet on air, read at the wake-up of its watermark
+	if (link_ml7396_rx_new == 1)
+	{
+		link_ml7396_rx_new = 0;
+		SAR_LINK[LINK_ML7396].rx_end = (link_ml7396_rx_left > 0) ? reactor_now() + link_ml7396_rx_left : 0;
+	}
+#endif
+
+	if (link_rx_frame(&msg_recv[0], &link_recv) == 0)
+		return false;
+
+	// The first handler which takes it, the others do not see it
+	for (i = 0; i < LINK_INPUT_MAX; ++i)
+		if ((link_input[i] != NULL) && (link_input[i](link_input_arg[i], &msg_recv[0], link_recv) == true))
+			break;
+	return true;
+}
+
+
+// ===========================================================
+//
+// Add a handler of the received messages
+//
+// ===========================================================
+int8_t link_input_add(link_input_cb cb, void *arg)
+{
+	uint8_t i;
+
+	for (i = 0; i < LINK_INPUT_MAX; ++i)
+		if (link_input[i] == NULL)
+			break;
+	if (i == LINK_INPUT_MAX)
+		return -1;
+
+	// The links are read by the event loop while there is a handler
+	if (link_source < 0)
+	{
+		link_source = reactor_source_add(link_rx_event, NULL);
+		if (link_source < 0)
+			return -1;
+	}
+
+	link_input[i] = cb;
+	link_input_arg[i] = arg;
+	return i;
+}
+
+
+// ===========================================================
+//
+// Remove a handler of the received messages
+//
+// ===========================================================
+void link_input_remove(int8_t entry)
+{
+	uint8_t i;
+
+	if ((entry < 0) || (entry >= LINK_INPUT_MAX))
+		return;
+	link_input[entry] = NULL;
+
+	for (i = 0; i < LINK_INPUT_MAX; ++i)
+		if (link_input[i] != NULL)
+			return;
+	reactor_source_remove(link_source);
+	link_source = -1;
+}
+
+
+// ===========================================================
+//
+// Wait for the end of the packet on air
+//
+// ===========================================================
+uint64_t link_rx_wait(uint8_t link_mode, uint64_t when)
+{
+	if ((link_mode == LINK_MODE_ML7396) && (SAR_LINK[LINK_ML7396].rx_end > when))
+		return SAR_LINK[LINK_ML7396].rx_end;
+	return when;
+}
+
+
+// ===========================================================
+//
+// Restart the striping for a new window
+//
+// ===========================================================
+void link_window_start(uint8_t sess_id, uint16_t pktid_start)
+{
+	uint8_t i;
+
+	link_window_sess = sess_id;
+	link_window_base = pktid_start;
+	memset(&link_window[0], LINK_NONE, LINK_WINDOW_MAX);
+
+	for (i = 0; i < LINK_NUM; ++i)
+	{
+		SAR_LINK[i].busy = 0;
+		SAR_LINK[i].sent = 0;
+	}
+}
+
+
+// ===========================================================
+//
+// Remember the link of a packet for link_update_loss()
+//
+// ===========================================================
+static void link_window_set(uint16_t pktid, uint8_t link)
+{
+	uint16_t j;
+
+	j = pktid - link_window_base;
+	if ((pktid >= link_window_base) && (j < LINK_WINDOW_MAX))
+	{
+		link_window[j] = link;
+		++SAR_LINK[link].sent;
+	}
+}
+
+
+// ===========================================================
+//
+// Send a SEND packet on the link which finishes it first
+//
+// ===========================================================
+uint8_t link_send_data(uint8_t link_mode, uint16_t pktid, uint8_t *msg, uint16_t msg_length)
+{
+	uint8_t i, link;
+	uint32_t finish, finish_min;
+	airtime_t *SESS;
+
+	link = LINK_AT86RF212;
+	if (link_mode == LINK_MODE_STRIPE)
+	{
+		// Only the links on which the packet can go now (link_wait())
+		SESS = airtime_sess((msg[4] << 8) + msg[5], msg[CSIDP + 1]);
+		finish_min = 0xFFFFFFFF;
+		for (i = 0; i < LINK_NUM; ++i)
+		{
+			if ((SAR_LINK[i].enable == false) || (link_wait_one(i, SESS, msg_length) > 0))
+				continue;
+
+			// Airtime of the packet, inflated by the expected number of transmissions
+			finish = link_airtime(i, msg_length);
+			finish = SAR_LINK[i].busy + (finish * LINK_LOSS_ONE) / (LINK_LOSS_ONE - SAR_LINK[i].loss);
+
+			if (finish < finish_min)
+			{
+				finish_min = finish;
+				link = i;
+			}
+		}
+		if (finish_min < 0xFFFFFFFF)
+			SAR_LINK[link].busy = finish_min;
+	}
+	else if (link_mode == LINK_MODE_ML7396)
+		link = LINK_ML7396;
+
+	link_window_set(pktid, link);
+	link_tx_frame(link, &msg[0], msg_length);
+	return link;
+}
+
+
+// ===========================================================
+//
+// Re-send a lost packet on the healthiest link
+//
+// ===========================================================
+uint8_t link_resend_data(uint8_t link_mode, uint16_t pktid, uint8_t *msg, uint16_t msg_length)
+{
+	uint8_t i, link;
+
+	link = LINK_AT86RF212;
+	if (link_mode == LINK_MODE_STRIPE)
+	{
+		for (i = 0; i < LINK_NUM; ++i)
+			if ((SAR_LINK[i].enable == true) && (SAR_LINK[i].loss < SAR_LINK[link].loss))
+				link = i;
+	}
+	else if (link_mode == LINK_MODE_ML7396)
+		link = LINK_ML7396;
+
+	link_window_set(pktid, link);
+	link_tx_frame(link, &msg[0], msg_length);
+	return link;
+}
+
+
+// ===========================================================
+//
+// Update the loss ratio of each link after CHECK
+//
+// ===========================================================
+void link_update_loss(uint8_t sess_id, uint16_t pktid_update, uint16_t length, uint8_t *table)
+{
+	uint8_t link;
+	uint16_t i, j, k;
+	int16_t sample;
+
+	// Another session has started its window since, the links of the packets are unknown
+	if (sess_id != link_window_sess)
+		return;
+
+	for (i = 0; i < LINK_NUM; ++i)
+		SAR_LINK[i].lost = 0;
+
+	// Packets before pktid_update and after the table are received
+	for (i = 0; i < (length << 3); ++i)
+	{
+		if ((table[i >> 3] & (0x1 << (i % 8))) != 0)
+			continue;
+
+		k = pktid_update + i;
+		j = k - link_window_base;
+		if ((k < link_window_base) || (j >= LINK_WINDOW_MAX))
+			continue;
+
+		link = link_window[j];
+		if (link != LINK_NONE)
+			++SAR_LINK[link].lost;
+	}
+
+	for (i = 0; i < LINK_NUM; ++i)
+	{
+		if (SAR_LINK[i].sent == 0)
+			continue;
+
+		if (SAR_LINK[i].lost > SAR_LINK[i].sent)
+			SAR_LINK[i].lost = SAR_LINK[i].sent;
+		sample = (SAR_LINK[i].lost * LINK_LOSS_ONE) / SAR_LINK[i].sent;
+		sample = SAR_LINK[i].loss + ((sample - (int16_t)SAR_LINK[i].loss) >> LINK_LOSS_SHIFT);
+		if (sample < 0)
+			sample = 0;
+		if (sample > LINK_LOSS_MAX)
+			sample = LINK_LOSS_MAX;
+		SAR_LINK[i].loss = sample;
+
+		printf("Debug: --- --- --- --- Link %d: sent = %d, lost = %d, loss = %d/256\n", i, SAR_LINK[i].sent, SAR_LINK[i].lost, SAR_LINK[i].loss);
+	}
+
+	// Only re-sent packets are counted at the next CHECK
+	link_window_start(link_window_sess, link_window_base);
+}
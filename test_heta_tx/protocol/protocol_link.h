@@ -0,0 +1,348 @@
+/*
+ * protocol_link.h
+ *
+ * Multi-link transport below the SAR protocol: AT86RF212 on SPI0 and
+ * BP3596 (ML7396) on SPI1.
+ */
+
+#ifndef PROTOCOL_PROTOCOL_LINK_H_
+#define PROTOCOL_PROTOCOL_LINK_H_
+
+#include <stdint.h>
+
+
+// *******************************************************************************************
+// Links
+#define LINK_AT86RF212			(0)		// SPI0, AT86RF212
+#define LINK_ML7396				(1)		// SPI1, BP3596 (ML7396)
+#define LINK_NUM				(2)
+#define LINK_NONE				(0xFF)	// packet was not sent since the last CHECK
+#define LINK_WINDOW_MAX			(RECV_PACKET_TAB_MAX << 3)	// packets per CHECK
+
+// Session link mode
+#define LINK_MODE_SINGLE		(0)		// all messages on AT86RF212
+#define LINK_MODE_STRIPE		(1)		// SEND packets are striped over all enabled links
+#define LINK_MODE_ML7396		(2)		// all messages on ML7396, SCPL_ML7396 bytes/packet
+
+#if SAR_USED_ML7396 == 2
+#define LINK_MODE_DEFAULT		LINK_MODE_ML7396
+#elif SAR_USED_ML7396 == 1
+#define LINK_MODE_DEFAULT		LINK_MODE_STRIPE
+#else
+#define LINK_MODE_DEFAULT		LINK_MODE_SINGLE
+#endif
+
+// Airtime of each link, used to weight the striping
+#define LINK_AT86RF212_OCT_US	(16)	// us/octet, OQPSK-SIN-500 (DEFAULT_PHY_MODE)
+#define LINK_ML7396_OCT_US		(80)	// us/octet, 100 kbps GFSK
+#define LINK_PHY_OVERHEAD		(8)		// preamble + SFD + PHR octets
+#define LINK_ML7396_MHR_LEN		(6)		// frame control + destination + source address
+										// (PAN ID compressed, sequence number suppressed)
+
+// Packet length of a session
+#define LINK_SCPL(link_mode)	(((link_mode) == LINK_MODE_ML7396) ? SCPL_ML7396 : SCPL)
+
+// Loss ratio of each link, Q8
+#define LINK_LOSS_ONE			(256)	// 100 %
+#define LINK_LOSS_MAX			(240)	// keep a bad link slightly used so that it is still probed
+#define LINK_LOSS_SHIFT			(2)		// EWMA: loss += (sample - loss) / 4
+
+// Event loop (utils/reactor.h): the IRQ of AT86RF212 and the received packets of ML7396
+// wake the loop up, the links are polled every LINK_POLL_US if the ISR cannot be set up
+#define LINK_POLL_US			(100)	// us
+#define LINK_INPUT_MAX			(4)		// handlers of the received messages (sessions, relay)
+
+
+// *******************************************************************************************
+// -------- Link information --------
+typedef struct link_t {
+	uint8_t		enable;				// the radio is powered and initialized
+	uint16_t	oct_us;				// duration of one octet (us)
+	uint16_t	loss;				// smoothed loss ratio (Q8)
+	uint32_t	busy;				// virtual finish time of the last packet striped on this link (us)
+	uint16_t	sent;				// packets sent since the last CHECK
+	uint16_t	lost;				// packets reported lost by the last CHECK
+	uint64_t	rx_end;				// end of the packet being received (reactor_now()), 0: none
+} link_t;
+
+extern link_t SAR_LINK[LINK_NUM];
+
+// Handler of a received message, true if it is taken (the next handlers do not see it)
+typedef uint8_t (*link_input_cb)(void *arg, uint8_t *msg_recv, uint8_t link_recv);
+
+
+// =========================================================================================================================================
+// *******************************************************************************************
+// Function:
+//		void link_init(uint16_t src_addr)
+//
+// Description:
+//		Initialize all links. AT86RF212 must be already initialized by at86rfx_init(),
+//		the BP3596 is powered and put in continuous receive mode if SAR_USED_ML7396 is not 0.
+//		The IRQ of both radios wakes up the event loop
+//
+// Parameters:
+//		src_addr	- Address of this node (used by the ML7396 address filter)
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void link_init(uint16_t src_addr);
+
+
+// *******************************************************************************************
+// Function:
+//		uint32_t link_airtime(uint8_t link, uint16_t msg_length)
+//
+// Description:
+//		Airtime of a message on one link, with the PHY header and the FCS
+//
+// Parameters:
+//		link		- LINK_AT86RF212 or LINK_ML7396
+//		msg_length	- Length returned by generate_command()
+//
+// Return:
+//		Airtime (us)
+//
+// *******************************************************************************************
+uint32_t link_airtime(uint8_t link, uint16_t msg_length);
+
+
+// *******************************************************************************************
+// Function:
+//		void link_tx_frame(uint8_t link, uint8_t *msg, uint16_t msg_length)
+//
+// Description:
+//		Send a message generated by generate_command() on one link and take its airtime
+//		from the budget of the link and of its session (protocol_airtime.h). It does not
+//		wait for the budget, a SEND packet is sent once link_wait() is 0
+//
+// Parameters:
+//		link		- LINK_AT86RF212 or LINK_ML7396
+//		msg			- Full message, msg[0] is the PHY length
+//		msg_length	- Length returned by generate_command()
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void link_tx_frame(uint8_t link, uint8_t *msg, uint16_t msg_length);
+
+
+// *******************************************************************************************
+// Function:
+//		void link_flush(void)
+//
+// Description:
+//		Wait until every link has finished its pending transmission
+//
+// Parameters:
+//		None
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void link_flush(void);
+
+
+// *******************************************************************************************
+// Function:
+//		uint8_t link_idle(void)
+//
+// Description:
+//		No link has a pending transmission, a command or CHECK is sent once the SEND
+//		packets striped before it are on air
+//
+// Parameters:
+//		None
+//
+// Return:
+//		true: all links are idle
+//
+// *******************************************************************************************
+uint8_t link_idle(void);
+
+
+// *******************************************************************************************
+// Function:
+//		uint32_t link_wait(uint8_t link_mode, uint16_t dest_addr, uint8_t sess_id, uint16_t msg_length)
+//
+// Description:
+//		Time before a SEND packet of a session can go on air: the airtime budget of the link
+//		and of the session, and a free ML7396 buffer (one is kept for the commands). With
+//		LINK_MODE_STRIPE, the first link which is free
+//
+// Parameters:
+//		link_mode	- Session link mode
+//		dest_addr	- Destination address of the session
+//		sess_id		- Session ID
+//		msg_length	- Length returned by generate_command()
+//
+// Return:
+//		Wait (us), 0: the packet can be sent now
+//
+// *******************************************************************************************
+uint32_t link_wait(uint8_t link_mode, uint16_t dest_addr, uint8_t sess_id, uint16_t msg_length);
+
+
+// *******************************************************************************************
+// Function:
+//		uint16_t link_rx_frame(uint8_t *msg_recv, uint8_t *link)
+//
+// Description:
+//		Poll all links for a received message. When SAR_USED_ROUTE is 1, BEACON is
+//		given to route_input() and BEACON of this node is sent by route_poll()
+//
+// Parameters:
+//		msg_recv	- Full receive message (without the PHY length)
+//		link		- Link on which the message is received
+//
+// Return:
+//		Length of the message, 0 if nothing is received
+//
+// *******************************************************************************************
+uint16_t link_rx_frame(uint8_t *msg_recv, uint8_t *link);
+
+
+// *******************************************************************************************
+// Function:
+//		int8_t link_input_add(link_input_cb cb, void *arg)
+//
+// Description:
+//		Add a handler of the received messages. The links are read by a source of the
+//		event loop (utils/reactor.h) while there is a handler, each message is given to
+//		the handlers in the order they were added until one takes it
+//
+// Parameters:
+//		cb			- Handler
+//		arg			- Argument of the handler
+//
+// Return:
+//		Entry of the handler, -1 if the table is full
+//
+// *******************************************************************************************
+int8_t link_input_add(link_input_cb cb, void *arg);
+
+
+// *******************************************************************************************
+// Function:
+//		void link_input_remove(int8_t entry)
+//
+// Description:
+//		Remove a handler added by link_input_add()
+//
+// Parameters:
+//		entry		- Entry returned by link_input_add()
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void link_input_remove(int8_t entry);
+
+
+// *******************************************************************************************
+// Function:
+//		uint64_t link_rx_wait(uint8_t link_mode, uint64_t when)
+//
+// Description:
+//		Time at which a message of the session can be sent without cutting the packet
+//		which is still being received. The ML7396 reports a large packet at each RX
+//		FIFO watermark (opt.rx.progress), so its end is known before it is complete.
+//		Only LINK_MODE_ML7396 waits: striped packets can still go on AT86RF212
+//
+// Parameters:
+//		link_mode	- Session link mode
+//		when		- Time at which the session would send (reactor_now())
+//
+// Return:
+//		when, or the end of the packet on air if it is later
+//
+// *******************************************************************************************
+uint64_t link_rx_wait(uint8_t link_mode, uint64_t when);
+
+
+// *******************************************************************************************
+// Function:
+//		void link_window_start(uint8_t sess_id, uint16_t pktid_start)
+//
+// Description:
+//		Restart the striping for a new window of SEND packets
+//
+// Parameters:
+//		sess_id		- Session ID of the window
+//		pktid_start	- First packet ID of the window (packet ID start of the next CHECK)
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void link_window_start(uint8_t sess_id, uint16_t pktid_start);
+
+
+// *******************************************************************************************
+// Function:
+//		uint8_t link_send_data(uint8_t link_mode, uint16_t pktid, uint8_t *msg, uint16_t msg_length)
+//
+// Description:
+//		Send a SEND packet on the link on which it would finish first, the airtime of
+//		each link is inflated by its loss ratio. Only the links on which it can go now
+//		(link_wait()) are used
+//
+// Parameters:
+//		link_mode	- Session link mode
+//		pktid		- Packet ID
+//		msg			- Full message
+//		msg_length	- Length returned by generate_command()
+//
+// Return:
+//		Link on which the packet is sent
+//
+// *******************************************************************************************
+uint8_t link_send_data(uint8_t link_mode, uint16_t pktid, uint8_t *msg, uint16_t msg_length);
+
+
+// *******************************************************************************************
+// Function:
+//		uint8_t link_resend_data(uint8_t link_mode, uint16_t pktid, uint8_t *msg, uint16_t msg_length)
+//
+// Description:
+//		Re-send a lost packet on the healthiest link
+//
+// Parameters:
+//		link_mode	- Session link mode
+//		pktid		- Packet ID
+//		msg			- Full message
+//		msg_length	- Length returned by generate_command()
+//
+// Return:
+//		Link on which the packet is sent
+//
+// *******************************************************************************************
+uint8_t link_resend_data(uint8_t link_mode, uint16_t pktid, uint8_t *msg, uint16_t msg_length);
+
+
+// *******************************************************************************************
+// Function:
+//		void link_update_loss(uint8_t sess_id, uint16_t pktid_update, uint16_t length, uint8_t *table)
+//
+// Description:
+//		Update the loss ratio of each link with the received-data-table returned by CHECK.
+//		Nothing is done if the last window was started by another session
+//
+// Parameters:
+//		sess_id			- Session ID of the CHECK
+//		pktid_update	- First packet ID of table
+//		length			- Length of table in byte
+//		table			- Received-data-table, bit = 0: lost packet
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void link_update_loss(uint8_t sess_id, uint16_t pktid_update, uint16_t length, uint8_t *table);
+
+
+#endif /* PROTOCOL_PROTOCOL_LINK_H_ */
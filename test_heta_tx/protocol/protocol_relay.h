@@ -0,0 +1,96 @@
+/*
+ * protocol_relay.h
+ *
+ * Relay node of the SAR protocol: the frame of the previous hop is received by an
+ * RX session and sent to the next hop by a TX session, SEND packets are forwarded
+ * as soon as they arrive. CHECK/RESEND runs on each hop.
+ * The relay runs on the event loop (utils/reactor.h): the messages of both hops come
+ * through a link input handler (protocol_link.h), the next hop is stepped by a timer
+ * at pro_tx_when() and the previous hop is timed out by another timer.
+ */
+
+#ifndef PROTOCOL_PROTOCOL_RELAY_H_
+#define PROTOCOL_PROTOCOL_RELAY_H_
+
+#include <stdint.h>
+#include "../utils/reactor.h"
+
+
+// *******************************************************************************************
+#define RELAY_READY_SIZE		(0x10000 >> 3)	// one bit for each packet ID
+
+// Result of a frame
+#define PRO_RELAY_NONE			(0)		// the frame is being relayed
+#define PRO_RELAY_OK			(1)		// the next hop has the whole frame
+#define PRO_RELAY_FAILED		(2)		// the next hop has given up the frame, ABORT is sent to the previous hop
+#define PRO_RELAY_TIME_OUT		(3)		// no command of the previous hop for SESS_TIME_OUT, the relay is stopped
+
+
+// *******************************************************************************************
+// -------- Relay information --------
+typedef struct relay_t {
+	sess_t		SESS_UP;			// session with the previous hop, this node is RX
+	sess_t		SESS_DOWN;			// session with the next hop, this node is TX
+	pro_rx_t	UP;
+	pro_tx_t	DOWN;
+	uint16_t	up_addr;			// previous hop, SESS_ADDR_ANY: the node which sends PING
+	uint16_t	window_size;		// window of the next hop, SESS_DOWN.window_size is cut at the last window
+	uint8_t		down_open;			// the session with the next hop is started
+	reactor_timer_t	TIMER;			// next step of the next hop (gap, airtime, RTO)
+	reactor_timer_t	IDLE;			// time-out of the previous hop
+	reactor_timer_t	UP_ACK;			// CHECK ACK sent to the previous hop on its own
+	int8_t		input;				// entry of the link input handler, -1: the relay is stopped
+	uint8_t		result;				// PRO_RELAY_* of the last frame
+	msg_t		UP_ABORT;			// session of the previous hop given up by PRO_RELAY_FAILED
+	uint8_t		up_abort;			// each command of UP_ABORT is answered by ABORT
+	uint8_t		up_abort_link;		// link of UP_ABORT
+	uint8_t		ready[RELAY_READY_SIZE];	// packets received from the previous hop
+} relay_t;
+
+
+// =========================================================================================================================================
+// *******************************************************************************************
+// Function:
+//		void pro_relay_init(relay_t *RELAY, uint16_t src_addr, uint16_t up_addr, uint16_t down_addr, uint8_t *frame_data)
+//
+// Description:
+//		Initialize the relay, the frame of both sessions is stored in frame_data
+//
+// Parameters:
+//		RELAY		- Relay information
+//		src_addr	- Address of this node
+//		up_addr		- Address of the previous hop, SESS_ADDR_ANY for any node
+//		down_addr	- Address of the next hop, replaced by route_next_hop() if SAR_USED_ROUTE is 1
+//		frame_data	- Frame buffer, large enough for the frames of the previous hop
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void pro_relay_init(relay_t *RELAY, uint16_t src_addr, uint16_t up_addr, uint16_t down_addr, uint8_t *frame_data);
+
+
+// *******************************************************************************************
+// Function:
+//		uint8_t pro_relay(relay_t *RELAY)
+//
+// Description:
+//		Relay one frame: acknowledge the previous hop and forward each new SEND packet
+//		to the next hop. A new frame of the previous hop is only accepted when the
+//		next hop has received the whole frame, or has given it up: then the session of
+//		the previous hop is given up too (ABORT as an ACK, pro_rx_abort()). The relay is
+//		started on the event loop at the first call, the loop runs until the frame is over,
+//		then the relay waits for the next frame on the loop of the application
+//
+// Parameters:
+//		RELAY		- Relay information, RELAY->window_size and RELAY->SESS_DOWN.tx_delay
+//					  can be changed before each frame
+//
+// Return:
+//		PRO_RELAY_OK, PRO_RELAY_FAILED, or PRO_RELAY_TIME_OUT when the relay is stopped
+//
+// *******************************************************************************************
+uint8_t pro_relay(relay_t *RELAY);
+
+
+#endif /* PROTOCOL_PROTOCOL_RELAY_H_ */
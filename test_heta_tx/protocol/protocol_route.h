@@ -0,0 +1,151 @@
+/*
+ * protocol_route.h
+ *
+ * Neighbor discovery and routing to the sink: each node broadcasts BEACON with its
+ * cost to the sink, the neighbor table keeps the delivery ratio of the beacons of each
+ * neighbor, and the next hop is the neighbor with the least expected airtime to the sink.
+ * A neighbor which is held down (protocol_rtt.h) is not a next hop until its hold-down ends.
+ */
+
+#ifndef PROTOCOL_PROTOCOL_ROUTE_H_
+#define PROTOCOL_PROTOCOL_ROUTE_H_
+
+#include <stdint.h>
+
+
+// *******************************************************************************************
+#define ROUTE_NBR_MAX			(16)		// neighbors in the table
+#define ROUTE_ADDR_NONE			(0xFFFF)	// no next hop, also the destination address of BEACON
+#define ROUTE_COST_INF			(0xFFFF)	// no route to the sink
+
+#define ROUTE_BEACON_PERIOD		(1000000)	// us
+#define ROUTE_BEACON_JITTER		(125000)	// us, random part added to each period
+#define ROUTE_NBR_TIMEOUT		(8)			// beacon periods without BEACON before a neighbor is removed
+
+// Delivery ratio of the beacons of a neighbor, Q8
+#define ROUTE_DR_ONE			(256)		// 100 %
+#define ROUTE_DR_MIN			(32)		// a neighbor below 1/8 is not used as next hop
+#define ROUTE_DR_SHIFT			(2)			// EWMA: dr += (sample - dr) / 4
+#define ROUTE_HYSTERESIS		(3)			// a new next hop must be better by 1/8 of the cost
+
+
+// *******************************************************************************************
+// -------- Neighbor information --------
+typedef struct route_nbr_t {
+	uint16_t	addr;				// address of the neighbor
+	uint8_t		link;				// link on which BEACON is received
+	uint8_t		seq;				// sequence number of the last BEACON
+	uint8_t		missed;				// beacon periods since the last BEACON
+	uint16_t	dr;					// delivery ratio of BEACON (Q8), loss rate = 1 - dr
+	uint16_t	link_cost;			// expected airtime of one packet to this neighbor (us)
+	uint16_t	cost;				// cost of the neighbor to the sink, from its BEACON
+	uint16_t	parent;				// next hop of the neighbor, from its BEACON
+} route_nbr_t;
+
+// -------- Routing information --------
+typedef struct route_t {
+	uint16_t	src_addr;			// address of this node
+	uint16_t	sink_addr;			// address of the sink
+	uint16_t	parent;				// next hop to the sink, ROUTE_ADDR_NONE if unknown
+	uint16_t	cost;				// cost to the sink through parent (us)
+	uint8_t		seq;				// sequence number of the next BEACON
+	uint8_t		nbr_num;
+	route_nbr_t	nbr[ROUTE_NBR_MAX];
+} route_t;
+
+extern route_t SAR_ROUTE;
+
+
+// =========================================================================================================================================
+// *******************************************************************************************
+// Function:
+//		void route_init(uint16_t src_addr, uint16_t sink_addr)
+//
+// Description:
+//		Clear the neighbor table, the sink has cost 0. link_init() must be already called
+//
+// Parameters:
+//		src_addr	- Address of this node
+//		sink_addr	- Address of the sink
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void route_init(uint16_t src_addr, uint16_t sink_addr);
+
+
+// *******************************************************************************************
+// Function:
+//		void route_poll(void)
+//
+// Description:
+//		Send BEACON and age the neighbors at each beacon period.
+//		Called by link_rx_frame() when SAR_USED_ROUTE is 1
+//
+// Parameters:
+//		None
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void route_poll(void);
+
+
+// *******************************************************************************************
+// Function:
+//		void route_input(uint8_t *msg_recv, uint8_t link)
+//
+// Description:
+//		Update the neighbor of a received BEACON, the route is only recomputed
+//		through this neighbor unless it is the next hop
+//
+// Parameters:
+//		msg_recv	- Full receive message
+//		link		- Link on which the message is received
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void route_input(uint8_t *msg_recv, uint8_t link);
+
+
+// *******************************************************************************************
+// Function:
+//		uint16_t route_next_hop(void)
+//
+// Description:
+//		Next hop to the sink
+//
+// Parameters:
+//		None
+//
+// Return:
+//		Address of the next hop, ROUTE_ADDR_NONE if there is no route yet
+//
+// *******************************************************************************************
+uint16_t route_next_hop(void);
+
+
+// *******************************************************************************************
+// Function:
+//		void route_invalidate(uint16_t addr)
+//
+// Description:
+//		A neighbor is unreachable and held down (rtt_unreachable()): if it is the next hop,
+//		the route is recomputed over the other neighbors. It is taken again by a BEACON
+//		after the end of its hold-down
+//
+// Parameters:
+//		addr		- Address of the neighbor
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void route_invalidate(uint16_t addr);
+
+
+#endif /* PROTOCOL_PROTOCOL_ROUTE_H_ */
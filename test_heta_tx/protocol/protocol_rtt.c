@@ -0,0 +1,180 @@
+#include "../at86rf212_param.h"
+#include "../utils/reactor.h"
+#include "protocol.h"
+#include "protocol_rtt.h"
+
+
+rtt_peer_t SAR_RTT[RTT_PEER_MAX];
+
+static uint8_t rtt_next;			// entry taken by the next new peer when the table is full
+
+
+// ===========================================================
+//
+// Entry of a peer, a new one if it is not in the table
+//
+// ===========================================================
+static rtt_peer_t* rtt_peer(uint16_t addr)
+{
+	uint8_t i;
+	rtt_peer_t *PEER;
+
+	for (i = 0; i < RTT_PEER_MAX; ++i)
+		if ((SAR_RTT[i].used == true) && (SAR_RTT[i].addr == addr))
+			return &SAR_RTT[i];
+
+	// A free entry, or the oldest one
+	for (i = 0; i < RTT_PEER_MAX; ++i)
+		if (SAR_RTT[i].used == false)
+			break;
+	if (i == RTT_PEER_MAX)
+	{
+		i = rtt_next;
+		rtt_next = (rtt_next + 1) % RTT_PEER_MAX;
+	}
+
+	PEER = &SAR_RTT[i];
+	PEER->used = true;
+	PEER->valid = false;
+	PEER->addr = addr;
+	PEER->srtt = 0;
+	PEER->rttvar = 0;
+	PEER->rto = RTT_RTO_INIT;
+	PEER->fail = 0;
+	PEER->down_until = 0;
+	PEER->assoc = false;
+	return PEER;
+}
+
+
+// ===========================================================
+//
+// Time-out of a command
+//
+// ===========================================================
+uint32_t rtt_rto(uint16_t addr)
+{
+	return rtt_peer(addr)->rto;
+}
+
+
+// ===========================================================
+//
+// Update the RTT of a peer
+//
+// ===========================================================
+void rtt_sample(uint16_t addr, uint32_t rtt)
+{
+	rtt_peer_t *PEER;
+	uint32_t delta, rto;
+
+	PEER = rtt_peer(addr);
+	if (PEER->valid == false)
+	{
+		// First sample
+		PEER->srtt = rtt;
+		PEER->rttvar = rtt >> 1;
+		PEER->valid = true;
+	}
+	else
+	{
+		// The variation is updated with the previous smoothed RTT
+		delta = (rtt > PEER->srtt) ? (rtt - PEER->srtt) : (PEER->srtt - rtt);
+		PEER->rttvar = PEER->rttvar - (PEER->rttvar >> RTT_RTTVAR_SHIFT) + (delta >> RTT_RTTVAR_SHIFT);
+		PEER->srtt = PEER->srtt - (PEER->srtt >> RTT_SRTT_SHIFT) + (rtt >> RTT_SRTT_SHIFT);
+	}
+
+	rto = PEER->srtt + (RTT_RTTVAR_MUL * PEER->rttvar);
+	if (rto < RTT_RTO_MIN)
+		rto = RTT_RTO_MIN;
+	if (rto > RTT_RTO_MAX)
+		rto = RTT_RTO_MAX;
+	PEER->rto = rto;
+}
+
+
+// ===========================================================
+//
+// The time-out of a peer is reached
+//
+// ===========================================================
+void rtt_backoff(uint16_t addr)
+{
+	rtt_peer_t *PEER;
+
+	PEER = rtt_peer(addr);
+	PEER->rto <<= 1;
+	if (PEER->rto > RTT_RTO_MAX)
+		PEER->rto = RTT_RTO_MAX;
+	printf("Debug: --- --- --- --- Time-out of 0x%04x, RTO = %d us\n", addr, PEER->rto);
+}
+
+
+// ===========================================================
+//
+// The peer is unreachable, hold it down
+//
+// ===========================================================
+void rtt_unreachable(uint16_t addr)
+{
+	rtt_peer_t *PEER;
+	uint64_t hold;
+
+	PEER = rtt_peer(addr);
+	if (PEER->fail < 31)
+		++PEER->fail;
+	hold = (uint64_t)RTT_DOWN_MIN << (PEER->fail - 1);
+	if (hold > RTT_DOWN_MAX)
+		hold = RTT_DOWN_MAX;
+	PEER->down_until = reactor_now() + hold;
+	PEER->assoc = false;
+	printf("Info: --- --- 0x%04x is unreachable, no session for %d ms\n", addr, (int)(hold / 1000));
+}
+
+
+// ===========================================================
+//
+// An ACK of the peer is received
+//
+// ===========================================================
+void rtt_reachable(uint16_t addr)
+{
+	rtt_peer_t *PEER;
+
+	PEER = rtt_peer(addr);
+	PEER->fail = 0;
+	PEER->down_until = 0;
+}
+
+
+// ===========================================================
+//
+// The peer is held down
+//
+// ===========================================================
+uint8_t rtt_down(uint16_t addr)
+{
+	return (reactor_now() < rtt_peer(addr)->down_until) ? true : false;
+}
+
+
+// ===========================================================
+//
+// Set up or close the association with the peer
+//
+// ===========================================================
+void rtt_assoc_set(uint16_t addr, uint8_t assoc)
+{
+	rtt_peer(addr)->assoc = assoc;
+}
+
+
+// ===========================================================
+//
+// The association with the peer is set up
+//
+// ===========================================================
+uint8_t rtt_assoc(uint16_t addr)
+{
+	return rtt_peer(addr)->assoc;
+}
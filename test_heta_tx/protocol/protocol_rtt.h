@@ -0,0 +1,192 @@
+/*
+ * protocol_rtt.h
+ *
+ * Round-trip time of the command/ACK exchanges of each peer, measured with the
+ * monotonic clock of the event loop (utils/reactor.h): smoothed RTT and RTT variation (Jacobson/Karels), and the
+ * time-out after which a command is sent again. The table also keeps the association of
+ * SAR_USED_OBJECT with each peer.
+ */
+
+#ifndef PROTOCOL_PROTOCOL_RTT_H_
+#define PROTOCOL_PROTOCOL_RTT_H_
+
+#include <stdint.h>
+
+
+// *******************************************************************************************
+#define RTT_PEER_MAX			(8)			// peers in the table, the oldest entry is taken for a new peer
+
+#define RTT_RTO_INIT			(100000)	// us, before the first sample of a peer
+#define RTT_RTO_MIN				(10000)		// us
+#define RTT_RTO_MAX				(250000)	// us, also the limit of the backoff: the radio loses packets
+													// without congestion, a longer wait only delays the frame
+#define RTT_SRTT_SHIFT			(3)			// EWMA: srtt += (sample - srtt) / 8
+#define RTT_RTTVAR_SHIFT		(2)			// EWMA: rttvar += (|sample - srtt| - rttvar) / 4
+#define RTT_RTTVAR_MUL			(4)			// rto = srtt + 4 * rttvar
+
+#define RTT_DOWN_MIN			(1000000)	// us, a peer is held down after it is unreachable, no session is started
+#define RTT_DOWN_MAX			(32000000)	// us, the hold-down is doubled each time the peer is unreachable again
+
+
+// *******************************************************************************************
+// -------- RTT of a peer --------
+typedef struct rtt_peer_t {
+	uint8_t		used;
+	uint8_t		valid;				// srtt and rttvar have a sample
+	uint16_t	addr;				// address of the peer
+	uint32_t	srtt;				// smoothed RTT (us)
+	uint32_t	rttvar;				// RTT variation (us)
+	uint32_t	rto;				// time-out of a command (us), doubled each time it is reached
+	uint8_t		fail;				// times the peer is unreachable since its last ACK
+	uint64_t	down_until;			// monotonic time (us) of the end of the hold-down
+	uint8_t		assoc;				// the association is set up (SAR_USED_OBJECT), the objects need no SETUP
+} rtt_peer_t;
+
+extern rtt_peer_t SAR_RTT[RTT_PEER_MAX];
+
+
+// =========================================================================================================================================
+// *******************************************************************************************
+// Function:
+//		uint32_t rtt_rto(uint16_t addr)
+//
+// Description:
+//		Time-out of a command sent to a peer, RTT_RTO_INIT before its first sample
+//
+// Parameters:
+//		addr		- Address of the peer
+//
+// Return:
+//		Time-out (us)
+//
+// *******************************************************************************************
+uint32_t rtt_rto(uint16_t addr);
+
+
+// *******************************************************************************************
+// Function:
+//		void rtt_sample(uint16_t addr, uint32_t rtt)
+//
+// Description:
+//		Update the smoothed RTT, the RTT variation and the time-out of a peer with the time
+//		between a command and its ACK. A command which is sent again gives no sample,
+//		its ACK may be the one of the first command (Karn)
+//
+// Parameters:
+//		addr		- Address of the peer
+//		rtt			- Round-trip time (us)
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void rtt_sample(uint16_t addr, uint32_t rtt);
+
+
+// *******************************************************************************************
+// Function:
+//		void rtt_backoff(uint16_t addr)
+//
+// Description:
+//		Double the time-out of a peer when it is reached, up to RTT_RTO_MAX,
+//		until the next sample
+//
+// Parameters:
+//		addr		- Address of the peer
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void rtt_backoff(uint16_t addr);
+
+
+// *******************************************************************************************
+// Function:
+//		void rtt_unreachable(uint16_t addr)
+//
+// Description:
+//		A session to the peer has no ACK for its setup time-out: the peer is held down for
+//		RTT_DOWN_MIN, doubled each time up to RTT_DOWN_MAX, until it sends an ACK
+//
+// Parameters:
+//		addr		- Address of the peer
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void rtt_unreachable(uint16_t addr);
+
+
+// *******************************************************************************************
+// Function:
+//		void rtt_reachable(uint16_t addr)
+//
+// Description:
+//		An ACK of the peer is received, its hold-down is cleared
+//
+// Parameters:
+//		addr		- Address of the peer
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void rtt_reachable(uint16_t addr);
+
+
+// *******************************************************************************************
+// Function:
+//		uint8_t rtt_down(uint16_t addr)
+//
+// Description:
+//		Check whether the peer is held down
+//
+// Parameters:
+//		addr		- Address of the peer
+//
+// Return:
+//		true until the end of the hold-down
+//
+// *******************************************************************************************
+uint8_t rtt_down(uint16_t addr);
+
+
+// *******************************************************************************************
+// Function:
+//		void rtt_assoc_set(uint16_t addr, uint8_t assoc)
+//
+// Description:
+//		Set up (SETUP ACK) or close (failed session, ABORT) the association with the peer
+//		(SAR_USED_OBJECT), it is also closed when the peer is unreachable or its entry is taken
+//
+// Parameters:
+//		addr		- Address of the peer
+//		assoc		- true: set up, false: closed
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void rtt_assoc_set(uint16_t addr, uint8_t assoc);
+
+
+// *******************************************************************************************
+// Function:
+//		uint8_t rtt_assoc(uint16_t addr)
+//
+// Description:
+//		Check whether the association with the peer is set up
+//
+// Parameters:
+//		addr		- Address of the peer
+//
+// Return:
+//		true if the objects are sent without SETUP
+//
+// *******************************************************************************************
+uint8_t rtt_assoc(uint16_t addr);
+
+
+#endif /* PROTOCOL_PROTOCOL_RTT_H_ */
@@ -0,0 +1,681 @@
+#include <pthread.h>
+#include "../at86rf212_param.h"
+#include "../tal/tal_at86rf212.h"
+#include "../tal/tal_at86rf212_trx.h"
+#include "../hal/hal_at86rf212_trx_access.h"
+#include "../mydebug/mydebug.h"
+#include "../utils/reactor.h"
+#include "../utils/spsc_queue.h"
+#include "protocol.h"
+#include "protocol_link.h"
+#include "protocol_rtt.h"
+#include "protocol_sess.h"
+
+
+static pro_tx_t SESS_TX[SESS_TABLE_MAX];
+static uint8_t sess_tx_used[SESS_TABLE_MAX];
+static reactor_timer_t sess_tx_timer[SESS_TABLE_MAX];	// next step of each TX session (gap, airtime, RTO)
+static uint8_t sess_tx_ready[SESS_TABLE_MAX];			// the next step can be run
+static uint64_t sess_tx_ready_us[SESS_TABLE_MAX];		// monotonic time the session became ready
+static int8_t sess_tx_burst = -1;						// entry in the middle of a window, the others wait
+static pro_sess_tx_end_cb sess_tx_end;
+
+// Sessions submitted by other threads, the lock keeps the producers apart
+static void *sess_tx_slot[SESS_QUEUE_MAX];
+static spsc_queue_t sess_tx_queue = { sess_tx_slot, SESS_QUEUE_MAX - 1, 0, 0 };
+static pthread_mutex_t sess_tx_lock = PTHREAD_MUTEX_INITIALIZER;
+static sess_t *sess_tx_pending;				// taken from the queue, waits for a free entry
+static uint8_t sess_stop;					// pro_sess_stop() is called
+
+static pro_rx_t SESS_RX[SESS_TABLE_MAX];
+static uint8_t sess_rx_used[SESS_TABLE_MAX];
+static uint8_t sess_rx_any[SESS_TABLE_MAX];		// the entry was opened with SESS_ADDR_ANY
+static reactor_timer_t sess_rx_timer[SESS_TABLE_MAX];	// time-out of each RX session
+static uint64_t sess_rx_time;					// the RX time-outs are counted up to this time
+static pro_sess_end_cb sess_rx_end;
+
+
+static void pro_sess_tx_timer(void *arg);
+static void pro_sess_rx_timer(void *arg);
+
+
+// *********************************************************************************************************************************
+// ===========================================================
+//
+// Add a TX session
+//
+// ===========================================================
+int8_t pro_sess_tx_open(sess_t *SESSION)
+{
+	uint8_t i;
+
+	for (i = 0; i < SESS_TABLE_MAX; ++i)
+	{
+		if (sess_tx_used[i] == false)
+		{
+			sess_tx_used[i] = true;
+			pro_tx_init(&SESS_TX[i], SESSION);
+			reactor_timer_init(&sess_tx_timer[i], pro_sess_tx_timer, &SESS_TX[i]);
+			sess_tx_ready[i] = true;
+			sess_tx_ready_us[i] = reactor_now();
+			printf("Debug: --- --- Session %d: 0x%04x -> 0x%04x, entry %d, class %d\n", SESSION->sess_id, SESSION->src_addr, SESSION->dest_addr, i, SESSION->tx_class);
+			return i;
+		}
+	}
+
+	printf("Info: --- --- Session table is full\n");
+	return -1;
+}
+
+
+// ===========================================================
+//
+// Find the TX session of an ACK
+//
+// ===========================================================
+static pro_tx_t *pro_sess_tx_find(uint8_t *msg_recv)
+{
+	uint8_t i;
+	uint16_t src_addr_recv, dest_addr_recv;
+	sess_t *SESSION;
+
+	src_addr_recv = (msg_recv[1] << 8) + msg_recv[2];
+	dest_addr_recv = (msg_recv[3] << 8) + msg_recv[4];
+
+	for (i = 0; i < SESS_TABLE_MAX; ++i)
+	{
+		if (sess_tx_used[i] == false)
+			continue;
+
+		SESSION = SESS_TX[i].SESSION;
+		if ((SESSION->dest_addr == src_addr_recv) &&
+			(SESSION->src_addr == dest_addr_recv) &&
+			(SESSION->sess_id == msg_recv[CSIDP]))
+			return &SESS_TX[i];
+	}
+	return NULL;
+}
+
+
+// ===========================================================
+//
+// The next step of a TX session can be run
+//
+// ===========================================================
+static void pro_sess_tx_ready(uint8_t i)
+{
+	if (sess_tx_ready[i] == true)
+		return;
+	sess_tx_ready[i] = true;
+	sess_tx_ready_us[i] = reactor_now();
+}
+
+
+// ===========================================================
+//
+// Schedule the next step of a TX session
+//
+// ===========================================================
+static void pro_sess_tx_schedule(pro_tx_t *PTX)
+{
+	uint8_t i;
+	uint64_t when;
+
+	// Ready at the end of the gap, of the airtime wait or of the RTO, otherwise at once
+	// (a session ended by its ACK is closed by its next step)
+	i = PTX - &SESS_TX[0];
+	when = (PTX->PRO_STATE == HALT) ? 0 : pro_tx_when(PTX);
+	if (when == PRO_TX_NEVER)
+		reactor_timer_stop(&sess_tx_timer[i]);
+	else if (when > reactor_now())
+		reactor_timer_start(&sess_tx_timer[i], when);
+	else
+	{
+		reactor_timer_stop(&sess_tx_timer[i]);
+		pro_sess_tx_ready(i);
+	}
+}
+
+
+// ===========================================================
+//
+// Remove a TX session from the table
+//
+// ===========================================================
+static void pro_sess_tx_close(uint8_t i)
+{
+	sess_tx_used[i] = false;
+	reactor_timer_stop(&sess_tx_timer[i]);
+	if (sess_tx_burst == i)
+		sess_tx_burst = -1;
+	if (sess_tx_end != NULL)
+		sess_tx_end(SESS_TX[i].SESSION);
+}
+
+
+// ===========================================================
+//
+// RTO of a TX session
+//
+// ===========================================================
+static void pro_sess_tx_timer(void *arg)
+{
+	pro_sess_tx_ready((pro_tx_t*)arg - &SESS_TX[0]);
+}
+
+
+// ===========================================================
+//
+// Ready TX session to step: the session in the middle of a window,
+// otherwise the lowest class, then the earliest due time, then the longest ready
+//
+// ===========================================================
+static int8_t pro_sess_tx_pick(void)
+{
+	int8_t i, best;
+	uint64_t due, best_due;
+	sess_t *SESSION;
+
+	// The window is not cut by another session, a session of a lower class waits one window at most
+	if (sess_tx_burst >= 0)
+		return (sess_tx_ready[sess_tx_burst] == true) ? sess_tx_burst : -1;
+
+	best = -1;
+	best_due = 0;
+	for (i = 0; i < SESS_TABLE_MAX; ++i)
+	{
+		if ((sess_tx_used[i] == false) || (sess_tx_ready[i] == false))
+			continue;
+
+		SESSION = SESS_TX[i].SESSION;
+		due = (SESSION->due > 0) ? SESSION->due : UINT64_MAX;
+		if ((best < 0) ||
+			(SESSION->tx_class < SESS_TX[best].SESSION->tx_class) ||
+			((SESSION->tx_class == SESS_TX[best].SESSION->tx_class) &&
+			 ((due < best_due) || ((due == best_due) && (sess_tx_ready_us[i] < sess_tx_ready_us[best])))))
+		{
+			best = i;
+			best_due = due;
+		}
+	}
+	return best;
+}
+
+
+// ===========================================================
+//
+// One step of the first ready TX session, one frame at most
+//
+// ===========================================================
+static uint8_t pro_sess_tx_event(void *arg)
+{
+	int8_t i;
+	pro_tx_t *PTX;
+	sess_t *SESSION;
+
+	(void)arg;
+	i = pro_sess_tx_pick();
+	if (i < 0)
+		return false;
+
+	PTX = &SESS_TX[i];
+	SESSION = PTX->SESSION;
+	sess_tx_ready[i] = false;
+
+	pro_tx_tick(PTX);
+	if (PTX->PRO_STATE == HALT)
+	{
+		pro_sess_tx_close(i);
+		return true;
+	}
+
+	// A stale video frame is dropped instead of sent
+	if ((SESSION->tx_class == SESS_CLASS_VIDEO) && (SESSION->due > 0) &&
+		(reactor_now() >= SESSION->due) && (pro_tx_started(PTX) == false))
+	{
+		printf("Info: --- --- Session %d is dropped, its due time is passed\n", SESSION->sess_id);
+		SESSION->status = SESS_STATUS_DROPPED;
+		PTX->PRO_STATE = HALT;
+		pro_sess_tx_close(i);
+		return true;
+	}
+
+	pro_tx_step(PTX);
+	if (PTX->PRO_STATE == HALT)
+	{
+		// Ended or aborted by this step
+		pro_sess_tx_close(i);
+		return true;
+	}
+	sess_tx_burst = (pro_tx_burst(PTX) == true) ? i : -1;
+	pro_sess_tx_schedule(PTX);
+	return true;
+}
+
+
+// ===========================================================
+//
+// Give up a TX session
+//
+// ===========================================================
+int8_t pro_sess_tx_abort(sess_t *SESSION)
+{
+	uint8_t i;
+
+	for (i = 0; i < SESS_TABLE_MAX; ++i)
+	{
+		if ((sess_tx_used[i] == true) && (SESS_TX[i].SESSION == SESSION))
+		{
+			pro_tx_abort(&SESS_TX[i], SESS_STATUS_ABORTED);
+			pro_sess_tx_close(i);
+			return i;
+		}
+	}
+	return -1;
+}
+
+
+// *********************************************************************************************************************************
+// ===========================================================
+//
+// Add an RX session
+//
+// ===========================================================
+int8_t pro_sess_rx_open(sess_t *SESSION)
+{
+	uint8_t i;
+
+	for (i = 0; i < SESS_TABLE_MAX; ++i)
+	{
+		if (sess_rx_used[i] == false)
+		{
+			sess_rx_used[i] = true;
+			sess_rx_any[i] = (SESSION->dest_addr == SESS_ADDR_ANY) ? true : false;
+			pro_rx_init(&SESS_RX[i], SESSION);
+			reactor_timer_init(&sess_rx_timer[i], pro_sess_rx_timer, NULL);
+			return i;
+		}
+	}
+
+	printf("Info: --- --- Session table is full\n");
+	return -1;
+}
+
+
+// ===========================================================
+//
+// Give a message to its RX session
+//
+// ===========================================================
+static int8_t pro_sess_rx_input(uint8_t *msg_recv, uint8_t link_recv)
+{
+	uint8_t i, cmd_prefix;
+	uint16_t src_addr_recv, dest_addr_recv;
+	sess_t *SESSION;
+
+	for (i = 0; i < SESS_TABLE_MAX; ++i)
+		if ((sess_rx_used[i] == true) && (pro_rx_input(&SESS_RX[i], &msg_recv[0], link_recv) == true))
+			return i;
+
+	// PING, SETUP or an object header of a new node, or a re-sent END of the last session of a node
+	cmd_prefix = msg_recv[0] & (ISACK_PREFIX | CMD_PREFIX_MASK);
+	if ((cmd_prefix != PING) && (cmd_prefix != SETUP) && (cmd_prefix != END) && (OBJECT_HEADER_MSG(msg_recv) == false))
+		return -1;
+
+	src_addr_recv = (msg_recv[1] << 8) + msg_recv[2];
+	dest_addr_recv = (msg_recv[3] << 8) + msg_recv[4];
+	for (i = 0; i < SESS_TABLE_MAX; ++i)
+	{
+		if (sess_rx_used[i] == false)
+			continue;
+
+		SESSION = SESS_RX[i].SESSION;
+		if ((SESSION->dest_addr == SESS_ADDR_ANY) && (SESSION->src_addr == dest_addr_recv))
+		{
+			printf("Debug: --- --- Session from 0x%04x, entry %d\n", src_addr_recv, i);
+			SESSION->dest_addr = src_addr_recv;
+			SESS_RX[i].SAR_MSG.dest_addr = src_addr_recv;
+			pro_rx_input(&SESS_RX[i], &msg_recv[0], link_recv);
+			return i;
+		}
+	}
+	return -1;
+}
+
+
+// ===========================================================
+//
+// Count the time-out of the RX sessions
+//
+// ===========================================================
+static void pro_sess_rx_count(void)
+{
+	uint8_t i;
+	uint32_t elapsed;
+	uint64_t now;
+
+	// System time-out in measured time, each command clears the time-out of its session.
+	// A timed out entry stays at SESS_TIME_OUT while it waits for the others
+	now = reactor_now();
+	elapsed = (uint32_t)(now - sess_rx_time);
+	sess_rx_time = now;
+	for (i = 0; i < SESS_TABLE_MAX; ++i)
+		if ((sess_rx_used[i] == true) && (SESS_RX[i].SESSION->time_out < SESS_TIME_OUT))
+			SESS_RX[i].SESSION->time_out += elapsed;
+}
+
+
+// ===========================================================
+//
+// End of an RX session, the entry waits for the next one or is closed
+//
+// ===========================================================
+static void pro_sess_rx_end(int8_t entry)
+{
+	sess_t *SESSION;
+
+	if ((entry < 0) || (SESS_RX[entry].PRO_STATE != HALT))
+		return;
+
+	SESSION = SESS_RX[entry].SESSION;
+	if ((sess_rx_end != NULL) && (sess_rx_end(SESSION) == true))
+		pro_rx_init(&SESS_RX[entry], SESSION);
+	else
+	{
+		sess_rx_used[entry] = false;
+		reactor_timer_stop(&sess_rx_timer[entry]);
+	}
+}
+
+
+// ===========================================================
+//
+// Close the RX sessions when all of them are timed out, the others are woken up at their
+// time-out or at the CHECK ACK they send on their own
+//
+// ===========================================================
+static void pro_sess_rx_schedule(void)
+{
+	uint8_t i, idle;
+	uint64_t when;
+	sess_t *SESSION;
+
+	// An entry which waits for the next session takes the one which overlaps another
+	// session, it is only closed with the others when no node sends anything
+	idle = true;
+	for (i = 0; i < SESS_TABLE_MAX; ++i)
+		if ((sess_rx_used[i] == true) && (SESS_RX[i].SESSION->time_out < SESS_TIME_OUT))
+			idle = false;
+
+	for (i = 0; i < SESS_TABLE_MAX; ++i)
+	{
+		if (sess_rx_used[i] == false)
+			continue;
+
+		SESSION = SESS_RX[i].SESSION;
+		if (idle == true)
+		{
+			sess_rx_used[i] = false;
+			reactor_timer_stop(&sess_rx_timer[i]);
+		}
+		else if (SESSION->time_out >= SESS_TIME_OUT)
+		{
+			// A session stopped by its node, the entry waits for the next one
+			if (SESS_RX[i].PRO_STATE != PING)
+			{
+				printf("Debug: --- --- Session %d of 0x%04x is timed out, entry %d\n", SESSION->sess_id, SESSION->dest_addr, i);
+				if (sess_rx_any[i] == true)
+					SESSION->dest_addr = SESS_ADDR_ANY;
+				pro_rx_init(&SESS_RX[i], SESSION);
+			}
+			reactor_timer_stop(&sess_rx_timer[i]);
+		}
+		else
+		{
+			when = pro_rx_when(&SESS_RX[i]);
+			if (when > sess_rx_time + (SESS_TIME_OUT - SESSION->time_out))
+				when = sess_rx_time + (SESS_TIME_OUT - SESSION->time_out);
+			reactor_timer_start(&sess_rx_timer[i], when);
+		}
+	}
+}
+
+
+// ===========================================================
+//
+// Time-out or CHECK ACK of an RX session
+//
+// ===========================================================
+static void pro_sess_rx_timer(void *arg)
+{
+	uint8_t i;
+
+	(void)arg;
+	pro_sess_rx_count();
+	for (i = 0; i < SESS_TABLE_MAX; ++i)
+	{
+		if (sess_rx_used[i] == false)
+			continue;
+		pro_rx_tick(&SESS_RX[i]);
+		pro_sess_rx_end(i);
+	}
+	pro_sess_rx_schedule();
+}
+
+
+// *********************************************************************************************************************************
+// ===========================================================
+//
+// Handle one received message (link input handler)
+//
+// ===========================================================
+static uint8_t pro_sess_link_input(void *arg, uint8_t *msg_recv, uint8_t link_recv)
+{
+	int8_t entry;
+	pro_tx_t *PTX;
+
+	(void)arg;
+
+	// ------ ACK of a TX session, its next step is at once ------
+	if ((msg_recv[0] & ISACK_PREFIX) == ISACK_PREFIX)
+	{
+		PTX = pro_sess_tx_find(&msg_recv[0]);
+		if (PTX == NULL)
+			return false;
+		if (pro_tx_recv_ack(PTX, &msg_recv[0]) == true)
+			pro_sess_tx_schedule(PTX);
+		return true;
+	}
+
+	// ------ Command of an RX session ------
+	pro_sess_rx_count();
+	entry = pro_sess_rx_input(&msg_recv[0], link_recv);
+
+#if DEBUG_INFO == 1
+	if (entry < 0)
+		++MYDEBUG.src_dest_addr_session[MYDEBUG.src_dest_addr_index];
+#endif
+
+	// Ending condition
+	pro_sess_rx_end(entry);
+	pro_sess_rx_schedule();
+	return (entry >= 0) ? true : false;
+}
+
+
+// ===========================================================
+//
+// Number of open sessions
+//
+// ===========================================================
+static uint8_t pro_sess_count(uint8_t *used)
+{
+	uint8_t i, n;
+
+	n = 0;
+	for (i = 0; i < SESS_TABLE_MAX; ++i)
+		if (used[i] == true)
+			++n;
+	return n;
+}
+
+
+// ===========================================================
+//
+// Give a TX session to the event loop
+//
+// ===========================================================
+uint8_t pro_sess_tx_submit(sess_t *SESSION)
+{
+	uint8_t queued;
+
+	pthread_mutex_lock(&sess_tx_lock);
+	queued = spsc_push(&sess_tx_queue, SESSION);
+	pthread_mutex_unlock(&sess_tx_lock);
+	if (queued == false)
+	{
+		printf("Info: --- --- Session queue is full\n");
+		return false;
+	}
+
+	reactor_wake();
+	return true;
+}
+
+
+// ===========================================================
+//
+// Open the submitted TX sessions while the table has a free entry
+//
+// ===========================================================
+static uint8_t pro_sess_tx_inject(void *arg)
+{
+	uint8_t opened;
+
+	(void)arg;
+	opened = false;
+	while (pro_sess_count(&sess_tx_used[0]) < SESS_TABLE_MAX)
+	{
+		if (sess_tx_pending == NULL)
+			sess_tx_pending = (sess_t*)spsc_pop(&sess_tx_queue);
+		if (sess_tx_pending == NULL)
+			break;
+
+		pro_sess_tx_open(sess_tx_pending);
+		sess_tx_pending = NULL;
+		opened = true;
+	}
+	return opened;
+}
+
+
+// ===========================================================
+//
+// TX sessions which are open or submitted
+//
+// ===========================================================
+static uint8_t pro_sess_tx_count(void)
+{
+	return pro_sess_count(&sess_tx_used[0]) + ((sess_tx_pending != NULL) ? 1 : 0) + spsc_count(&sess_tx_queue);
+}
+
+
+// ===========================================================
+//
+// Run the event loop until the sessions of one or both tables are ended,
+// and until pro_sess_stop() if serve is true
+//
+// ===========================================================
+static void pro_sess_loop(uint8_t wait_tx, uint8_t wait_rx, uint8_t serve)
+{
+	int8_t source, source_tx, source_in;
+
+	// The received messages first, so that an ACK is handled before a session is stepped
+	reactor_init();
+	source = link_input_add(pro_sess_link_input, NULL);
+	source_in = reactor_source_add(pro_sess_tx_inject, NULL);
+	source_tx = reactor_source_add(pro_sess_tx_event, NULL);
+	if ((source < 0) || (source_in < 0) || (source_tx < 0))
+	{
+		printf("Info: --- --- Too many event sources\n");
+		link_input_remove(source);
+		reactor_source_remove(source_in);
+		reactor_source_remove(source_tx);
+		return;
+	}
+
+	sess_rx_time = reactor_now();
+	pro_sess_rx_schedule();
+	while (((serve == true) && (__atomic_load_n(&sess_stop, __ATOMIC_ACQUIRE) == false)) ||
+		   ((wait_tx == true) && (pro_sess_tx_count() > 0)) ||
+		   ((wait_rx == true) && (pro_sess_count(&sess_rx_used[0]) > 0)))
+		reactor_run_once();
+
+	link_input_remove(source);
+	reactor_source_remove(source_in);
+	reactor_source_remove(source_tx);
+}
+
+
+// ===========================================================
+//
+// Run all TX sessions
+//
+// ===========================================================
+void pro_sess_tx_run(void)
+{
+	sess_tx_end = NULL;
+	pro_sess_loop(true, false, false);
+}
+
+
+// ===========================================================
+//
+// Run all RX sessions
+//
+// ===========================================================
+void pro_sess_rx_run(pro_sess_end_cb sess_end)
+{
+	sess_rx_end = sess_end;
+	pro_sess_loop(false, true, false);
+}
+
+
+// ===========================================================
+//
+// Run all TX and RX sessions
+//
+// ===========================================================
+void pro_sess_run(pro_sess_end_cb sess_end)
+{
+	sess_tx_end = NULL;
+	sess_rx_end = sess_end;
+	pro_sess_loop(true, true, false);
+}
+
+
+// ===========================================================
+//
+// Run all sessions until pro_sess_stop()
+//
+// ===========================================================
+void pro_sess_serve(pro_sess_tx_end_cb tx_end, pro_sess_end_cb rx_end)
+{
+	sess_tx_end = tx_end;
+	sess_rx_end = rx_end;
+	pro_sess_loop(true, true, true);
+	sess_tx_end = NULL;
+	__atomic_store_n(&sess_stop, false, __ATOMIC_RELEASE);
+}
+
+
+// ===========================================================
+//
+// End pro_sess_serve()
+//
+// ===========================================================
+void pro_sess_stop(void)
+{
+	__atomic_store_n(&sess_stop, true, __ATOMIC_RELEASE);
+	reactor_wake();
+}
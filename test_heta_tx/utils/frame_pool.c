@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include "frame_pool.h"
+
+
+// ========================================================
+//
+// Allocate the frames
+//
+// ========================================================
+void frame_pool_init(frame_pool_t *POOL, uint8_t num, uint32_t size)
+{
+	uint8_t i;
+
+	if (num > FRAME_POOL_MAX)
+		num = FRAME_POOL_MAX;
+	POOL->num = num;
+	POOL->size = size;
+	POOL->done = 0;
+
+	spsc_init(&POOL->full, num);
+	spsc_init(&POOL->empty, num);
+	sem_init(&POOL->full_sem, 0, 0);
+	sem_init(&POOL->empty_sem, 0, num);
+
+	for (i = 0; i < num; ++i)
+	{
+		POOL->frame[i].data = NULL;
+		if (size > 0)
+		{
+			POOL->frame[i].data = (uint8_t*) calloc (size, sizeof(uint8_t));
+			if (POOL->frame[i].data == NULL)
+			{
+				printf("Info: --- Not enough memory to store data file ... \n");
+				exit (1);
+			}
+		}
+		POOL->frame[i].length = 0;
+		POOL->frame[i].index = 0;
+		POOL->frame[i].codec = 0;
+		POOL->frame[i].raw_length = 0;
+		POOL->frame[i].time = 0;
+		spsc_push(&POOL->empty, &POOL->frame[i]);
+	}
+}
+
+
+// ========================================================
+//
+// Free the frames
+//
+// ========================================================
+void frame_pool_free(frame_pool_t *POOL)
+{
+	uint8_t i;
+
+	if (POOL->size > 0)
+		for (i = 0; i < POOL->num; ++i)
+			free(POOL->frame[i].data);
+
+	spsc_free(&POOL->full);
+	spsc_free(&POOL->empty);
+	sem_destroy(&POOL->full_sem);
+	sem_destroy(&POOL->empty_sem);
+}
+
+
+// ========================================================
+//
+// Take a free frame (producer)
+//
+// ========================================================
+frame_t* frame_pool_take(frame_pool_t *POOL, uint8_t wait)
+{
+	if (wait)
+	{
+		while (sem_wait(&POOL->empty_sem) != 0)
+			;
+	}
+	else if (sem_trywait(&POOL->empty_sem) != 0)
+		return NULL;
+
+	return (frame_t*) spsc_pop(&POOL->empty);
+}
+
+
+// ========================================================
+//
+// Queue a filled frame (producer)
+//
+// ========================================================
+void frame_pool_give(frame_pool_t *POOL, frame_t *FRAME)
+{
+	spsc_push(&POOL->full, FRAME);
+	sem_post(&POOL->full_sem);
+}
+
+
+// ========================================================
+//
+// No more frame (producer)
+//
+// ========================================================
+void frame_pool_end(frame_pool_t *POOL)
+{
+	__atomic_store_n(&POOL->done, 1, __ATOMIC_RELEASE);
+	sem_post(&POOL->full_sem);
+}
+
+
+// ========================================================
+//
+// Get a filled frame (consumer)
+//
+// ========================================================
+frame_t* frame_pool_get(frame_pool_t *POOL, int32_t time_out)
+{
+	int ret;
+	struct timespec ts;
+	frame_t *FRAME;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += time_out;
+
+	while (1)
+	{
+		// Each frame is posted once, the end is posted once more
+		if (time_out == FRAME_POOL_WAIT)
+			ret = sem_wait(&POOL->full_sem);
+		else if (time_out == 0)
+			ret = sem_trywait(&POOL->full_sem);
+		else
+			ret = sem_timedwait(&POOL->full_sem, &ts);
+
+		if (ret != 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return NULL;
+		}
+
+		FRAME = (frame_t*) spsc_pop(&POOL->full);
+		if (FRAME != NULL)
+			return FRAME;
+
+		// The end stays posted for the next call
+		if (__atomic_load_n(&POOL->done, __ATOMIC_ACQUIRE))
+		{
+			sem_post(&POOL->full_sem);
+			return NULL;
+		}
+	}
+}
+
+
+// ========================================================
+//
+// Give a used frame back (consumer)
+//
+// ========================================================
+void frame_pool_put(frame_pool_t *POOL, frame_t *FRAME)
+{
+	spsc_push(&POOL->empty, FRAME);
+	sem_post(&POOL->empty_sem);
+}
@@ -0,0 +1,115 @@
+/*
+ * pace.h
+ *
+ * Short waits of the radio: the gap between two packets and the SPI/GPIO timings.
+ * usleep() oversleeps by 50-100 us or more, so a wait sleeps with clock_nanosleep()
+ * to an absolute time PACE_SLACK before its end and spins on the monotonic clock for
+ * the rest. The slack and the speed of the nanosecond loop are measured by pace_init().
+ */
+
+#ifndef UTILS_PACE_H_
+#define UTILS_PACE_H_
+
+#include <stdint.h>
+
+
+// *******************************************************************************************
+#define PACE_CALIB_NUM			(32)		// sleeps measured by pace_init()
+#define PACE_CALIB_US			(100)		// us, length of each measured sleep
+#define PACE_CALIB_LOOPS		(1000000)	// iterations of the nanosecond loop which are timed
+#define PACE_SLACK_INIT			(100)		// us spun at the end of a wait before pace_init()
+#define PACE_SLACK_MIN			(10)		// us
+#define PACE_SLACK_MAX			(1000)		// us, a longer oversleep is not spun away
+#define PACE_LOOPS_INIT			(64)		// iterations of the nanosecond loop per us before pace_init()
+
+
+// =========================================================================================================================================
+// *******************************************************************************************
+// Function:
+//		void pace_init(void)
+//
+// Description:
+//		Measure the oversleep of clock_nanosleep() (its 90th percentile becomes the slack)
+//		and the iterations of the nanosecond loop per microsecond. The waits work with
+//		PACE_SLACK_INIT before it is called
+//
+// Parameters:
+//		None
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void pace_init(void);
+
+
+// *******************************************************************************************
+// Function:
+//		uint64_t pace_now(void)
+//
+// Description:
+//		Monotonic time
+//
+// Parameters:
+//		None
+//
+// Return:
+//		Time (ns)
+//
+// *******************************************************************************************
+uint64_t pace_now(void);
+
+
+// *******************************************************************************************
+// Function:
+//		void pace_until(uint64_t deadline)
+//
+// Description:
+//		Wait until an absolute time: sleep until PACE_SLACK before it, then spin
+//
+// Parameters:
+//		deadline	- Monotonic time (ns), nothing is done if it is past
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void pace_until(uint64_t deadline);
+
+
+// *******************************************************************************************
+// Function:
+//		void pace_delay_us(uint32_t us)
+//
+// Description:
+//		Wait for a number of microseconds from now, e.g. the gap after a packet (tx_delay)
+//
+// Parameters:
+//		us			- Delay (us)
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void pace_delay_us(uint32_t us);
+
+
+// *******************************************************************************************
+// Function:
+//		void pace_delay_ns(uint32_t ns)
+//
+// Description:
+//		Spin for a number of nanoseconds with the calibrated loop, for the delays shorter
+//		than a read of the clock
+//
+// Parameters:
+//		ns			- Delay (ns)
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void pace_delay_ns(uint32_t ns);
+
+
+#endif /* UTILS_PACE_H_ */
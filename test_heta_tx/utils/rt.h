@@ -0,0 +1,80 @@
+/*
+ * rt.h
+ *
+ * Real-time setup of the radio thread: the thread which runs the protocol gets a
+ * SCHED_FIFO priority and its own CPU on a multi-core Pi, the memory of the process
+ * is locked so that SPI turnaround is not delayed by a page fault. The other threads
+ * (capture, storage) are kept away from that CPU and exchange frames with the radio
+ * thread through the lock-free frame pools (frame_pool.h).
+ */
+
+#ifndef UTILS_RT_H_
+#define UTILS_RT_H_
+
+#include <stdint.h>
+
+
+// *******************************************************************************************
+#define RT_PRIORITY				(80)		// SCHED_FIFO priority of the radio thread, under the wiringPi ISR thread (piHiPri)
+#define RT_CPU					(-1)		// CPU of the radio thread, -1: the last CPU, not used on a single-core Pi
+#define RT_STACK_PREFAULT		(256 * 1024)	// bytes of stack touched once, so that it is mapped before mlockall()
+
+
+// =========================================================================================================================================
+// *******************************************************************************************
+// Function:
+//		void rt_init(void)
+//
+// Description:
+//		Lock the memory of the process (current and future), keep the freed memory in
+//		the process and map the stack of the calling thread. It is called after the
+//		buffers are allocated
+//
+// Parameters:
+//		None
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void rt_init(void);
+
+
+// *******************************************************************************************
+// Function:
+//		void rt_thread_radio(void)
+//
+// Description:
+//		Make the calling thread the radio thread: SCHED_FIFO with RT_PRIORITY,
+//		pinned to RT_CPU on a multi-core Pi. Without the permission (root or
+//		CAP_SYS_NICE), the thread keeps the normal scheduling
+//
+// Parameters:
+//		None
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void rt_thread_radio(void);
+
+
+// *******************************************************************************************
+// Function:
+//		void rt_thread_other(void)
+//
+// Description:
+//		Give the calling thread the normal scheduling (it may be created by the radio
+//		thread) on all CPUs except the one of the radio thread
+//
+// Parameters:
+//		None
+//
+// Return:
+//		None
+//
+// *******************************************************************************************
+void rt_thread_other(void);
+
+
+#endif /* UTILS_RT_H_ */
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "spsc_queue.h"
+
+
+// ========================================================
+//
+// Allocate the queue
+//
+// ========================================================
+void spsc_init(spsc_queue_t *Q, uint32_t size)
+{
+	uint32_t n;
+
+	n = 1;
+	while (n < size)
+		n <<= 1;
+
+	Q->slot = (void**) calloc (n, sizeof(void*));
+	if (Q->slot == NULL)
+	{
+		printf("Info: --- Not enough memory to store the queue ... \n");
+		exit (1);
+	}
+	Q->mask = n - 1;
+	Q->head = 0;
+	Q->tail = 0;
+}
+
+
+// ========================================================
+//
+// Free the queue
+//
+// ========================================================
+void spsc_free(spsc_queue_t *Q)
+{
+	free(Q->slot);
+	Q->slot = NULL;
+}
+
+
+// ========================================================
+//
+// Add an item (producer)
+//
+// ========================================================
+uint8_t spsc_push(spsc_queue_t *Q, void *item)
+{
+	uint32_t head, tail;
+
+	// head and tail run freely, tail - head is the number of items
+	tail = Q->tail;
+	head = __atomic_load_n(&Q->head, __ATOMIC_ACQUIRE);
+	if ((tail - head) > Q->mask)
+		return 0;
+
+	Q->slot[tail & Q->mask] = item;
+	__atomic_store_n(&Q->tail, tail + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+
+// ========================================================
+//
+// Remove an item (consumer)
+//
+// ========================================================
+void* spsc_pop(spsc_queue_t *Q)
+{
+	uint32_t head, tail;
+	void *item;
+
+	head = Q->head;
+	tail = __atomic_load_n(&Q->tail, __ATOMIC_ACQUIRE);
+	if (tail == head)
+		return NULL;
+
+	item = Q->slot[head & Q->mask];
+	__atomic_store_n(&Q->head, head + 1, __ATOMIC_RELEASE);
+	return item;
+}
+
+
+// ========================================================
+//
+// Number of items
+//
+// ========================================================
+uint32_t spsc_count(spsc_queue_t *Q)
+{
+	return __atomic_load_n(&Q->tail, __ATOMIC_ACQUIRE) - __atomic_load_n(&Q->head, __ATOMIC_ACQUIRE);
+}
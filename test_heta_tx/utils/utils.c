@@ -1,5 +1,9 @@
 #include <stdio.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "utils.h"
 
 
@@ -8,7 +12,7 @@
 // Write binary file to array
 //
 // ========================================================
-long writeBinaryFileToArray(char frame_name[], unsigned char *frame_data)
+long writeBinaryFileToArray(char frame_name[], unsigned char *frame_data, long frame_data_max)
 {
 	FILE *fp; 
 	long frame_data_size;
@@ -28,6 +32,14 @@ long writeBinaryFileToArray(char frame_name[], unsigned char *frame_data)
 		frame_data_size = ftell(fp);
 		rewind(fp);
 
+		// The file does not fit in the array
+		if (frame_data_size > frame_data_max)
+		{
+			printf ("Error: %s file is larger than %ld bytes\n", frame_name, frame_data_max);
+			fclose(fp);
+			return 0;
+		}
+
 		// Copy the file to frame_data array
 		result = fread (frame_data, sizeof(unsigned char), frame_data_size, fp);
 		if (result != frame_data_size)
@@ -43,6 +55,59 @@ long writeBinaryFileToArray(char frame_name[], unsigned char *frame_data)
 	return frame_data_size;  
 }
 
+
+// ========================================================
+//
+// Map binary file
+//
+// ========================================================
+unsigned char* mapBinaryFile (char frame_name[], long *frame_data_size, int populate)
+{
+	int fd;
+	struct stat st;
+	void *frame_data;
+
+	*frame_data_size = 0;
+	fd = open(frame_name, O_RDONLY);
+	if (fd < 0)
+	{
+		// printf ("Error: Open %s file FAILED\n", frame_name);
+		return NULL;
+	}
+
+	// An empty file cannot be mapped
+	if ((fstat(fd, &st) != 0) || (st.st_size == 0))
+	{
+		close(fd);
+		return NULL;
+	}
+
+	// The mapping stays valid after close()
+	frame_data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), fd, 0);
+	close(fd);
+	if (frame_data == MAP_FAILED)
+	{
+		printf ("Error: Map %s file FAILED\n", frame_name);
+		return NULL;
+	}
+	madvise(frame_data, st.st_size, MADV_SEQUENTIAL);
+
+	*frame_data_size = st.st_size;
+	return (unsigned char *)frame_data;
+}
+
+
+// ========================================================
+//
+// Unmap binary file
+//
+// ========================================================
+void unmapBinaryFile (unsigned char *frame_data, long frame_data_size)
+{
+	if (frame_data != NULL)
+		munmap(frame_data, frame_data_size);
+}
+
 // ========================================================
 //
 // Write array to binary file